@@ -2,11 +2,21 @@
 
 #include "MoonWalker.h"
 #include "MoonWalkerMovementComponent.h"
+#include "OrbitCore/GravityMath.h"//OrbitCore/include has to be on MoonWalker.Build.cs's include path, the way Orbit.Build.cs adds it
 // @todo this is here only due to circular dependency to AIModule. To be removed
 //#include "Navigation/PathFollowingComponent.h"
 //PostConstructInitializeProperties
 DEFINE_LOG_CATEGORY_STATIC(LogCharacterMovement, Log, All);
 
+// The moon everything falls toward.
+static const FVector MoonCenter(0.f, 0.f, 5000.f);
+static const float MoonMass = 9000000.f;
+
+static FORCEINLINE OrbitCore::FVec ToOrbitCore(const FVector& V)
+{
+	return OrbitCore::FVec(V.X, V.Y, V.Z);
+}
+
 // Version that does not use inverse sqrt estimate, for higher precision.
 FORCEINLINE FVector ClampMaxSizePrecise(const FVector& V, float MaxSize)
 {
@@ -59,20 +69,14 @@ UMoonWalkerMovementComponent::UMoonWalkerMovementComponent(const class FObjectIn
 // Magnitude of Gravity
 float UMoonWalkerMovementComponent::GetGravityZ() const
 {
-	float distance, magnitude, gravBodyMass = 9000000.f;
-	distance = FVector::Dist(FVector(0, 0, 5000), GetActorLocation());
-	magnitude = (Mass * gravBodyMass) / FMath::Square(distance);
-	return magnitude;
+	return OrbitCore::PointMassMagnitude(ToOrbitCore(GetActorLocation()), ToOrbitCore(MoonCenter), MoonMass, Mass);
 }
 
 // Normalized Gravity Direction Vector
 FVector UMoonWalkerMovementComponent::GetGravityDir() const
 {
-	FVector v;
-	v = (FVector(0.f, 0.f, 5000.f) - GetActorLocation());
-	v.Normalize();
-	
-	return v;
+	const OrbitCore::FVec Direction = OrbitCore::PointMassDirection(ToOrbitCore(GetActorLocation()), ToOrbitCore(MoonCenter));
+	return FVector(Direction.X, Direction.Y, Direction.Z);
 }
 
 // Magnitude and Direction Vector of Gravity
@@ -1,5 +1,6 @@
 // Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
 
+using System.IO;
 using UnrealBuildTool;
 
 public class Orbit : ModuleRules
@@ -7,5 +8,10 @@ public class Orbit : ModuleRules
 	public Orbit(TargetInfo Target)
 	{
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
+		PrivateDependencyModuleNames.AddRange(new string[] { "Json" });//OrbitPerfGameMode reports
+
+		// Header-only gravity and movement math shared with the standalone OrbitCore CMake build.
+		string ModulePath = Path.GetDirectoryName(RulesCompiler.GetModuleFilename(this.GetType().Name));
+		PublicIncludePaths.Add(Path.GetFullPath(Path.Combine(ModulePath, "..", "..", "..", "OrbitCore", "include")));
 	}
 }
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "GravityBodyComponent.h"
+
+UGravityBodyComponent::UGravityBodyComponent(const class FObjectInitializer& PCIP)
+	: Super(PCIP)
+{
+	bWantsInitializeComponent = true;
+	bGravitySource = true;
+	bGravityReceiver = false;
+	bApplyForce = false;
+	bAlwaysPerturb = false;
+	bAnalyticCollision = false;
+	CollisionRadius = 0.f;
+	Mass = 0.f;
+}
+
+void UGravityBodyComponent::InitializeComponent()
+{
+	Super::InitializeComponent();
+
+	UGravityManager* GravityManager = UGravityManager::Get(GetWorld());
+	AActor* Owner = GetOwner();
+	if (!GravityManager || !Owner)
+	{
+		return;
+	}
+
+	UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Owner->GetRootComponent());
+	if (bAnalyticCollision)
+	{
+		const float Radius = CollisionRadius > 0.f ? CollisionRadius : (Primitive ? Primitive->Bounds.SphereRadius : 0.f);
+		if (Radius > 0.f)
+		{
+			GravityManager->RegisterPlanet(Owner, Radius);
+			Manager = GravityManager;
+		}
+	}
+
+	int32 Flags = EGravityBodyFlags::None;
+	Flags |= bGravitySource ? EGravityBodyFlags::Source : 0;
+	Flags |= bGravityReceiver ? EGravityBodyFlags::Receiver : 0;
+	Flags |= (bGravityReceiver && bApplyForce) ? EGravityBodyFlags::ApplyForce : 0;
+	Flags |= (bGravitySource && bAlwaysPerturb) ? EGravityBodyFlags::Perturber : 0;
+	if (Flags == EGravityBodyFlags::None)
+	{
+		return;
+	}
+
+	float BodyMass = Mass;
+	if (BodyMass <= 0.f && Primitive && Primitive->GetBodyInstance())
+	{
+		BodyMass = Primitive->GetBodyInstance()->MassInKg;
+	}
+
+	Handle = GravityManager->RegisterBody(Owner, Primitive, Flags, BodyMass);
+	Manager = GravityManager;
+}
+
+void UGravityBodyComponent::UninitializeComponent()
+{
+	if (UGravityManager* GravityManager = Manager.Get())
+	{
+		GravityManager->UnregisterBody(Handle);
+		if (bAnalyticCollision)
+		{
+			GravityManager->UnregisterPlanet(GetOwner());
+		}
+	}
+	Handle = FGravityBodyHandle();
+	Manager = NULL;
+
+	Super::UninitializeComponent();
+}
+
+FVector UGravityBodyComponent::GetGravityVector() const
+{
+	const UGravityManager* GravityManager = Manager.Get();
+	return GravityManager ? GravityManager->GetGravityBody(Handle).GravityVector : FVector::ZeroVector;
+}
@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "GravityBodyRegistry.h"
+
+FGravityBodyHandle FGravityBodyRegistry::Register(const FString& Name, AActor* Actor, UPrimitiveComponent* Component, int32 InFlags, float Mass)
+{
+	int32 Slot;
+	if (FreeSlots.Num() > 0)
+	{
+		Slot = FreeSlots.Pop(false);
+	}
+	else
+	{
+		Slot = Flags.Num();
+		Positions.AddUninitialized();
+		Masses.AddUninitialized();
+		GravityVectors.AddUninitialized();
+		Magnitudes.AddUninitialized();
+		Flags.AddUninitialized();
+		Actors.AddDefaulted();
+		Components.AddDefaulted();
+		Generations.Add(0);
+		SourceIndex.AddUninitialized();
+		ReceiverIndex.AddUninitialized();
+		Names.AddDefaulted();
+	}
+
+	Positions[Slot] = Actor ? Actor->GetActorLocation() : FVector::ZeroVector;
+	Masses[Slot] = Mass;
+	GravityVectors[Slot] = FVector::ZeroVector;
+	Magnitudes[Slot] = 0.f;
+	Flags[Slot] = (uint8)InFlags;
+	Actors[Slot] = Actor;
+	Components[Slot] = Component;
+	SourceIndex[Slot] = INDEX_NONE;
+	ReceiverIndex[Slot] = INDEX_NONE;
+	Names[Slot] = Name;
+
+	if (InFlags & EGravityBodyFlags::Source)
+	{
+		AddToList(Sources, SourceIndex, Slot);
+	}
+	if (InFlags & EGravityBodyFlags::Receiver)
+	{
+		AddToList(Receivers, ReceiverIndex, Slot);
+	}
+
+	const FGravityBodyHandle Handle(Slot, Generations[Slot]);
+	NameToHandle.Add(Name, Handle);
+	return Handle;
+}
+
+void FGravityBodyRegistry::Unregister(FGravityBodyHandle Handle)
+{
+	if (!IsValid(Handle))
+	{
+		return;
+	}
+	const int32 Slot = Handle.Index;
+
+	RemoveFromList(Sources, SourceIndex, Slot);
+	RemoveFromList(Receivers, ReceiverIndex, Slot);
+
+	if (const FGravityBodyHandle* Named = NameToHandle.Find(Names[Slot]))
+	{
+		if (*Named == Handle)
+		{
+			NameToHandle.Remove(Names[Slot]);
+		}
+	}
+
+	Flags[Slot] = EGravityBodyFlags::None;
+	Actors[Slot] = NULL;
+	Components[Slot] = NULL;
+	Names[Slot].Empty();
+	Generations[Slot]++;
+	FreeSlots.Add(Slot);
+}
+
+void FGravityBodyRegistry::Empty()
+{
+	Positions.Empty();
+	Masses.Empty();
+	GravityVectors.Empty();
+	Magnitudes.Empty();
+	Flags.Empty();
+	Actors.Empty();
+	Components.Empty();
+	Sources.Empty();
+	Receivers.Empty();
+	Generations.Empty();
+	SourceIndex.Empty();
+	ReceiverIndex.Empty();
+	Names.Empty();
+	FreeSlots.Empty();
+	NameToHandle.Empty();
+}
+
+FGravityBodyHandle FGravityBodyRegistry::Find(const FString& Name) const
+{
+	const FGravityBodyHandle* Handle = NameToHandle.Find(Name);
+	return Handle ? *Handle : FGravityBodyHandle();
+}
+
+void FGravityBodyRegistry::SyncPositions()
+{
+	TArray<FGravityBodyHandle, TInlineAllocator<8>> Stale;
+	for (int32 Slot = 0; Slot < Flags.Num(); Slot++)
+	{
+		if (Flags[Slot] == EGravityBodyFlags::None)
+		{
+			continue;
+		}
+		const AActor* Actor = Actors[Slot].Get();
+		if (Actor)
+		{
+			Positions[Slot] = Actor->GetActorLocation();
+		}
+		else
+		{
+			Stale.Add(FGravityBodyHandle(Slot, Generations[Slot]));
+		}
+	}
+	for (const FGravityBodyHandle& Handle : Stale)
+	{
+		Unregister(Handle);
+	}
+}
+
+void FGravityBodyRegistry::ResetAccumulators()
+{
+	for (const int32 Slot : Receivers)
+	{
+		GravityVectors[Slot] = FVector::ZeroVector;
+		Magnitudes[Slot] = 0.f;
+	}
+}
+
+void FGravityBodyRegistry::AddToList(TArray<int32>& List, TArray<int32>& ListIndex, int32 Slot)
+{
+	ListIndex[Slot] = List.Add(Slot);
+}
+
+void FGravityBodyRegistry::RemoveFromList(TArray<int32>& List, TArray<int32>& ListIndex, int32 Slot)
+{
+	const int32 At = ListIndex[Slot];
+	if (At == INDEX_NONE)
+	{
+		return;
+	}
+	List.RemoveAtSwap(At);
+	if (At < List.Num())
+	{
+		ListIndex[List[At]] = At;
+	}
+	ListIndex[Slot] = INDEX_NONE;
+}
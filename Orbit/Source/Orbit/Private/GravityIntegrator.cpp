@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "GravityIntegrator.h"
+
+void FGravityIntegrator::Advance(EGravityIntegrator::Type Method, IGravityAccelerationSource& Source, TArray<FVector>& Positions, TArray<FVector>& Velocities, float Substep, int32 NumSteps)
+{
+	check(Positions.Num() == Velocities.Num());
+	const int32 Num = Positions.Num();
+	if (NumSteps <= 0 || Num == 0)
+	{
+		return;
+	}
+	Scratch.Acc.SetNumUninitialized(Num);
+
+	auto GetAccelerations = [&Source](const TArray<FVector>& InPositions, TArray<FVector>& OutAccelerations)
+	{
+		Source.GetAccelerations(InPositions, OutAccelerations);
+	};
+
+	switch (Method)
+	{
+	case EGravityIntegrator::SemiImplicitEuler:
+		OrbitCore::AdvanceSemiImplicitEuler(Positions, Velocities, Scratch, Num, Substep, NumSteps, GetAccelerations);
+		break;
+	case EGravityIntegrator::Leapfrog:
+		OrbitCore::AdvanceLeapfrog(Positions, Velocities, Scratch, Num, Substep, NumSteps, GetAccelerations);
+		break;
+	case EGravityIntegrator::Yoshida4:
+		OrbitCore::AdvanceYoshida4(Positions, Velocities, Scratch, Num, Substep, NumSteps, GetAccelerations);
+		break;
+	case EGravityIntegrator::RK4:
+		Scratch.TrialX.SetNumUninitialized(Num);
+		Scratch.K1V.SetNumUninitialized(Num);
+		Scratch.K2X.SetNumUninitialized(Num);
+		Scratch.K2V.SetNumUninitialized(Num);
+		Scratch.K3X.SetNumUninitialized(Num);
+		Scratch.K3V.SetNumUninitialized(Num);
+		Scratch.K4V.SetNumUninitialized(Num);
+		OrbitCore::AdvanceRK4(Positions, Velocities, Scratch, Num, Substep, NumSteps, GetAccelerations);
+		break;
+	default:
+		break;//PhysicsEngine: nothing to do here
+	}
+}
+
+int32 FGravityIntegrator::PickRung(const FVector& Acceleration, const FVector& Jerk, float FinestStep, float Eta, int32 MaxRung)
+{
+	const float JerkSq = Jerk.SizeSquared();
+	if (JerkSq <= SMALL_NUMBER * Acceleration.SizeSquared())
+	{
+		return MaxRung;//field isn't changing along the path
+	}
+	const float Step = Eta * Acceleration.Size() / FMath::Sqrt(JerkSq);
+	if (Step <= FinestStep)
+	{
+		return 0;
+	}
+	return FMath::Min(FMath::FloorToInt(FMath::Log2(Step / FinestStep)), MaxRung);
+}
+
+// Kick-drift-kick where each body's kicks happen on its own rung. A body whose step ends on
+// this tick gets its closing half kick, picks a new rung, then opens the next step with the
+// same acceleration. Rungs only ever start on ticks divisible by their length, so steps nest.
+int32 FGravityIntegrator::AdvanceBlockLeapfrog(IGravityAccelerationSource& Source, TArray<FVector>& X, TArray<FVector>& V, TArray<FGravityBlockStepState>& States, float FinestStep, int32 MaxRung, float Eta, int32& Tick, int32 NumSteps)
+{
+	check(X.Num() == V.Num() && X.Num() == States.Num());
+	const int32 TickPeriod = 1 << MaxRung;
+	int32 Evaluations = 0;
+
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		Active.Reset();
+		for (int32 i = 0; i < States.Num(); i++)
+		{
+			const FGravityBlockStepState& State = States[i];
+			if (!State.bOpen || (Tick & ((1 << State.Rung) - 1)) == 0)
+			{
+				Active.Add(i);
+			}
+		}
+
+		if (Active.Num() > 0)
+		{
+			Scratch.Acc.SetNumUninitialized(Active.Num());
+			Source.GetAccelerationsFor(X, Active, Scratch.Acc);
+			Evaluations += Active.Num();
+
+			for (int32 k = 0; k < Active.Num(); k++)
+			{
+				FGravityBlockStepState& State = States[Active[k]];
+				FVector& Velocity = V[Active[k]];
+				const FVector& Acceleration = Scratch.Acc[k];
+
+				int32 Rung = 0;
+				if (State.bOpen)
+				{
+					const float H = FinestStep * (1 << State.Rung);
+					Velocity += Acceleration * (0.5f * H);
+					const FVector Jerk = (Acceleration - State.Acceleration) / H;
+					Rung = FMath::Min(PickRung(Acceleration, Jerk, FinestStep, Eta, MaxRung), State.Rung + 1);//grow one rung at a time
+					while (Rung > 0 && (Tick & ((1 << Rung) - 1)) != 0)
+					{
+						Rung--;//a longer step may only start where it lines up with the blocks
+					}
+				}
+
+				State.Rung = Rung;
+				State.Acceleration = Acceleration;
+				State.bOpen = true;
+				Velocity += Acceleration * (0.5f * FinestStep * (1 << Rung));
+			}
+		}
+
+		OrbitCore::Drift(X, V, X.Num(), FinestStep);
+		Tick = (Tick + 1) % TickPeriod;
+	}
+	return Evaluations;
+}
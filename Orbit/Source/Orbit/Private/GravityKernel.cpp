@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "GravityKernel.h"
+#include "OrbitCore/GravitySimd.h"
+
+void FGravityReceiverBatch::Reset(int32 InNum)
+{
+	NumReceivers = InNum;
+	const int32 Padded = (InNum + 3) & ~3;
+
+	X.SetNumUninitialized(Padded);
+	Y.SetNumUninitialized(Padded);
+	Z.SetNumUninitialized(Padded);
+	FieldX.SetNumUninitialized(Padded);
+	FieldY.SetNumUninitialized(Padded);
+	FieldZ.SetNumUninitialized(Padded);
+	Magnitude.SetNumUninitialized(Padded);
+	// Padding lanes sit at the origin; whatever they add is never read back.
+	for (int32 i = InNum; i < Padded; i++)
+	{
+		X[i] = Y[i] = Z[i] = 0.f;
+	}
+	FMemory::Memzero(FieldX.GetData(), Padded * sizeof(float));
+	FMemory::Memzero(FieldY.GetData(), Padded * sizeof(float));
+	FMemory::Memzero(FieldZ.GetData(), Padded * sizeof(float));
+	FMemory::Memzero(Magnitude.GetData(), Padded * sizeof(float));
+}
+
+void FGravityKernel::AccumulateSourceScalar(FGravityReceiverBatch& Batch, int32 Begin, int32 End, const FVector& SourcePosition, float SourceMass, float SofteningSq, bool bInverseSquare)
+{
+	End = FMath::Min(End, Batch.Num());
+	OrbitCore::AccumulateSource(Batch.X.GetData(), Batch.Y.GetData(), Batch.Z.GetData(),
+		Batch.FieldX.GetData(), Batch.FieldY.GetData(), Batch.FieldZ.GetData(), Batch.Magnitude.GetData(),
+		Begin, End, ToOrbitCore(SourcePosition), SourceMass, SofteningSq, bInverseSquare);
+}
+
+void FGravityKernel::AccumulateSourceSimd(FGravityReceiverBatch& Batch, int32 Begin, int32 End, const FVector& SourcePosition, float SourceMass, float SofteningSq, bool bInverseSquare)
+{
+	checkSlow((Begin & 3) == 0 && (End & 3) == 0 && End <= Batch.NumPadded());
+	OrbitCore::AccumulateSourceSimd(Batch.X.GetData(), Batch.Y.GetData(), Batch.Z.GetData(),
+		Batch.FieldX.GetData(), Batch.FieldY.GetData(), Batch.FieldZ.GetData(), Batch.Magnitude.GetData(),
+		Begin, End, ToOrbitCore(SourcePosition), SourceMass, SofteningSq, bInverseSquare);
+}
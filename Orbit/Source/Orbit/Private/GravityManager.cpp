@@ -2,104 +2,744 @@
 
 #include "Orbit.h"
 #include "GravityManager.h"
-TMap<FString, FString> Fuckers;
-//TMap<FString, FMyActorWrapper> Actors;
-TMap<FString, AStaticMeshActor *> GravBods;//bodies that create gravity
-TMap<FString, AStaticMeshActor *> GravActiveBods;//bodies that are attracted to gravity
-TMap<FString, APlayerStart *> Players;
-TMap<FString, FGravityBody> GravityBodies;//bodies that are attracted to gravity
+#include "GravityBodyComponent.h"
+#include "OrbitStats.h"
+#include "OrbitTrace.h"
+static TMap<UWorld*, UGravityManager*> WorldGravityManagers;
+
+class FGravityBlockTask
+{
+	UGravityManager* Manager;
+	int32 Block;
+
+public:
+	FGravityBlockTask(UGravityManager* InManager, int32 InBlock)
+		: Manager(InManager)
+		, Block(InBlock)
+	{
+	}
+
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FGravityBlockTask, STATGROUP_TaskGraphTasks);
+	}
+	static ENamedThreads::Type GetDesiredThread() { return ENamedThreads::AnyThread; }
+	static ESubsequentsMode::Type GetSubsequentsMode() { return ESubsequentsMode::TrackSubsequents; }
+
+	void DoTask(ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+	{
+		Manager->SolveReceiverBlock(Block);
+	}
+};
 
 UGravityManager::UGravityManager(const class FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
+	bUseBarnesHut = false;
+	BarnesHutTheta = 0.5f;
+	bUseSimdKernel = false;
+	GravitySoftening = 0.f;
+	bParallelGravity = true;
+	Integrator = EGravityIntegrator::PhysicsEngine;
+	IntegratorSubstep = 1.f / 120.f;
+	MaxSubstepsPerFrame = 8;
+	IntegratorAccumulator = 0.f;
+	MaxTimestepRung = 0;
+	TimestepAccuracy = 0.05f;
+	BlockTick = 0;
+	BlockTickRung = 0;
+	Falloff = EGravityFalloff::Linear;
+	bUseKeplerRails = false;
+	RailsPerturbationThreshold = 0.01f;
+	RailsClearance = 500.f;
+	RailsCheckInterval = 30;
+	RailsFrame = 0;
+	bUseSoiHierarchy = false;
+	SoiAncestorPerturbers = 0;
+	TrajectoryInterval = 0.25f;
+	TrajectorySubsteps = 8;
+	TrajectorySourceTolerance = 10.f;
+	TrajectoryPositionTolerance = 25.f;
+	TrajectoryVelocityTolerance = 10.f;
+	World = NULL;
+
+	GravityTick.TickGroup = TG_PrePhysics;
+	GravityTick.bCanEverTick = true;
+	GravityTick.bStartWithTickEnabled = true;
+}
+
+UGravityManager* UGravityManager::Get(UWorld* InWorld){
+	if (!InWorld){
+		return NULL;
+	}
+	if (UGravityManager** Found = WorldGravityManagers.Find(InWorld)){
+		return *Found;
+	}
+
+	static bool bCleanupBound = false;
+	if (!bCleanupBound){
+		FWorldDelegates::OnWorldCleanup.AddStatic(&UGravityManager::OnWorldCleanup);
+		bCleanupBound = true;
+	}
+
+	UGravityManager* Manager = ConstructObject<UGravityManager>(UGravityManager::StaticClass(), InWorld);
+	Manager->AddToRoot();//only the map below points at it
+	Manager->World = InWorld;
+	Manager->GravityTick.Manager = Manager;
+	Manager->GravityTick.RegisterTickFunction(InWorld->PersistentLevel);
+	WorldGravityManagers.Add(InWorld, Manager);
+	Manager->ImportTaggedActors();
+	return Manager;
+}
+
+void UGravityManager::OnWorldCleanup(UWorld* InWorld, bool bSessionEnded, bool bCleanupResources){
+	UGravityManager** Found = WorldGravityManagers.Find(InWorld);
+	if (Found){
+		UGravityManager* Manager = *Found;
+		WorldGravityManagers.Remove(InWorld);
+		Manager->GravityTick.UnRegisterTickFunction();
+		Manager->Registry.Empty();
+		Manager->IntegratedStates.Empty();
+		Manager->Trajectories.Reset();
+		Manager->Planets.Empty();
+		Manager->World = NULL;
+		Manager->RemoveFromRoot();
+	}
+}
+
+void FGravityTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent){
+	FOrbitStatsCsv::Tick();//first thing in the frame that reads the stats
+	if (Manager && TickType != LEVELTICK_ViewportsOnly){
+		Manager->ApplyGravity();
+		Manager->IntegrateBodies(DeltaTime);
+		Manager->UpdateTrajectories();
+		Manager->Planets.SyncCenters();//after integration moved them
+	}
 }
 
-void UGravityManager::Start(){
-	for (TObjectIterator<AStaticMeshActor> Itr; Itr; ++Itr)
+FString FGravityTickFunction::DiagnosticMessage(){
+	return TEXT("FGravityTickFunction");
+}
+
+void UGravityManager::ImportTaggedActors(){
+	for (TActorIterator<AStaticMeshActor> Itr(World); Itr; ++Itr)
 	{
-		if (Itr->ActorHasTag(TEXT("GravitationalBody"))){
-			GravBods.Add(Itr->GetName(), *Itr);//is this storing the whole object? Hope not.
+		if (Itr->FindComponentByClass<UGravityBodyComponent>()){
+			continue;//registers itself
 		}
-		if (Itr->ActorHasTag(TEXT("GratitationallyActive"))){
-			GravActiveBods.Add(Itr->GetName(), *Itr);//is this storing the whole object? Hope not.
+		const bool bSource = Itr->ActorHasTag(TEXT("GravitationalBody"));
+		const bool bActive = Itr->ActorHasTag(TEXT("GravitationallyActive")) || Itr->ActorHasTag(TEXT("GratitationallyActive"));//old maps have the typo
+		if (bSource || bActive){
+			int32 Flags = EGravityBodyFlags::None;
+			Flags |= bSource ? EGravityBodyFlags::Source : 0;
+			Flags |= bActive ? (EGravityBodyFlags::Receiver | EGravityBodyFlags::ApplyForce) : 0;
+			UStaticMeshComponent* Mesh = Itr->GetStaticMeshComponent();
+			RegisterBody(*Itr, Mesh, Flags, Mesh->GetBodyInstance()->MassInKg);
 		}
 	}
-	for (TObjectIterator<APlayerStart> Itr; Itr; ++Itr)
+}
+
+void UGravityManager::SampleField(const TArray<FVector>& Points, TArray<FVector>& OutField){
+	ORBIT_SCOPE_CYCLE_COUNTER(GravitySample);
+	ORBIT_INC_COUNTER(GravitySamplePoints, Points.Num());
+	const float SofteningSq = GravitySoftening * GravitySoftening;
+	const bool bInverseSquare = Falloff == EGravityFalloff::InverseSquare;
+	SampleBatch.Reset(Points.Num());
+	for (int32 i = 0; i < Points.Num(); i++)
 	{
-		if (Itr->ActorHasTag(TEXT("GratitationallyActive"))){
-			Players.Add(Itr->GetName(), *Itr);//is this storing the whole object? Hope not.
-		}
+		SampleBatch.SetPosition(i, Points[i]);
+	}
+	for (const int32 Source : Registry.Sources)
+	{
+		FGravityKernel::AccumulateSource(SampleBatch, Registry.Positions[Source], Registry.Masses[Source], SofteningSq, bInverseSquare, bUseSimdKernel);
+	}
+	OutField.SetNumUninitialized(Points.Num());
+	for (int32 i = 0; i < Points.Num(); i++)
+	{
+		OutField[i] = SampleBatch.GetField(i);
+	}
+}
+
+void UGravityManager::RequestTrajectory(FGravityBodyHandle Body, float Duration){
+	if (Registry.IsValid(Body)){
+		Trajectories.Request(Body, Duration);
 	}
 }
 
+void UGravityManager::CancelTrajectory(FGravityBodyHandle Body){
+	Trajectories.Cancel(Body);
+}
+
+const FGravityTrajectory* UGravityManager::GetTrajectory(FGravityBodyHandle Body) const{
+	return Trajectories.Find(Body);
+}
+
+void UGravityManager::UpdateTrajectories(){
+	ORBIT_SCOPE_CYCLE_COUNTER(Trajectories);
+	if (!World){
+		return;
+	}
+	FGravityTrajectorySettings Settings;
+	Settings.Method = Integrator == EGravityIntegrator::PhysicsEngine ? EGravityIntegrator::Leapfrog : Integrator.GetValue();
+	Settings.Interval = FMath::Max(TrajectoryInterval, 0.01f);
+	Settings.SubstepsPerPoint = FMath::Max(TrajectorySubsteps, 1);
+	Settings.SofteningSq = GravitySoftening * GravitySoftening;
+	Settings.bInverseSquare = Falloff == EGravityFalloff::InverseSquare;
+	Settings.SourceTolerance = TrajectorySourceTolerance;
+	Settings.PositionTolerance = TrajectoryPositionTolerance;
+	Settings.VelocityTolerance = TrajectoryVelocityTolerance;
+	Trajectories.Update(Registry, Settings, World->GetTimeSeconds());
+}
+
+FGravityBodyHandle UGravityManager::RegisterBody(AActor* Actor, UPrimitiveComponent* Component, int32 Flags, float Mass){
+	check(Actor);
+	const FGravityBodyHandle Handle = Registry.Register(Actor->GetName(), Actor, Component, Flags, Mass);
+	if (IntegratedStates.Num() < Registry.NumSlots()){
+		IntegratedStates.AddZeroed(Registry.NumSlots() - IntegratedStates.Num());
+	}
+	IntegratedStates[Handle.Index].bValid = false;//slot may be reused, don't inherit a velocity
+	IntegratedStates[Handle.Index].bOnRails = false;
+	return Handle;
+}
+
+void UGravityManager::UnregisterBody(FGravityBodyHandle Handle){
+	Registry.Unregister(Handle);
+}
+
+void UGravityManager::RegisterPlanet(AActor* Actor, float Radius){
+	Planets.Add(Actor, Radius);
+}
+
+void UGravityManager::UnregisterPlanet(AActor* Actor){
+	Planets.Remove(Actor);
+}
 
 void UGravityManager::ApplyGravity(){
-	FVector GravityDistanceVector = FVector::ZeroVector;
-	float GravBodyMass = 0.f;
-	APlayerStart* Player;
-	AStaticMeshActor* ActiveBody;
-	FGravityBody BodyStats, PlayerStats;
-
-	for (auto GB : GravityBodies){
-		GB.Value.GravityVector = FVector::ZeroVector;
-		SetGravityBody(GB.Key, GB.Value);
-	}
-
-	for (auto Bod : GravBods)
-	{
-		auto GravitationalBody = Bod.Value;
-		GravBodyMass = GravitationalBody->GetStaticMeshComponent()->GetBodyInstance()->MassInKg;
-		for (auto ActiveBod : GravActiveBods){
-			ActiveBody = ActiveBod.Value;
-			BodyStats = GetGravityBody(ActiveBod.Key);
-			if (ActiveBody->IsValidLowLevel() && GravitationalBody->IsValidLowLevel()){
-				GravityDistanceVector = GravitationalBody->GetActorLocation() - ActiveBody->GetActorLocation();
-				BodyStats.Magnitude = (ActiveBody->GetStaticMeshComponent()->GetBodyInstance()->MassInKg * GravBodyMass) / FMath::Square(GravityDistanceVector.Size());
-				BodyStats.GravityVector += (GravityDistanceVector* BodyStats.Magnitude);
-				SetGravityBody(ActiveBod.Key, BodyStats);
-				//ActiveBody->GetStaticMeshComponent()->AddForce(BodyStats.GravityVector);
-				//probably need to wait until finished b/f adding force for smoothness
+	ORBIT_SCOPE_CYCLE_COUNTER(GravitySolve);
+	Registry.SyncPositions();
+	Registry.ResetAccumulators();
+
+	// Block-stepped bodies get their field from the integrator, on their own schedule.
+	const bool bSkipIntegrated = Integrator == EGravityIntegrator::Leapfrog && MaxTimestepRung > 0;
+	SolveList.Reset();
+	for (const int32 Receiver : Registry.Receivers)
+	{
+		if ((!bSkipIntegrated || !IsIntegrated(Receiver)) && !IsOnRails(Receiver)){
+			SolveList.Add(Receiver);
+		}
+	}
+
+	ORBIT_INC_COUNTER(GravityReceivers, SolveList.Num());
+
+	if (bUseSoiHierarchy)
+	{
+		ApplyGravitySoi();
+	}
+	else if (bUseBarnesHut)
+	{
+		ApplyGravityBarnesHut();
+	}
+	else
+	{
+		ApplyGravityDirect();
+	}
+	ApplyForces();
+}
+
+// Every source against every receiver. Receivers are gathered into a padded SoA batch once,
+// then each block streams every source over its slice with FGravityKernel.
+void UGravityManager::ApplyGravityDirect(){
+	const TArray<int32>& Receivers = SolveList;
+	ReceiverBatch.Reset(Receivers.Num());
+	for (int32 i = 0; i < Receivers.Num(); i++)
+	{
+		ReceiverBatch.SetPosition(i, Registry.Positions[Receivers[i]]);
+	}
+	SolveReceivers();
+}
+
+// Same results as the direct sum above (within BarnesHutTheta), but sources are put in an
+// octree once and each receiver walks it instead of visiting every source.
+void UGravityManager::ApplyGravityBarnesHut(){
+	GatherSources();
+	SourceTree.Build(SourcePositions, SourceMasses);
+	SolveReceivers();
+}
+
+// Patched conics. Tree indices are positions in Registry.Sources; hints are kept as slots
+// since Sources is reordered when bodies come and go.
+void UGravityManager::ApplyGravitySoi(){
+	GatherSources();
+	SoiTree.Build(SourcePositions, SourceMasses);
+
+	SoiPerturbers.Reset();
+	SoiSourceOfSlot.Reset();
+	SoiSourceOfSlot.AddUninitialized(Registry.NumSlots());
+	for (int32 i = 0; i < SoiSourceOfSlot.Num(); i++)
+	{
+		SoiSourceOfSlot[i] = INDEX_NONE;
+	}
+	for (int32 i = 0; i < Registry.Sources.Num(); i++)
+	{
+		SoiSourceOfSlot[Registry.Sources[i]] = i;
+		if (Registry.Flags[Registry.Sources[i]] & EGravityBodyFlags::Perturber){
+			SoiPerturbers.Add(i);
+		}
+	}
+	if (SoiHints.Num() < Registry.NumSlots()){
+		const int32 OldNum = SoiHints.Num();
+		SoiHints.AddUninitialized(Registry.NumSlots() - OldNum);
+		for (int32 i = OldNum; i < SoiHints.Num(); i++)
+		{
+			SoiHints[i] = INDEX_NONE;
+		}
+	}
+	SolveReceivers();
+}
+
+void UGravityManager::GatherSources(){
+	SourcePositions.Reset();
+	SourceMasses.Reset();
+	for (const int32 Source : Registry.Sources)
+	{
+		SourcePositions.Add(Registry.Positions[Source]);
+		SourceMasses.Add(Registry.Masses[Source]);
+	}
+}
+
+// Each receiver sums its sources in the same fixed order no matter which block or thread it
+// lands on, and every receiver owns its accumulator, so there is nothing to reduce across
+// workers: the output is bit-identical to the serial loop for any thread count.
+void UGravityManager::SolveReceivers(){
+	const int32 NumBlocks = (SolveList.Num() + ReceiversPerBlock - 1) / ReceiversPerBlock;
+	if (!bParallelGravity || NumBlocks <= 1 || !FTaskGraphInterface::IsRunning())
+	{
+		for (int32 Block = 0; Block < NumBlocks; Block++)
+		{
+			SolveReceiverBlock(Block);
+		}
+		return;
+	}
+
+	FGraphEventArray Tasks;
+	for (int32 Block = 1; Block < NumBlocks; Block++)
+	{
+		Tasks.Add(TGraphTask<FGravityBlockTask>::CreateTask().ConstructAndDispatchWhenReady(this, Block));
+	}
+	SolveReceiverBlock(0);//game thread does a share instead of idling
+	FTaskGraphInterface::Get().WaitUntilTasksComplete(Tasks, ENamedThreads::GameThread);
+}
+
+void UGravityManager::SolveReceiverBlock(int32 Block){
+	const TArray<int32>& Receivers = SolveList;
+	const int32 Begin = Block * ReceiversPerBlock;
+	const int32 End = FMath::Min(Begin + ReceiversPerBlock, Receivers.Num());
+	const float SofteningSq = GravitySoftening * GravitySoftening;
+	const bool bInverseSquare = Falloff == EGravityFalloff::InverseSquare;
+
+	if (bUseSoiHierarchy)
+	{
+		const TArray<int32>& Sources = Registry.Sources;
+		for (int32 i = Begin; i < End; i++)
+		{
+			const int32 Receiver = Receivers[i];
+			const FVector& Position = Registry.Positions[Receiver];
+
+			const int32 HintSlot = SoiHints[Receiver];
+			const int32 Hint = HintSlot != INDEX_NONE ? SoiSourceOfSlot[HintSlot] : INDEX_NONE;
+			int32 Soi = SoiTree.FindSoi(Position, Hint);
+			if (Soi != INDEX_NONE && Sources[Soi] == Receiver){
+				Soi = SoiTree.GetParent(Soi);//a moon is moved by its planet, not by itself
+			}
+
+			FVector Field = FVector::ZeroVector;
+			float Magnitude = 0.f;
+			int32 Body = Soi;
+			for (int32 Level = 0; Body != INDEX_NONE && Level <= SoiAncestorPerturbers; Level++)
+			{
+				FGravityKernel::AccumulatePair(Position, SourcePositions[Body], SourceMasses[Body], SofteningSq, bInverseSquare, Field, Magnitude);
+				Body = SoiTree.GetParent(Body);
 			}
+			for (const int32 Perturber : SoiPerturbers)
+			{
+				bool bCounted = false;
+				for (int32 Level = 0, Ancestor = Soi; Ancestor != INDEX_NONE && Level <= SoiAncestorPerturbers; Level++, Ancestor = SoiTree.GetParent(Ancestor))
+				{
+					bCounted |= Ancestor == Perturber;
+				}
+				if (!bCounted){
+					FGravityKernel::AccumulatePair(Position, SourcePositions[Perturber], SourceMasses[Perturber], SofteningSq, bInverseSquare, Field, Magnitude);
+				}
+			}
+
+			SoiHints[Receiver] = Soi != INDEX_NONE ? Sources[Soi] : INDEX_NONE;
+			const float Mass = Registry.Masses[Receiver];
+			Registry.GravityVectors[Receiver] = Field * Mass;
+			Registry.Magnitudes[Receiver] = Magnitude * Mass;
+		}
+		return;
+	}
+
+	if (bUseBarnesHut)
+	{
+		float Magnitude = 0.f;
+		for (int32 i = Begin; i < End; i++)
+		{
+			const int32 Receiver = Receivers[i];
+			const float Mass = Registry.Masses[Receiver];
+			Registry.GravityVectors[Receiver] = SourceTree.GetField(Registry.Positions[Receiver], BarnesHutTheta, &Magnitude, SofteningSq, bInverseSquare) * Mass;
+			Registry.Magnitudes[Receiver] = Magnitude * Mass;
+		}
+		return;
+	}
+
+	const int32 PaddedEnd = FMath::Min(Begin + ReceiversPerBlock, ReceiverBatch.NumPadded());
+	for (const int32 Source : Registry.Sources)
+	{
+		FGravityKernel::AccumulateSource(ReceiverBatch, Begin, PaddedEnd, Registry.Positions[Source], Registry.Masses[Source], SofteningSq, bInverseSquare, bUseSimdKernel);
+	}
+	for (int32 i = Begin; i < End; i++)
+	{
+		const int32 Receiver = Receivers[i];
+		const float Mass = Registry.Masses[Receiver];
+		Registry.GravityVectors[Receiver] = ReceiverBatch.GetField(i) * Mass;
+		Registry.Magnitudes[Receiver] = ReceiverBatch.Magnitude[i] * Mass;
+	}
+}
+
+void UGravityManager::ApplyForces(){
+	for (const int32 Receiver : Registry.Receivers)
+	{
+		if ((Registry.Flags[Receiver] & EGravityBodyFlags::ApplyForce) && !IsIntegrated(Receiver)){
+			UPrimitiveComponent* Component = Registry.Components[Receiver].Get();
+			if (Component){
+				Component->AddForce(Registry.GravityVectors[Receiver]);
+			}
+		}
+	}
+}
+
+bool UGravityManager::IsIntegrated(int32 Slot) const{
+	if (Integrator == EGravityIntegrator::PhysicsEngine || !(Registry.Flags[Slot] & EGravityBodyFlags::ApplyForce)){
+		return false;
+	}
+	const UPrimitiveComponent* Component = Registry.Components[Slot].Get();
+	return Component && Component->IsSimulatingPhysics();
+}
+
+// Accelerations on the integrated bodies at trial positions. Sources that are not integrated
+// stay where this frame's solve saw them; integrated sources move with the trial state.
+// The field is used as the acceleration directly, i.e. solver mass == physics mass.
+class FIntegratedBodyAccelerations : public IGravityAccelerationSource
+{
+public:
+	FIntegratedBodyAccelerations(const FGravityBodyRegistry& Registry, const TArray<int32>& Slots, FGravityReceiverBatch& InBatch, float InSofteningSq, bool bInInverseSquare, bool bInSimd)
+		: Batch(InBatch)
+		, SofteningSq(InSofteningSq)
+		, bInverseSquare(bInInverseSquare)
+		, bSimd(bInSimd)
+	{
+		TArray<int32> SlotToBody;
+		SlotToBody.Init(INDEX_NONE, Registry.NumSlots());
+		for (int32 i = 0; i < Slots.Num(); i++)
+		{
+			SlotToBody[Slots[i]] = i;
+		}
+		for (const int32 Source : Registry.Sources)
+		{
+			if (SlotToBody[Source] != INDEX_NONE)
+			{
+				MovingSources.Add(SlotToBody[Source]);
+				MovingMasses.Add(Registry.Masses[Source]);
+			}
+			else
+			{
+				FixedPositions.Add(Registry.Positions[Source]);
+				FixedMasses.Add(Registry.Masses[Source]);
+			}
+		}
+	}
+
+	virtual void GetAccelerations(const TArray<FVector>& Positions, TArray<FVector>& OutAccelerations) override
+	{
+		Batch.Reset(Positions.Num());
+		for (int32 i = 0; i < Positions.Num(); i++)
+		{
+			Batch.SetPosition(i, Positions[i]);
+		}
+		Accumulate(Positions);
+		for (int32 i = 0; i < Positions.Num(); i++)
+		{
+			OutAccelerations[i] = Batch.GetField(i);
+		}
+	}
+
+	virtual void GetAccelerationsFor(const TArray<FVector>& Positions, const TArray<int32>& Bodies, TArray<FVector>& OutAccelerations) override
+	{
+		Batch.Reset(Bodies.Num());
+		for (int32 k = 0; k < Bodies.Num(); k++)
+		{
+			Batch.SetPosition(k, Positions[Bodies[k]]);
+		}
+		Accumulate(Positions);
+		for (int32 k = 0; k < Bodies.Num(); k++)
+		{
+			OutAccelerations[k] = Batch.GetField(k);
+		}
+	}
+
+private:
+	void Accumulate(const TArray<FVector>& Positions)
+	{
+		for (int32 i = 0; i < FixedPositions.Num(); i++)
+		{
+			FGravityKernel::AccumulateSource(Batch, FixedPositions[i], FixedMasses[i], SofteningSq, bInverseSquare, bSimd);
+		}
+		for (int32 i = 0; i < MovingSources.Num(); i++)
+		{
+			FGravityKernel::AccumulateSource(Batch, Positions[MovingSources[i]], MovingMasses[i], SofteningSq, bInverseSquare, bSimd);//skips itself, zero distance
+		}
+	}
+
+	FGravityReceiverBatch& Batch;
+	float SofteningSq;
+	bool bInverseSquare;
+	bool bSimd;
+	TArray<FVector> FixedPositions;
+	TArray<float> FixedMasses;
+	TArray<int32> MovingSources;
+	TArray<float> MovingMasses;
+};
+
+// Physics still owns collisions, so integrated bodies are not teleported. Each frame we read
+// back where physics put them, integrate from there on fixed substeps, and hand physics the
+// velocity that carries them onto the integrated position over the coming frame.
+void UGravityManager::IntegrateBodies(float DeltaTime){
+	ORBIT_SCOPE_CYCLE_COUNTER(GravityIntegrate);
+	if (Integrator == EGravityIntegrator::PhysicsEngine || DeltaTime <= 0.f){
+		return;
+	}
+	const bool bBlockSteps = Integrator == EGravityIntegrator::Leapfrog && MaxTimestepRung > 0;
+	if (BlockTickRung != MaxTimestepRung){
+		// Open steps were laid out for the old rungs; close nothing, just start everyone over.
+		for (FIntegratedBodyState& State : IntegratedStates){
+			State.Block = FGravityBlockStepState();
 		}
+		BlockTick = 0;
+		BlockTickRung = MaxTimestepRung;
+	}
+
+	IntegratedSlots.Reset();
+	IntegratedStart.Reset();
+	IntegratedVelocities.Reset();
+	IntegratedBlocks.Reset();
+	RailsSlots.Reset();
+	for (const int32 Slot : Registry.Receivers)
+	{
+		if (!IsIntegrated(Slot)){
+			continue;
+		}
+		UPrimitiveComponent* Component = Registry.Components[Slot].Get();
+		FIntegratedBodyState& State = IntegratedStates[Slot];
+		const FVector PhysicsVelocity = Component->GetPhysicsLinearVelocity();
+		// Not what we handed over last frame, so something else (a hit, a script) changed it: take its word.
+		if (!State.bValid || (PhysicsVelocity - State.Drive).SizeSquared() > FMath::Square(1.f + 0.01f * State.Drive.Size())){
+			State.Velocity = PhysicsVelocity;
+			State.Block = FGravityBlockStepState();
+			State.bOnRails = false;
+			State.bValid = true;
+		}
+		if (State.bOnRails){
+			RailsSlots.Add(Slot);
+			continue;
+		}
+		IntegratedSlots.Add(Slot);
+		IntegratedStart.Add(Component->GetComponentLocation());
+		IntegratedVelocities.Add(State.Velocity);
+		IntegratedBlocks.Add(State.Block);
+	}
 
+	IntegratorAccumulator += DeltaTime;
+	int32 NumSteps = FMath::FloorToInt(IntegratorAccumulator / IntegratorSubstep);
+	IntegratorAccumulator -= NumSteps * IntegratorSubstep;
+	NumSteps = FMath::Min(NumSteps, MaxSubstepsPerFrame);
 
-		for (auto PlayerPair : Players){
-			Player = PlayerPair.Value;
-			PlayerStats = GetGravityBody(PlayerPair.Key);
-			GetGravityBody(PlayerPair.Key);
-			GravityDistanceVector = GravitationalBody->GetActorLocation() - Player->GetActorLocation();
-			PlayerStats.SetMagnitude((1.f * GravBodyMass) / FMath::Square(GravityDistanceVector.Size()));
-			PlayerStats.GravityVector += (GravityDistanceVector* PlayerStats.Magnitude);
-			SetGravityBody(PlayerPair.Key, PlayerStats);
+	IntegratedPositions = IntegratedStart;
+	FIntegratedBodyAccelerations Accelerations(Registry, IntegratedSlots, IntegratorBatch, GravitySoftening * GravitySoftening, Falloff == EGravityFalloff::InverseSquare, bUseSimdKernel);
+	if (bBlockSteps){
+		BodyIntegrator.AdvanceBlockLeapfrog(Accelerations, IntegratedPositions, IntegratedVelocities, IntegratedBlocks, IntegratorSubstep, MaxTimestepRung, TimestepAccuracy, BlockTick, NumSteps);
+	}
+	else{
+		BodyIntegrator.Advance(Integrator, Accelerations, IntegratedPositions, IntegratedVelocities, IntegratorSubstep, NumSteps);
+	}
+
+	for (int32 i = 0; i < IntegratedSlots.Num(); i++)
+	{
+		const int32 Slot = IntegratedSlots[i];
+		FIntegratedBodyState& State = IntegratedStates[Slot];
+		State.Velocity = IntegratedVelocities[i];
+		State.Block = IntegratedBlocks[i];
+		State.Drive = NumSteps > 0 ? (IntegratedPositions[i] - IntegratedStart[i]) / DeltaTime : State.Velocity;
+		Registry.Components[Slot]->SetPhysicsLinearVelocity(State.Drive);
+		if (bBlockSteps){
+			Registry.GravityVectors[Slot] = State.Block.Acceleration * Registry.Masses[Slot];
+			Registry.Magnitudes[Slot] = Registry.GravityVectors[Slot].Size();
 		}
 	}
-	for (auto ActiveBod : GravActiveBods){
-		if (ActiveBod.Value->IsValidLowLevel()){
-			ActiveBod.Value->GetStaticMeshComponent()->AddForce(GravityBodies[ActiveBod.Key].GravityVector);
+
+	UpdateRails(DeltaTime);
+}
+
+FVector UGravityManager::GetBodyVelocity(int32 Slot) const{
+	if (IsIntegrated(Slot) && IntegratedStates[Slot].bValid){
+		return IntegratedStates[Slot].Velocity;
+	}
+	const UPrimitiveComponent* Component = Registry.Components[Slot].Get();
+	return Component ? Component->GetComponentVelocity() : FVector::ZeroVector;
+}
+
+bool UGravityManager::IsOnRails(int32 Slot) const{
+	return IntegratedStates.IsValidIndex(Slot) && IntegratedStates[Slot].bOnRails && IsIntegrated(Slot);
+}
+
+int32 UGravityManager::FindDominantSource(const FVector& Position, int32 Self, float& OutPerturbation) const{
+	const float SofteningSq = GravitySoftening * GravitySoftening;
+	int32 Dominant = INDEX_NONE;
+	FVector DominantPull = FVector::ZeroVector;
+	FVector TotalPull = FVector::ZeroVector;
+	float DominantMagnitude = 0.f;
+	for (const int32 Source : Registry.Sources)
+	{
+		if (Source == Self){
+			continue;
+		}
+		const FVector Delta = Registry.Positions[Source] - Position;
+		const float DistSq = Delta.SizeSquared() + SofteningSq;
+		if (DistSq <= SMALL_NUMBER){
+			continue;
+		}
+		const float Magnitude = Registry.Masses[Source] / DistSq;
+		const FVector Pull = Delta * (Magnitude * FMath::InvSqrt(DistSq));
+		TotalPull += Pull;
+		if (Magnitude > DominantMagnitude){
+			DominantMagnitude = Magnitude;
+			DominantPull = Pull;
+			Dominant = Source;
 		}
 	}
-	for (auto PlayerPair : Players){
-		if (PlayerPair.Value->IsValidLowLevel()){
-			PlayerPair.Value->GetCapsuleComponent()->AddForce(GravityBodies[PlayerPair.Key].GravityVector);
+	OutPerturbation = Dominant != INDEX_NONE ? (TotalPull - DominantPull).Size() / DominantMagnitude : 0.f;
+	return Dominant;
+}
+
+float UGravityManager::GetRailsMinRadius(int32 Primary) const{
+	const UPrimitiveComponent* Component = Registry.Components[Primary].Get();
+	return (Component ? Component->Bounds.SphereRadius : 0.f) + RailsClearance;
+}
+
+// A body on rails costs one Kepler solve per frame and a perturbation check every
+// RailsCheckInterval frames, instead of force evaluations every substep. The orbit is kept
+// relative to the primary's current position and velocity, so it follows a primary that moves.
+void UGravityManager::UpdateRails(float DeltaTime){
+	const bool bRails = bUseKeplerRails && Falloff == EGravityFalloff::InverseSquare;
+	const int32 CheckInterval = FMath::Max(RailsCheckInterval, 1);//ClampMin doesn't hold for Blueprint sets
+	RailsFrame++;
+
+	for (const int32 Slot : RailsSlots)
+	{
+		FIntegratedBodyState& State = IntegratedStates[Slot];
+		const int32 Primary = State.RailsPrimary.Index;
+		FVector R, V;
+		State.RailsTime += DeltaTime;
+		if (!bRails || !Registry.IsValid(State.RailsPrimary) || !State.Orbit.Propagate(State.RailsTime, R, V)){
+			State.bOnRails = false;//integrated again from next frame, with the velocity it has now
+			State.Block = FGravityBlockStepState();
+			continue;
+		}
+
+		UPrimitiveComponent* Component = Registry.Components[Slot].Get();
+		const FVector Target = Registry.Positions[Primary] + R;
+		State.Velocity = GetBodyVelocity(Primary) + V;
+		State.Drive = (Target - Component->GetComponentLocation()) / DeltaTime;
+		Component->SetPhysicsLinearVelocity(State.Drive);
+
+		const float RadiusSq = R.SizeSquared();
+		const float PrimaryMagnitude = Registry.Masses[Primary] / RadiusSq;
+		Registry.GravityVectors[Slot] = -R * (PrimaryMagnitude * FMath::InvSqrt(RadiusSq) * Registry.Masses[Slot]);
+		Registry.Magnitudes[Slot] = PrimaryMagnitude * Registry.Masses[Slot];
+
+		if ((RailsFrame + Slot) % CheckInterval == 0){
+			float Perturbation = 0.f;
+			const int32 Dominant = FindDominantSource(Target, Slot, Perturbation);
+			if (Dominant != Primary || Perturbation > RailsPerturbationThreshold || RadiusSq < FMath::Square(GetRailsMinRadius(Primary))){
+				State.bOnRails = false;
+				State.Block = FGravityBlockStepState();
+			}
+		}
+	}
+
+	if (!bRails){
+		return;
+	}
+	for (int32 i = 0; i < IntegratedSlots.Num(); i++)
+	{
+		const int32 Slot = IntegratedSlots[i];
+		if ((RailsFrame + Slot) % CheckInterval != 0){
+			continue;
+		}
+		float Perturbation = 0.f;
+		const int32 Primary = FindDominantSource(IntegratedPositions[i], Slot, Perturbation);
+		if (Primary == INDEX_NONE || Perturbation > RailsPerturbationThreshold){
+			continue;
+		}
+		FIntegratedBodyState& State = IntegratedStates[Slot];
+		State.Orbit.Init(IntegratedPositions[i] - Registry.Positions[Primary], State.Velocity - GetBodyVelocity(Primary), Registry.Masses[Primary]);
+		if (State.Orbit.GetPeriapsis() < GetRailsMinRadius(Primary)){
+			continue;//would come down to the surface, keep integrating so physics gets it right
 		}
+		State.RailsPrimary = Registry.GetHandle(Primary);
+		State.RailsTime = 0.0;
+		State.bOnRails = true;
+	}
+}
+
+FGravityBodyHandle UGravityManager::FindGravityBody(const FString& Name) const{
+	return Registry.Find(Name);
+}
+
+FGravityBody UGravityManager::GetGravityBody(FGravityBodyHandle Handle) const{
+	FGravityBody GB;
+	if (Registry.IsValid(Handle)){
+		GB.GravityVector = Registry.GravityVectors[Handle.Index];
+		GB.Magnitude = Registry.Magnitudes[Handle.Index];
+	}
+	return GB;
+}
+
+void UGravityManager::GetGravity(const TArray<FGravityBodyHandle>& Handles, TArray<FVector>& OutVectors, TArray<float>& OutMagnitudes) const{
+	OutVectors.SetNumUninitialized(Handles.Num());
+	OutMagnitudes.SetNumUninitialized(Handles.Num());
+	for (int32 i = 0; i < Handles.Num(); i++){
+		const bool bValid = Registry.IsValid(Handles[i]);
+		OutVectors[i] = bValid ? Registry.GravityVectors[Handles[i].Index] : FVector::ZeroVector;
+		OutMagnitudes[i] = bValid ? Registry.Magnitudes[Handles[i].Index] : 0.f;
 	}
 }
 
-//Adds new GravityBody if it doesn't already exist, then returns reference to it.
 FGravityBody UGravityManager::GetGravityBody(FString Name){
-	if (!GravityBodies.Contains(Name)){
-		UE_LOG(LogTemp, Warning, TEXT("Added Gravity Body:%s"), *Name);
-		GravityBodies.Add(Name, FGravityBody());
+	const FGravityBodyHandle Handle = Registry.Find(Name);
+	if (!Handle.IsSet()){
+		ORBIT_TRACE(MissingGravityBody, this, FCrc::StrCrc32(*Name));
 	}
-	return GravityBodies[Name];
+	return GetGravityBody(Handle);
 }
 
 bool UGravityManager::SetGravityBody(FString Name, FGravityBody GB){
-	if (!GravityBodies.Contains(Name)){
-		UE_LOG(LogTemp, Warning, TEXT("Missing Gravity Body:%s"), *Name);
+	const FGravityBodyHandle Handle = Registry.Find(Name);
+	if (!Registry.IsValid(Handle)){
+		ORBIT_TRACE(MissingGravityBody, this, FCrc::StrCrc32(*Name));
 		return 0;
 	}
-	GravityBodies[Name] = GB;
+	Registry.GravityVectors[Handle.Index] = GB.GravityVector;
+	Registry.Magnitudes[Handle.Index] = GB.Magnitude;
 	return 1;
 }
-
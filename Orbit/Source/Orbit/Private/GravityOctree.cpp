@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "GravityOctree.h"
+
+void FGravityOctree::Build(const TArray<FVector>& Positions, const TArray<float>& Masses)
+{
+	check(Positions.Num() == Masses.Num());
+
+	ScratchPositions.Reset(Positions.Num());
+	for (const FVector& Position : Positions)
+	{
+		ScratchPositions.Add(ToOrbitCore(Position));
+	}
+	Tree.Build(ScratchPositions.GetData(), Masses.GetData(), Positions.Num());
+}
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "GravityPlanetCollision.h"
+
+void FGravityPlanetCollision::Add(AActor* Actor, float Radius)
+{
+	check(Actor);
+	for (int32 i = 0; i < Actors.Num(); i++)
+	{
+		if (Actors[i].Get() == Actor)
+		{
+			Radii[i] = Radius;
+			return;
+		}
+	}
+	Actors.Add(Actor);
+	Centers.Add(Actor->GetActorLocation());
+	Radii.Add(Radius);
+}
+
+void FGravityPlanetCollision::Remove(AActor* Actor)
+{
+	for (int32 i = 0; i < Actors.Num(); i++)
+	{
+		if (Actors[i].Get() == Actor)
+		{
+			Actors.RemoveAtSwap(i);
+			Centers.RemoveAtSwap(i);
+			Radii.RemoveAtSwap(i);
+			return;
+		}
+	}
+}
+
+void FGravityPlanetCollision::Empty()
+{
+	Actors.Empty();
+	Centers.Empty();
+	Radii.Empty();
+}
+
+void FGravityPlanetCollision::SyncCenters()
+{
+	for (int32 i = Actors.Num() - 1; i >= 0; i--)
+	{
+		const AActor* Actor = Actors[i].Get();
+		if (!Actor)
+		{
+			Actors.RemoveAtSwap(i);
+			Centers.RemoveAtSwap(i);
+			Radii.RemoveAtSwap(i);
+			continue;
+		}
+		Centers[i] = Actor->GetActorLocation();
+	}
+}
+
+bool FGravityPlanetCollision::SweepCapsule(const FVector& Start, const FVector& End, const FVector& Axis, float CapsuleRadius, float CapsuleHalfHeight, FGravityPlanetHit& OutHit) const
+{
+	bool bHit = false;
+	FGravityPlanetHit Hit;
+	for (int32 i = 0; i < Centers.Num(); i++)
+	{
+		if (SweepCapsuleSphere(Centers[i], Radii[i], Start, End, Axis, CapsuleRadius, CapsuleHalfHeight, Hit)
+			&& (!bHit || Hit.Time < OutHit.Time || (Hit.bStartPenetrating && Hit.PenetrationDepth > OutHit.PenetrationDepth)))
+		{
+			OutHit = Hit;
+			OutHit.Planet = i;
+			bHit = true;
+		}
+	}
+	return bHit;
+}
+
+// Done from the capsule's point of view: the sphere's center moves against it from Center - Start
+// along Start - End, and the first time it comes within SphereRadius + CapsuleRadius of the
+// capsule's segment is a ray against a fattened capsule. That is the cylinder around the segment
+// and the spheres on its ends, whichever is entered first.
+bool FGravityPlanetCollision::SweepCapsuleSphere(const FVector& Center, float SphereRadius, const FVector& Start, const FVector& End, const FVector& Axis, float CapsuleRadius, float CapsuleHalfHeight, FGravityPlanetHit& OutHit)
+{
+	const FVector Delta = End - Start;
+	const float HalfSegment = FMath::Max(CapsuleHalfHeight - CapsuleRadius, 0.f);
+	const float Reach = SphereRadius + CapsuleRadius;
+	const float ReachSq = Reach * Reach;
+	const FVector Origin = Center - Start;
+	const FVector Dir = -Delta;
+
+	// Already touching.
+	const float StartAlong = FMath::Clamp(FVector::DotProduct(Origin, Axis), -HalfSegment, HalfSegment);
+	const FVector StartOffset = Axis * StartAlong - Origin;//planet center to the nearest point of the segment
+	const float StartDistSq = StartOffset.SizeSquared();
+	if (StartDistSq < ReachSq)
+	{
+		const float StartDist = FMath::Sqrt(StartDistSq);
+		OutHit.Time = 0.f;
+		OutHit.Location = Start;
+		OutHit.Normal = StartDist > KINDA_SMALL_NUMBER ? StartOffset / StartDist : Axis;
+		OutHit.ImpactPoint = Center + OutHit.Normal * SphereRadius;
+		OutHit.bStartPenetrating = true;
+		OutHit.PenetrationDepth = Reach - StartDist;
+		return true;
+	}
+
+	float Best = 2.f;
+
+	// Cylinder, only where it lies along the segment.
+	const FVector OriginPerp = Origin - Axis * FVector::DotProduct(Origin, Axis);
+	const FVector DirPerp = Dir - Axis * FVector::DotProduct(Dir, Axis);
+	const float A = DirPerp.SizeSquared();
+	if (A > SMALL_NUMBER)
+	{
+		const float B = FVector::DotProduct(OriginPerp, DirPerp);
+		const float C = OriginPerp.SizeSquared() - ReachSq;
+		const float Disc = B * B - A * C;
+		if (Disc >= 0.f)
+		{
+			const float T = (-B - FMath::Sqrt(Disc)) / A;
+			const float Along = FVector::DotProduct(Origin + Dir * T, Axis);
+			if (T >= 0.f && T <= 1.f && FMath::Abs(Along) <= HalfSegment)
+			{
+				Best = T;
+			}
+		}
+	}
+
+	// Ends.
+	const float DirSq = Dir.SizeSquared();
+	if (DirSq > SMALL_NUMBER)
+	{
+		for (int32 Side = -1; Side <= 1; Side += 2)
+		{
+			const FVector Offset = Origin - Axis * (Side * HalfSegment);
+			const float B = FVector::DotProduct(Offset, Dir);
+			const float C = Offset.SizeSquared() - ReachSq;
+			const float Disc = B * B - DirSq * C;
+			if (Disc >= 0.f)
+			{
+				const float T = (-B - FMath::Sqrt(Disc)) / DirSq;
+				if (T >= 0.f && T < Best)
+				{
+					Best = T;
+				}
+			}
+		}
+	}
+
+	if (Best > 1.f)
+	{
+		return false;
+	}
+
+	const float Along = FMath::Clamp(FVector::DotProduct(Origin + Dir * Best, Axis), -HalfSegment, HalfSegment);
+	OutHit.Time = Best;
+	OutHit.Location = Start + Delta * Best;
+	OutHit.Normal = (OutHit.Location + Axis * Along - Center).GetSafeNormal();
+	OutHit.ImpactPoint = Center + OutHit.Normal * SphereRadius;
+	OutHit.bStartPenetrating = false;
+	OutHit.PenetrationDepth = 0.f;
+	return true;
+}
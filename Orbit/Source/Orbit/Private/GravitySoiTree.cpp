@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "GravitySoiTree.h"
+
+FGravitySoiTree::FGravitySoiTree()
+	: Root(INDEX_NONE)
+{
+}
+
+void FGravitySoiTree::Reset()
+{
+	Bodies.Reset();
+	Order.Reset();
+	Root = INDEX_NONE;
+}
+
+void FGravitySoiTree::Build(const TArray<FVector>& Positions, const TArray<float>& Masses)
+{
+	check(Positions.Num() == Masses.Num());
+	Reset();
+
+	Bodies.AddUninitialized(Positions.Num());
+	for (int32 i = 0; i < Positions.Num(); i++)
+	{
+		FBody& Body = Bodies[i];
+		Body.Position = Positions[i];
+		Body.Mass = Masses[i];
+		Body.SoiRadius = 0.f;
+		Body.SoiRadiusSq = 0.f;
+		Body.Parent = INDEX_NONE;
+		Body.FirstChild = INDEX_NONE;
+		Body.NextSibling = INDEX_NONE;
+		Body.bInTree = false;
+		if (Masses[i] > 0.f)
+		{
+			Order.Add(i);
+		}
+	}
+	if (Order.Num() == 0)
+	{
+		return;
+	}
+
+	// Heaviest first, index as tie break so equal masses always build the same tree.
+	const TArray<FBody>& BodiesRef = Bodies;
+	Order.Sort([&BodiesRef](int32 A, int32 B)
+	{
+		return BodiesRef[A].Mass > BodiesRef[B].Mass || (BodiesRef[A].Mass == BodiesRef[B].Mass && A < B);
+	});
+
+	Root = Order[0];
+	Bodies[Root].SoiRadius = MAX_FLT;
+	Bodies[Root].SoiRadiusSq = MAX_FLT;
+	Bodies[Root].bInTree = true;
+
+	for (int32 k = 1; k < Order.Num(); k++)
+	{
+		const int32 Index = Order[k];
+		FBody& Body = Bodies[Index];
+		const int32 Parent = Descend(Root, Body.Position);//only heavier bodies are linked in yet
+		FBody& ParentBody = Bodies[Parent];
+
+		Body.SoiRadius = FVector::Dist(Body.Position, ParentBody.Position) * FMath::Pow(Body.Mass / ParentBody.Mass, 0.4f);
+		Body.SoiRadiusSq = Body.SoiRadius * Body.SoiRadius;
+		Body.Parent = Parent;
+		Body.NextSibling = ParentBody.FirstChild;
+		Body.bInTree = true;
+		ParentBody.FirstChild = Index;
+	}
+}
+
+int32 FGravitySoiTree::Descend(int32 Body, const FVector& Point) const
+{
+	for (;;)
+	{
+		int32 Child = Bodies[Body].FirstChild;
+		while (Child != INDEX_NONE && FVector::DistSquared(Point, Bodies[Child].Position) > Bodies[Child].SoiRadiusSq)
+		{
+			Child = Bodies[Child].NextSibling;
+		}
+		if (Child == INDEX_NONE)
+		{
+			return Body;
+		}
+		Body = Child;
+	}
+}
+
+int32 FGravitySoiTree::FindSoi(const FVector& Point, int32 Hint) const
+{
+	if (Root == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+
+	int32 Body = Contains(Hint) ? Hint : Root;
+	while (Bodies[Body].Parent != INDEX_NONE && FVector::DistSquared(Point, Bodies[Body].Position) > Bodies[Body].SoiRadiusSq)
+	{
+		Body = Bodies[Body].Parent;//left this SOI
+	}
+	return Descend(Body, Point);
+}
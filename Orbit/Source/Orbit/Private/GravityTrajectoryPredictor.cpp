@@ -0,0 +1,300 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "GravityTrajectoryPredictor.h"
+#include "GravityKernel.h"
+
+struct FGravityTrajectoryPredictor::FJob
+{
+	FSourceSnapshotPtr Sources;
+	int32 ExcludeSource;	// the body's own entry in Sources when it is a source too
+	FGravityTrajectorySettings Settings;
+	int32 NumPoints;
+	bool bFull;				// started over, rather than extending the previous path
+	double StartTime;
+	TArray<FVector> Points;	// comes in holding the kept points (or just the start state)
+	TArray<FVector> Velocities;
+	FThreadSafeCounter Done;
+};
+
+class FGravityTrajectoryTask : public FNonAbandonableTask
+{
+	friend class FAutoDeleteAsyncTask<FGravityTrajectoryTask>;
+
+	FGravityTrajectoryPredictor::FJobPtr Job;
+
+	FGravityTrajectoryTask(const FGravityTrajectoryPredictor::FJobPtr& InJob)
+		: Job(InJob)
+	{
+	}
+
+	void DoWork()
+	{
+		FGravityTrajectoryPredictor::Run(*Job);
+		Job->Done.Increment();
+	}
+
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FGravityTrajectoryTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+};
+
+// The frozen sources, with the same kernel as the manager's solve.
+class FSnapshotAccelerations : public IGravityAccelerationSource
+{
+public:
+	FSnapshotAccelerations(const TArray<FVector>& InPositions, const TArray<float>& InMasses, int32 InExclude, float InSofteningSq, bool bInInverseSquare)
+		: Positions(InPositions)
+		, Masses(InMasses)
+		, Exclude(InExclude)
+		, SofteningSq(InSofteningSq)
+		, bInverseSquare(bInInverseSquare)
+	{
+	}
+
+	virtual void GetAccelerations(const TArray<FVector>& Bodies, TArray<FVector>& OutAccelerations) override
+	{
+		for (int32 i = 0; i < Bodies.Num(); i++)
+		{
+			OutAccelerations[i] = GetAcceleration(Bodies[i]);
+		}
+	}
+
+	virtual void GetAccelerationsFor(const TArray<FVector>& Bodies, const TArray<int32>& Indices, TArray<FVector>& OutAccelerations) override
+	{
+		for (int32 k = 0; k < Indices.Num(); k++)
+		{
+			OutAccelerations[k] = GetAcceleration(Bodies[Indices[k]]);
+		}
+	}
+
+private:
+	FVector GetAcceleration(const FVector& Point) const
+	{
+		FVector Field = FVector::ZeroVector;
+		float Magnitude = 0.f;
+		for (int32 i = 0; i < Positions.Num(); i++)
+		{
+			if (i != Exclude)
+			{
+				FGravityKernel::AccumulatePair(Point, Positions[i], Masses[i], SofteningSq, bInverseSquare, Field, Magnitude);
+			}
+		}
+		return Field;
+	}
+
+	const TArray<FVector>& Positions;
+	const TArray<float>& Masses;
+	int32 Exclude;
+	float SofteningSq;
+	bool bInverseSquare;
+};
+
+bool FGravityTrajectory::Sample(double Time, FVector& OutPosition, FVector& OutVelocity) const
+{
+	if (Points.Num() < 2 || Interval <= 0.f)
+	{
+		return false;
+	}
+	const double T = (Time - StartTime) / Interval;
+	if (T < 0.0 || T > Points.Num() - 1)
+	{
+		return false;
+	}
+
+	// Cubic Hermite on position, since we have the velocities anyway; linear is off by a*dt^2/8.
+	const int32 i = FMath::Min((int32)T, Points.Num() - 2);
+	const float U = (float)(T - i);
+	const float U2 = U * U;
+	const float U3 = U2 * U;
+	OutPosition = Points[i] * (2.f * U3 - 3.f * U2 + 1.f)
+		+ Velocities[i] * ((U3 - 2.f * U2 + U) * Interval)
+		+ Points[i + 1] * (-2.f * U3 + 3.f * U2)
+		+ Velocities[i + 1] * ((U3 - U2) * Interval);
+	OutVelocity = FMath::Lerp(Velocities[i], Velocities[i + 1], U);
+	return true;
+}
+
+void FGravityTrajectoryPredictor::Request(FGravityBodyHandle Body, float Duration)
+{
+	Requests.FindOrAdd(Body).Duration = FMath::Max(Duration, 0.f);
+}
+
+void FGravityTrajectoryPredictor::Cancel(FGravityBodyHandle Body)
+{
+	Requests.Remove(Body);
+}
+
+void FGravityTrajectoryPredictor::Reset()
+{
+	Requests.Empty();
+	FrameSnapshot.Reset();
+}
+
+const FGravityTrajectory* FGravityTrajectoryPredictor::Find(FGravityBodyHandle Body) const
+{
+	const FRequest* Request = Requests.Find(Body);
+	return Request && Request->Front.Points.Num() > 0 ? &Request->Front : NULL;
+}
+
+int32 FGravityTrajectoryPredictor::GetNumInFlight() const
+{
+	int32 Count = 0;
+	for (auto It = Requests.CreateConstIterator(); It; ++It)
+	{
+		Count += It.Value().Job.IsValid() ? 1 : 0;
+	}
+	return Count;
+}
+
+void FGravityTrajectoryPredictor::Update(const FGravityBodyRegistry& Registry, const FGravityTrajectorySettings& Settings, double Now)
+{
+	FrameSnapshot.Reset();
+	for (auto It = Requests.CreateIterator(); It; ++It)
+	{
+		const FGravityBodyHandle Body = It.Key();
+		FRequest& Request = It.Value();
+		if (!Registry.IsValid(Body))
+		{
+			It.RemoveCurrent();//a running job keeps itself alive and is dropped when done
+			continue;
+		}
+		if (Request.Job.IsValid())
+		{
+			if (Request.Job->Done.GetValue() == 0)
+			{
+				continue;
+			}
+			Publish(Request);
+		}
+
+		const int32 Slot = Body.Index;
+		const AActor* Actor = Registry.Actors[Slot].Get();
+		const FVector& Position = Registry.Positions[Slot];
+		const FVector Velocity = Actor ? Actor->GetVelocity() : FVector::ZeroVector;
+		const int32 NumPoints = FMath::Max(FMath::CeilToInt(Request.Duration / Settings.Interval), 1) + 1;
+		const FGravityTrajectory& Front = Request.Front;
+
+		bool bFull = Front.Points.Num() != NumPoints || Front.Interval != Settings.Interval
+			|| !Request.BaseSnapshot.IsValid() || SourcesChanged(Registry, *Request.BaseSnapshot, Slot, Settings.SourceTolerance);
+		if (!bFull)
+		{
+			FVector PredictedPosition, PredictedVelocity;
+			bFull = !Front.Sample(Now, PredictedPosition, PredictedVelocity)
+				|| FVector::DistSquared(PredictedPosition, Position) > FMath::Square(Settings.PositionTolerance)
+				|| FVector::DistSquared(PredictedVelocity, Velocity) > FMath::Square(Settings.VelocityTolerance);
+		}
+		if (bFull)
+		{
+			Launch(Request, Slot, Registry, Settings, Position, Velocity, Now, 0);
+			continue;
+		}
+
+		// Still on the path: only the intervals now behind us need replacing at the far end.
+		const int32 Elapsed = FMath::FloorToInt((Now - Front.StartTime) / Front.Interval);
+		if (Elapsed > 0)
+		{
+			Launch(Request, Slot, Registry, Settings, Position, Velocity, Front.StartTime + Elapsed * Front.Interval, NumPoints - Elapsed);
+		}
+	}
+}
+
+void FGravityTrajectoryPredictor::Launch(FRequest& Request, int32 Slot, const FGravityBodyRegistry& Registry, const FGravityTrajectorySettings& Settings, const FVector& Position, const FVector& Velocity, double StartTime, int32 NumKept)
+{
+	if (!FrameSnapshot.IsValid())
+	{
+		FSourceSnapshot* Snapshot = new FSourceSnapshot();
+		for (const int32 Source : Registry.Sources)
+		{
+			Snapshot->Slots.Add(Source);
+			Snapshot->Positions.Add(Registry.Positions[Source]);
+			Snapshot->Masses.Add(Registry.Masses[Source]);
+		}
+		FrameSnapshot = MakeShareable(Snapshot);
+	}
+
+	FJobPtr Job = MakeShareable(new FJob());
+	Job->Sources = FrameSnapshot;
+	Job->ExcludeSource = FrameSnapshot->Slots.Find(Slot);
+	Job->Settings = Settings;
+	Job->NumPoints = FMath::Max(FMath::CeilToInt(Request.Duration / Settings.Interval), 1) + 1;
+	Job->bFull = NumKept == 0;
+	Job->StartTime = StartTime;
+
+	// The back buffer travels with the job so a steady state allocates nothing.
+	Job->Points = MoveTemp(Request.BackPoints);
+	Job->Velocities = MoveTemp(Request.BackVelocities);
+	Job->Points.Reset();
+	Job->Velocities.Reset();
+	if (NumKept > 0)
+	{
+		const int32 First = Request.Front.Points.Num() - NumKept;
+		Job->Points.Append(Request.Front.Points.GetData() + First, NumKept);
+		Job->Velocities.Append(Request.Front.Velocities.GetData() + First, NumKept);
+	}
+	else
+	{
+		Job->Points.Add(Position);
+		Job->Velocities.Add(Velocity);
+	}
+
+	Request.Job = Job;
+	(new FAutoDeleteAsyncTask<FGravityTrajectoryTask>(Job))->StartBackgroundTask();
+}
+
+void FGravityTrajectoryPredictor::Run(FJob& Job)
+{
+	const FSourceSnapshot& Sources = *Job.Sources;
+	FSnapshotAccelerations Accelerations(Sources.Positions, Sources.Masses, Job.ExcludeSource, Job.Settings.SofteningSq, Job.Settings.bInverseSquare);
+	FGravityIntegrator Integrator;
+	const int32 Substeps = FMath::Max(Job.Settings.SubstepsPerPoint, 1);
+	const float Substep = Job.Settings.Interval / Substeps;
+
+	TArray<FVector> X, V;
+	X.Add(Job.Points.Last());
+	V.Add(Job.Velocities.Last());
+	while (Job.Points.Num() < Job.NumPoints)
+	{
+		Integrator.Advance(Job.Settings.Method, Accelerations, X, V, Substep, Substeps);
+		Job.Points.Add(X[0]);
+		Job.Velocities.Add(V[0]);
+	}
+}
+
+void FGravityTrajectoryPredictor::Publish(FRequest& Request)
+{
+	FJob& Job = *Request.Job;
+	FGravityTrajectory& Front = Request.Front;
+	Exchange(Front.Points, Job.Points);
+	Exchange(Front.Velocities, Job.Velocities);
+	Request.BackPoints = MoveTemp(Job.Points);
+	Request.BackVelocities = MoveTemp(Job.Velocities);
+	Front.StartTime = Job.StartTime;
+	Front.Interval = Job.Settings.Interval;
+	Front.Revision++;
+	if (Job.bFull)
+	{
+		Request.BaseSnapshot = Job.Sources;
+	}
+	Request.Job.Reset();
+}
+
+bool FGravityTrajectoryPredictor::SourcesChanged(const FGravityBodyRegistry& Registry, const FSourceSnapshot& Snapshot, int32 Self, float Tolerance)
+{
+	if (Registry.Sources.Num() != Snapshot.Slots.Num())
+	{
+		return true;
+	}
+	const float ToleranceSq = Tolerance * Tolerance;
+	for (int32 i = 0; i < Snapshot.Slots.Num(); i++)
+	{
+		const int32 Source = Registry.Sources[i];
+		if (Source != Snapshot.Slots[i] || Registry.Masses[Source] != Snapshot.Masses[i]
+			|| (Source != Self && FVector::DistSquared(Registry.Positions[Source], Snapshot.Positions[i]) > ToleranceSq))
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "KeplerOrbit.h"
+
+FKeplerOrbit::FKeplerOrbit()
+	: Mu(0.0)
+	, SqrtMu(0.0)
+	, RadiusAtEpoch(0.0)
+	, RadialSpeed(0.0)
+	, Alpha(0.0)
+{
+	R0[0] = R0[1] = R0[2] = 0.0;
+	V0[0] = V0[1] = V0[2] = 0.0;
+}
+
+void FKeplerOrbit::Init(const FVector& R, const FVector& V, float InMu)
+{
+	R0[0] = R.X; R0[1] = R.Y; R0[2] = R.Z;
+	V0[0] = V.X; V0[1] = V.Y; V0[2] = V.Z;
+	Mu = InMu;
+	SqrtMu = sqrt(Mu);
+
+	RadiusAtEpoch = sqrt(R0[0] * R0[0] + R0[1] * R0[1] + R0[2] * R0[2]);
+	const double SpeedSq = V0[0] * V0[0] + V0[1] * V0[1] + V0[2] * V0[2];
+	RadialSpeed = (R0[0] * V0[0] + R0[1] * V0[1] + R0[2] * V0[2]) / RadiusAtEpoch;
+	Alpha = 2.0 / RadiusAtEpoch - SpeedSq / Mu;
+}
+
+double FKeplerOrbit::StumpffC(double Z)
+{
+	if (Z > 1e-6)
+	{
+		return (1.0 - cos(sqrt(Z))) / Z;
+	}
+	if (Z < -1e-6)
+	{
+		return (cosh(sqrt(-Z)) - 1.0) / -Z;
+	}
+	return 0.5 - Z / 24.0 + Z * Z / 720.0;
+}
+
+double FKeplerOrbit::StumpffS(double Z)
+{
+	if (Z > 1e-6)
+	{
+		const double SqrtZ = sqrt(Z);
+		return (SqrtZ - sin(SqrtZ)) / (SqrtZ * SqrtZ * SqrtZ);
+	}
+	if (Z < -1e-6)
+	{
+		const double SqrtZ = sqrt(-Z);
+		return (sinh(SqrtZ) - SqrtZ) / (SqrtZ * SqrtZ * SqrtZ);
+	}
+	return 1.0 / 6.0 - Z / 120.0 + Z * Z / 5040.0;
+}
+
+double FKeplerOrbit::GetPeriod() const
+{
+	return Alpha > 0.0 ? 2.0 * PI / (SqrtMu * Alpha * sqrt(Alpha)) : 0.0;
+}
+
+double FKeplerOrbit::GetPeriapsis() const
+{
+	// h^2 / mu = a (1 - e^2), and rp = a (1 - e) = h^2 / (mu (1 + e)) holds for every conic.
+	const double HX = R0[1] * V0[2] - R0[2] * V0[1];
+	const double HY = R0[2] * V0[0] - R0[0] * V0[2];
+	const double HZ = R0[0] * V0[1] - R0[1] * V0[0];
+	const double HSq = HX * HX + HY * HY + HZ * HZ;
+	const double ESq = FMath::Max(0.0, 1.0 - HSq * Alpha / Mu);
+	return HSq / (Mu * (1.0 + sqrt(ESq)));
+}
+
+bool FKeplerOrbit::Propagate(double Time, FVector& OutR, FVector& OutV) const
+{
+	// Closed orbits repeat, and Newton behaves much better on less than one lap.
+	const double Period = GetPeriod();
+	if (Period > 0.0)
+	{
+		Time = fmod(Time, Period);
+	}
+
+	// Solve the universal Kepler equation for Chi (Curtis Algorithm 3.3).
+	const double R0VR0 = RadiusAtEpoch * RadialSpeed / SqrtMu;
+	const double OneMinusAlphaR0 = 1.0 - Alpha * RadiusAtEpoch;
+	double Chi = SqrtMu * FMath::Abs(Alpha) * Time;
+	if (Alpha <= 1e-12)
+	{
+		Chi = SqrtMu * Time / RadiusAtEpoch;//parabolic/hyperbolic: start from the straight-line guess
+	}
+
+	bool bConverged = false;
+	for (int32 Iteration = 0; Iteration < MaxIterations; Iteration++)
+	{
+		const double Z = Alpha * Chi * Chi;
+		const double C = StumpffC(Z);
+		const double S = StumpffS(Z);
+		const double F = R0VR0 * Chi * Chi * C + OneMinusAlphaR0 * Chi * Chi * Chi * S + RadiusAtEpoch * Chi - SqrtMu * Time;
+		const double DF = R0VR0 * Chi * (1.0 - Z * S) + OneMinusAlphaR0 * Chi * Chi * C + RadiusAtEpoch;
+		const double Step = F / DF;
+		Chi -= Step;
+		if (FMath::Abs(Step) <= 1e-9 * FMath::Max(1.0, FMath::Abs(Chi)))
+		{
+			bConverged = true;
+			break;
+		}
+	}
+	if (!bConverged || Chi != Chi)
+	{
+		return false;
+	}
+
+	// Lagrange coefficients.
+	const double Z = Alpha * Chi * Chi;
+	const double C = StumpffC(Z);
+	const double S = StumpffS(Z);
+	const double Fc = 1.0 - Chi * Chi / RadiusAtEpoch * C;
+	const double Gc = Time - Chi * Chi * Chi / SqrtMu * S;
+	double R[3];
+	for (int32 i = 0; i < 3; i++)
+	{
+		R[i] = Fc * R0[i] + Gc * V0[i];
+	}
+	const double Radius = sqrt(R[0] * R[0] + R[1] * R[1] + R[2] * R[2]);
+	const double FDot = SqrtMu / (Radius * RadiusAtEpoch) * (Alpha * Chi * Chi * Chi * S - Chi);
+	const double GDot = 1.0 - Chi * Chi / Radius * C;
+
+	OutR = FVector(R[0], R[1], R[2]);
+	OutV = FVector(FDot * R0[0] + GDot * V0[0], FDot * R0[1] + GDot * V0[1], FDot * R0[2] + GDot * V0[2]);
+	return true;
+}
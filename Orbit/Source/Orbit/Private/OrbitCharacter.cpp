@@ -2,8 +2,11 @@
 #include "Orbit.h"
 #include "OrbitCharacter.h"
 #include "OrbitProjectile.h"
+#include "OrbitProjectileManager.h"
+#include "OrbitProjectilePool.h"
 #include "Animation/AnimInstance.h"
 #include "OrbitCharacterMovementComponent.h"
+#include "UnrealNetwork.h"
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -29,6 +32,10 @@ AOrbitCharacter::AOrbitCharacter(const FObjectInitializer& ObjectInitializer)
 
 	// Default offset from the character location for projectiles to spawn
 	GunOffset = FVector(100.0f, 30.0f, 10.0f);
+	bBatchProjectiles = false;
+	bPoolProjectiles = true;
+	ProjectileMesh = NULL;
+	bGravityRelativeReplication = true;
 
 	//Mesh = ObjectInitializer.CreateDefaultSubobject<USkeletalMeshComponent>(this, TEXT("CharacterMesh0"));
 	// Create a mesh component that will be used when being viewed from a '1st person' view (when controlling this pawn)
@@ -41,6 +48,55 @@ AOrbitCharacter::AOrbitCharacter(const FObjectInitializer& ObjectInitializer)
 	//	Mesh1P->AttachParent = GetCapsuleComponent();
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Replication
+
+void AOrbitCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(AOrbitCharacter, OrbitReplicatedMovement, COND_SimulatedOrPhysics);
+}
+
+/* Only one of the two movements goes out. Ours is filled in here from where we are now, the way
+   AActor::GatherCurrentMovement fills ReplicatedMovement. The autonomous proxy's ServerMove calls
+   are the engine's and unchanged.
+*/
+void AOrbitCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	const bool bRelative = bGravityRelativeReplication && bReplicateMovement && !GetAttachParentActor();
+	if (bRelative)
+	{
+		UOrbitCharacterMovementComponent* Movement = Cast<UOrbitCharacterMovementComponent>(GetCharacterMovement());
+		AActor* Body = Movement ? Movement->FindNearestPlanet(GetActorLocation()) : NULL;
+		OrbitReplicatedMovement.Set(Body, GetActorLocation(), GetVelocity(), GetActorRotation());
+	}
+	DOREPLIFETIME_ACTIVE_OVERRIDE(AActor, ReplicatedMovement, bReplicateMovement && !bRelative);
+	DOREPLIFETIME_ACTIVE_OVERRIDE(AOrbitCharacter, OrbitReplicatedMovement, bRelative);
+}
+
+void AOrbitCharacter::OnRep_OrbitReplicatedMovement()
+{
+	FVector Location, Velocity;
+	FRotator Rotation;
+	if (!OrbitReplicatedMovement.Get(Location, Velocity, Rotation))
+	{
+		return;//the planet isn't here yet; the next update will have it
+	}
+	ReplicatedMovement.Location = Location;
+	ReplicatedMovement.Rotation = Rotation;
+	ReplicatedMovement.LinearVelocity = Velocity;
+	OnRep_ReplicatedMovement();
+
+	//our tick turns the capsule to GravityFrame * YawSum, which would throw the heading away
+	if (UOrbitCharacterMovementComponent* Movement = Cast<UOrbitCharacterMovementComponent>(GetCharacterMovement()))
+	{
+		Movement->SetYawFromRotation(Rotation);
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Input
 
@@ -105,7 +161,21 @@ void AOrbitCharacter::OnFire()
 		const FVector SpawnLocation = GetActorLocation() + SpawnRotation.RotateVector(GunOffset);
 
 		UWorld* const World = GetWorld();
-		if (World != NULL)
+		AOrbitProjectileManager* const ProjectileManager = bBatchProjectiles ? AOrbitProjectileManager::Get(World) : NULL;
+		AOrbitProjectilePool* const ProjectilePool = bPoolProjectiles ? AOrbitProjectilePool::Get(World) : NULL;
+		if (ProjectileManager != NULL && ProjectileManager->ProjectileMesh == NULL)
+		{
+			ProjectileManager->ProjectileMesh = ProjectileMesh;
+		}
+		if (ProjectileManager != NULL && ProjectileManager->ProjectileMesh != NULL)//with no mesh to draw, batched shots would be invisible
+		{
+			ProjectileManager->Fire(ProjectileClass, SpawnLocation, SpawnRotation, this);
+		}
+		else if (ProjectilePool != NULL)
+		{
+			ProjectilePool->Fire(ProjectileClass, SpawnLocation, SpawnRotation, this);
+		}
+		else if (World != NULL)
 		{
 			// spawn the projectile at the muzzle
 			World->SpawnActor<AOrbitProjectile>(ProjectileClass, SpawnLocation, SpawnRotation);
@@ -2,6 +2,10 @@
 
 #include "Orbit.h"
 #include "OrbitCharacterMovementComponent.h"
+#include "OrbitStats.h"
+#include "OrbitTrace.h"
+#include "OrbitCoreBridge.h"
+#include "OrbitMovementManager.h"
 #define VERSION27
 
 #include "GameFramework/PhysicsVolume.h"
@@ -22,29 +26,15 @@
 
 DEFINE_LOG_CATEGORY_STATIC(LogCharacterMovement, Log, All);
 
-/**
- * Character stats
- */
-#ifndef STRUCTS_HERE
-#define STRUCTS_HERE
-DECLARE_STATS_GROUP(TEXT("Character"), STATGROUP_Character, STATCAT_Advanced);
-/*
-DECLARE_CYCLE_STAT(TEXT("Char Movement Tick"), STAT_CharacterMovementTick, STATGROUP_Character);
-DECLARE_CYCLE_STAT(TEXT("Char Movement Authority Time"), STAT_CharacterMovementAuthority, STATGROUP_Character);
-DECLARE_CYCLE_STAT(TEXT("Char Movement Simulated Time"), STAT_CharacterMovementSimulated, STATGROUP_Character);
-DECLARE_CYCLE_STAT(TEXT("Char Physics Interation"), STAT_CharPhysicsInteraction, STATGROUP_Character);
-DECLARE_CYCLE_STAT(TEXT("StepUp"), STAT_CharStepUp, STATGROUP_Character);
-DECLARE_CYCLE_STAT(TEXT("Char Update Acceleration"), STAT_CharUpdateAcceleration, STATGROUP_Character);
-DECLARE_CYCLE_STAT(TEXT("Char MoveUpdateDelegate"), STAT_CharMoveUpdateDelegate, STATGROUP_Character);
-DECLARE_CYCLE_STAT(TEXT("PhysWalking"), STAT_CharPhysWalking, STATGROUP_Character);
-DECLARE_CYCLE_STAT(TEXT("PhysFalling"), STAT_CharPhysFalling, STATGROUP_Character);
-*/
-#endif
-
 // MAGIC NUMBERS
 const float MAX_STEP_SIDE_Z = 0.08f;	// maximum z value for the normal on the vertical side of steps
 const float SWIMBOBSPEED = -80.f;
 const float VERTICAL_SLOPE_NORMAL_Z = 0.001f; // Slope is vertical if Abs(Normal.Z) <= this threshold. Accounts for precision problems that sometimes angle normals slightly off horizontal for vertical surface.
+const float ASYNC_FLOOR_GRAVITY_TOLERANCE = 0.001f; // Prefetched floor queries are thrown away if gravity turned further than this (about 0.06 degrees).
+const float MOVEMENT_LOD_INTERVAL = 0.25f; // Seconds between looks at where the players are, per character.
+const float MOVEMENT_LOD_UNSEEN_TIME = 0.5f; // Not rendered for this long counts as out of sight.
+const float FIXED_STEP_BLEND_TIME = 0.2f; // Seconds for the children to ease back onto the capsule once we stop stepping.
+const float SAVED_MOVE_COMBINE_GRAVITY_DOT = 0.9999f; // Saved moves whose gravity turned further than this (about 0.8 degrees) replay separately.
 
 /* Don't know WTF 2do about these
 const float UOrbitCharacterMovementComponent::MIN_TICK_TIME = 0.0002f;
@@ -65,7 +55,30 @@ UOrbitCharacterMovementComponent::UOrbitCharacterMovementComponent(const class F
 	GravityDistanceVector = FVector::ZeroVector;
 	YawSum = 0.0;
 	TickCounter = 0;
-	UGravityManager* GravityManager = NewObject<UGravityManager>();
+	GravityManager = NULL;
+	GravityFrame = FQuat::Identity;
+	bGravityFrameValid = false;
+	bGravityOriented = false;
+	bAsyncFloorQueries = false;
+	AsyncFloorTolerance = 2.f;
+	bAnalyticPlanetCollision = false;
+	PlanetClearanceMargin = 100.f;
+	bFixedStepMovement = false;
+	FixedStepRate = 60.f;
+	MaxFixedStepsPerFrame = 4;
+	bMovementLOD = false;
+	ReducedLODDistance = 3000.f;
+	GlideLODDistance = 8000.f;
+	ReducedLODRate = 10.f;
+	MovementLOD = EOrbitMovementLOD::Full;
+	MovementLODTimer = 0.f;
+	GlidePlanet = INDEX_NONE;
+	bBatchedMovement = false;
+	MovementManager = NULL;
+	MovementBatchIndex = INDEX_NONE;
+	MovementBatchFrame = 0;
+	GlideBatchFrame = 0;
+	FloorPrefetchFrame = 0;
 }
 
 void UOrbitCharacterMovementComponent::InitializeComponent()
@@ -73,8 +86,36 @@ void UOrbitCharacterMovementComponent::InitializeComponent()
 	Super::InitializeComponent();
 		//UE_LOG(LogTemp, Warning, TEXT("Bloody fucking hell:%s %s"), *GetOwner()->GetName(),*GetOwner()->GetClass()->GetName());
 		//GravityManager->RegisterActor(*GetOwner(), GravityVector);
-		GravityManager->Start();
+		GravityManager = UGravityManager::Get(GetWorld());
+		if (GravityManager && GetOwner()){
+			//players weigh 1, and move themselves so no AddForce
+			GravityHandle = GravityManager->RegisterBody(GetOwner(), NULL, EGravityBodyFlags::Receiver, 1.f);
+			PrimaryComponentTick.AddPrerequisite(GravityManager, GravityManager->GravityTick);//solve before we read
+		}
 		CalculateGravity();
+		MovementLODTimer = FMath::FRand() * MOVEMENT_LOD_INTERVAL;//spread everyone's looks over the interval
+		if (bBatchedMovement)
+		{
+			MovementManager = UOrbitMovementManager::Get(GetWorld());
+			if (MovementManager)
+			{
+				MovementManager->Register(this);
+			}
+		}
+}
+
+void UOrbitCharacterMovementComponent::UninitializeComponent()
+{
+	if (GravityManager){
+		GravityManager->UnregisterBody(GravityHandle);
+	}
+	GravityHandle = FGravityBodyHandle();
+	if (MovementManager)
+	{
+		MovementManager->Unregister(this);
+		MovementManager = NULL;
+	}
+	Super::UninitializeComponent();
 }
 //	PostLoad()
 
@@ -82,9 +123,8 @@ void UOrbitCharacterMovementComponent::InitializeComponent()
 void UOrbitCharacterMovementComponent::TickComponent( float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction )
 {
 	Super::Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
-	GravityManager->ApplyGravity();//this probably should go elsewhere
 
-	// SCOPE_CYCLE_COUNTER(Super.STAT_CharacterMovementTick);
+	ORBIT_SCOPE_CYCLE_COUNTER(MovementTick);
 
 	const FVector InputVector = ConsumeInputVector();
 	if (!HasValidData() || ShouldSkipUpdate(DeltaTime) || UpdatedComponent->IsSimulatingPhysics())
@@ -97,6 +137,15 @@ void UOrbitCharacterMovementComponent::TickComponent( float DeltaTime, enum ELev
 		AvoidanceLockTimer -= DeltaTime;
 	}
 
+	//the manager solved before we ticked, so this is already this frame's
+	const bool bGlideBatched = GlideBatchFrame == GFrameCounter;
+	if (MovementBatchFrame != GFrameCounter)
+	{
+		TickCounter++;
+		if(TickCounter % 2 == 0) CalculateGravity();//FIXME: I think UE4 has ways to avoid modulo
+	}
+	bGravityOriented = bGlideBatched;
+
 	if (CharacterOwner->Role > ROLE_SimulatedProxy)
 	{
 		if (CharacterOwner->Role == ROLE_Authority)
@@ -113,14 +162,16 @@ void UOrbitCharacterMovementComponent::TickComponent( float DeltaTime, enum ELev
 		const bool bIsClient = (GetNetMode() == NM_Client && CharacterOwner->Role == ROLE_AutonomousProxy);
 		if (bIsClient)
 		{
+			//replayed moves put back their own gravity and heading; ours come back after
+			const FMoveGravity CurrentGravity = GetMoveGravity();
 			ClientUpdatePositionAfterServerUpdate();
+			SetMoveGravity(CurrentGravity);
 		}
 
 		// Allow root motion to move characters that have no controller.
 		if( CharacterOwner->IsLocallyControlled() || (!CharacterOwner->Controller && bRunPhysicsWithNoController) || (!CharacterOwner->Controller && CharacterOwner->IsPlayingRootMotion()) )
 		{
 			{
-				//SCOPE_CYCLE_COUNTER(STAT_CharUpdateAcceleration);
 
 				// We need to check the jump state before adjusting input acceleration, to minimize latency
 				// and to make sure acceleration respects our potentially new falling state.
@@ -133,7 +184,27 @@ void UOrbitCharacterMovementComponent::TickComponent( float DeltaTime, enum ELev
 
 			if (CharacterOwner->Role == ROLE_Authority)
 			{
-				PerformMovement(DeltaTime);
+				UpdateMovementLOD(DeltaTime);
+				if (bGlideBatched)
+				{
+					//UOrbitMovementManager moved us already; a change of LOD starts next frame
+				}
+				else if (MovementLOD == EOrbitMovementLOD::Glide)
+				{
+					PerformGlide(DeltaTime);
+				}
+				else if (MovementLOD == EOrbitMovementLOD::Reduced)
+				{
+					PerformFixedStepMovement(DeltaTime, 1.f / FMath::Max(ReducedLODRate, 1.f));
+				}
+				else if (bFixedStepMovement)
+				{
+					PerformFixedStepMovement(DeltaTime, 1.f / FMath::Max(FixedStepRate, 1.f));
+				}
+				else
+				{
+					PerformMovement(DeltaTime);
+				}
 			}
 			else if (bIsClient)
 			{
@@ -159,8 +230,6 @@ void UOrbitCharacterMovementComponent::TickComponent( float DeltaTime, enum ELev
 
 	if (bEnablePhysicsInteraction)
 	{
-		//SCOPE_CYCLE_COUNTER(STAT_CharPhysicsInteraction);
-
 		if (CurrentFloor.HitResult.IsValidBlockingHit())
 		{
 			// Apply downwards force when walking on top of physics objects
@@ -181,18 +250,288 @@ void UOrbitCharacterMovementComponent::TickComponent( float DeltaTime, enum ELev
 		ApplyRepulsionForce(DeltaTime);
 	}
 
+	// PerformMovement orients us inside its scoped update; simulated proxies don't go through it.
+	// At reduced LOD the steps are enough, the frames between them don't turn us either.
+	if (!bGravityOriented && MovementLOD != EOrbitMovementLOD::Reduced)
+	{
+		UpdateGravityOrientation();
+	}
+
+	if (FixedStep.bActive)
+	{
+		if (FixedStep.FrameNumber == GFrameCounter)
+		{
+			InterpolateFixedStep();
+		}
+		else
+		{
+			BlendOutFixedStep(DeltaTime);
+		}
+	}
+
+	if (MovementLOD == EOrbitMovementLOD::Full)
+	{
+		if (MovementManager)
+		{
+			FloorPrefetchFrame = GFrameCounter;//issued along with everyone else's once we've all ticked
+		}
+		else
+		{
+			PrefetchFloor(DeltaTime);
+		}
+	}
+}
+
+/* Near a player view, or controlled by a player: Full. Further: Reduced. Further still, or out of
+   sight, and walking on an analytic planet: Glide. Looking at the players costs a loop over them,
+   so it happens every MOVEMENT_LOD_INTERVAL, except that gliding stops the frame it has to.
+*/
+void UOrbitCharacterMovementComponent::UpdateMovementLOD(float DeltaTime)
+{
+	const EOrbitMovementLOD::Type OldLOD = MovementLOD;
+	MovementLODTimer -= DeltaTime;
+
+	if (!bMovementLOD || !CharacterOwner->Controller || CharacterOwner->Controller->IsA(APlayerController::StaticClass()))
+	{
+		MovementLOD = EOrbitMovementLOD::Full;
+	}
+	else if (MovementLODTimer <= 0.f || (MovementLOD == EOrbitMovementLOD::Glide && !IsGlideSafe()))
+	{
+		MovementLODTimer = MOVEMENT_LOD_INTERVAL;
+
+		const FVector Location = UpdatedComponent->GetComponentLocation();
+		float NearestDistSq = MAX_FLT;
+		for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+		{
+			if (const APlayerController* PlayerController = *Iterator)
+			{
+				FVector ViewLocation;
+				FRotator ViewRotation;
+				PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+				NearestDistSq = FMath::Min(NearestDistSq, FVector::DistSquared(ViewLocation, Location));
+			}
+		}
+		const bool bUnseen = GetWorld()->GetTimeSeconds() - CharacterOwner->GetLastRenderTime() > MOVEMENT_LOD_UNSEEN_TIME;
 
-	TickCounter++;
-	if(TickCounter % 2 == 0) CalculateGravity();//FIXME: I think UE4 has ways to avoid modulo
-	FRotator GravRot = GravityDirection.Rotation();
-	GravRot.Pitch += 120;//not sure why this correction is needed 
-		checkf(!GravRot.ContainsNaN(), TEXT("Tick: GravRot contains NaN"));
-	//GetOwner()->SetActorRotation(GravRot * FMath::DegreesToRadians( YawSum) );//interesting
+		if (NearestDistSq < FMath::Square(ReducedLODDistance))
+		{
+			MovementLOD = EOrbitMovementLOD::Full;
+		}
+		else if ((bUnseen || NearestDistSq >= FMath::Square(GlideLODDistance)) && CanGlide(GlidePlanet))
+		{
+			MovementLOD = EOrbitMovementLOD::Glide;
+		}
+		else
+		{
+			MovementLOD = EOrbitMovementLOD::Reduced;
+		}
+	}
 
-	GetOwner()->SetActorRotation(GravRot  );
-	GetOwner()->AddActorLocalRotation(FRotator(0, YawSum, 0), true);
+	if (OldLOD == EOrbitMovementLOD::Glide && MovementLOD != EOrbitMovementLOD::Glide && IsMovingOnGround())
+	{
+		//gliding never looked at the floor, the real pipeline needs it
+		FindFloor(UpdatedComponent->GetComponentLocation(), CurrentFloor, false, NULL);
+	}
+}
 
-	checkf(!GetOwner()->GetActorRotation().ContainsNaN(), TEXT("Tick: Actor Rotation contains NaN "));
+bool UOrbitCharacterMovementComponent::IsGlideSafe() const
+{
+	return MovementMode == MOVE_Walking
+		&& PendingImpulseToApply.IsZero() && PendingForceToApply.IsZero() && PendingLaunchVelocity.IsZero()
+		&& bWantsToCrouch == IsCrouching()
+		&& !CharacterOwner->IsPlayingRootMotion();
+}
+
+bool UOrbitCharacterMovementComponent::CanGlide(int32& OutPlanet) const
+{
+	if (!bAnalyticPlanetCollision || !GravityManager || !CurrentFloor.IsWalkableFloor() || !IsGlideSafe())
+	{
+		return false;
+	}
+
+	const AActor* FloorActor = CurrentFloor.HitResult.GetActor();
+	const FGravityPlanetCollision& Planets = GravityManager->GetPlanets();
+	for (int32 i = 0; FloorActor && i < Planets.Num(); i++)
+	{
+		if (Planets.GetActor(i) == FloorActor)
+		{
+			//clear of everything else for as far as we can get before the next look
+			const float Reach = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() + Velocity.Size() * MOVEMENT_LOD_INTERVAL;
+			if (!HasPlanetClearance(UpdatedComponent->GetComponentLocation(), Reach))
+			{
+				return false;
+			}
+			OutPlanet = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Walking on a sphere with nothing else near has a closed form answer, so gliding is PhysWalking's
+   velocity on the tangent plane, then the location put back on the sphere at the height
+   AdjustFloorHeight keeps the capsule at. That is also where the full pipeline finds it again,
+   so switching back doesn't pop.
+*/
+void UOrbitCharacterMovementComponent::PerformGlide(float DeltaTime)
+{
+	//own stat, so falling back to PerformMovement below doesn't count that time twice under one name
+	ORBIT_SCOPE_CYCLE_COUNTER(PerformGlide);
+
+	if (!HasGlidePlanet())
+	{
+		//the planet went away under us
+		MovementLOD = EOrbitMovementLOD::Reduced;
+		MovementLODTimer = 0.f;
+		FindFloor(UpdatedComponent->GetComponentLocation(), CurrentFloor, false, NULL);
+		PerformMovement(DeltaTime);
+		return;
+	}
+
+	BeginGlide(DeltaTime);
+	if (!HasValidData())
+	{
+		return;
+	}
+
+	const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	const FVector OldVelocity = Velocity;
+	const FVector Center = GravityManager->GetPlanets().GetCenter(GlidePlanet);
+	const FVector Up = (OldLocation - Center).GetSafeNormal();
+
+	//CalcVelocity rather than OrbitCore::WalkVelocity, for path following
+	Acceleration = FVector::VectorPlaneProject(Acceleration, Up);
+	Velocity = FVector::VectorPlaneProject(Velocity, Up);
+	CalcVelocity(DeltaTime, GroundFriction, false, BrakingDecelerationWalking);
+	Velocity = FVector::VectorPlaneProject(Velocity, Up);
+
+	OrbitCore::FVec NewLocation, NewVelocity;
+	OrbitCore::GlideOnSphere(ToOrbitCore(OldLocation), ToOrbitCore(Velocity), ToOrbitCore(Center), GetGlideHeight(), DeltaTime, NewLocation, NewVelocity);
+	EndGlide(DeltaTime, OldLocation, OldVelocity, FromOrbitCore(NewLocation), FromOrbitCore(NewVelocity));
+}
+
+bool UOrbitCharacterMovementComponent::HasGlidePlanet() const
+{
+	return GravityManager && GlidePlanet >= 0 && GlidePlanet < GravityManager->GetPlanets().Num() && GravityManager->GetPlanets().GetActor(GlidePlanet) != NULL;
+}
+
+float UOrbitCharacterMovementComponent::GetGlideHeight() const
+{
+	return GravityManager->GetPlanets().GetRadius(GlidePlanet) + CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() + (MIN_FLOOR_DIST + MAX_FLOOR_DIST) * 0.5f;
+}
+
+void UOrbitCharacterMovementComponent::BeginGlide(float DeltaTime)
+{
+	MaybeUpdateBasedMovement(DeltaTime);
+	CharacterOwner->ClearJumpInput();
+}
+
+void UOrbitCharacterMovementComponent::EndGlide(float DeltaTime, const FVector& OldLocation, const FVector& OldVelocity, const FVector& NewLocation, const FVector& NewVelocity)
+{
+	Velocity = NewVelocity;
+
+	//moved and turned in one go, so the tick doesn't need to orient us again
+	MoveUpdatedComponent(NewLocation - UpdatedComponent->GetComponentLocation(), GetGravityOrientation().Rotator(), false);
+	bGravityOriented = true;
+
+	bHasRequestedVelocity = false;
+	OnMovementUpdated(DeltaTime, OldLocation, OldVelocity);
+	CallMovementUpdateDelegate(DeltaTime, OldLocation, OldVelocity);
+	SaveBaseLocation();
+	UpdateComponentVelocity();
+	LastUpdateLocation = UpdatedComponent->GetComponentLocation();
+}
+
+/* The capsule only ever stands where a whole step left it, so collision and gameplay see the same
+   state whatever the frame rate. The children are drawn Accumulator/Step of the way from the step
+   before to the last one: smooth, one step behind.
+*/
+void UOrbitCharacterMovementComponent::PerformFixedStepMovement(float DeltaTime, float Step)
+{
+	if (!FixedStep.bActive)
+	{
+		FixedStep.bActive = true;
+		FixedStep.AppliedOffset = FVector::ZeroVector;
+		FixedStep.Children.Empty();
+		for (USceneComponent* Child : UpdatedComponent->AttachChildren)
+		{
+			if (Child)
+			{
+				FixedStep.Children.Add(Child);
+			}
+		}
+		FixedStep.FrameNumber = 0;
+	}
+	if (FixedStep.FrameNumber + 1 != GFrameCounter || FixedStep.Step != Step)
+	{
+		//(re)starting, maybe with the children still blending out: one step ahead, so they keep moving instead of waiting for it
+		FixedStep.Accumulator = Step;
+		FixedStep.PreviousLocation = FixedStep.CurrentLocation = UpdatedComponent->GetComponentLocation();
+	}
+	FixedStep.FrameNumber = GFrameCounter;
+	FixedStep.Step = Step;
+
+	FixedStep.Accumulator += DeltaTime;
+	FixedStep.NumSteps = 0;
+	while (FixedStep.Accumulator >= Step && FixedStep.NumSteps < MaxFixedStepsPerFrame)
+	{
+		FixedStep.PreviousLocation = UpdatedComponent->GetComponentLocation();
+		PerformMovement(Step);
+		FixedStep.Accumulator -= Step;
+		FixedStep.NumSteps++;
+		if (!HasValidData())
+		{
+			return;//fell out of the world
+		}
+		FixedStep.CurrentLocation = UpdatedComponent->GetComponentLocation();
+	}
+	if (FixedStep.Accumulator >= Step)
+	{
+		FixedStep.Accumulator = FMath::Fmod(FixedStep.Accumulator, Step);
+		FixedStep.NumDropped++;
+	}
+	ORBIT_INC_COUNTER(MovementSteps, FixedStep.NumSteps);
+}
+
+void UOrbitCharacterMovementComponent::InterpolateFixedStep()
+{
+	const float Alpha = FMath::Clamp(FixedStep.Accumulator / FixedStep.Step, 0.f, 1.f);
+
+	//relative to the last step rather than the capsule, so being carried by a base between steps still shows
+	const FVector Offset = FMath::Lerp(FixedStep.PreviousLocation, FixedStep.CurrentLocation, Alpha) - FixedStep.CurrentLocation;
+	ApplyFixedStepOffset(UpdatedComponent->ComponentToWorld.InverseTransformVectorNoScale(Offset));
+}
+
+void UOrbitCharacterMovementComponent::BlendOutFixedStep(float DeltaTime)
+{
+	const FVector RelativeOffset = FixedStep.AppliedOffset * FMath::Max(0.f, 1.f - DeltaTime / FIXED_STEP_BLEND_TIME);
+	if (RelativeOffset.SizeSquared() < FMath::Square(0.1f))
+	{
+		StopFixedStep();
+	}
+	else
+	{
+		ApplyFixedStepOffset(RelativeOffset);
+	}
+}
+
+void UOrbitCharacterMovementComponent::ApplyFixedStepOffset(const FVector& RelativeOffset)
+{
+	for (int32 i = 0; i < FixedStep.Children.Num(); i++)
+	{
+		if (USceneComponent* Child = FixedStep.Children[i].Get())
+		{
+			Child->SetRelativeLocation(Child->RelativeLocation - FixedStep.AppliedOffset + RelativeOffset);
+		}
+	}
+	FixedStep.AppliedOffset = RelativeOffset;
+}
+
+void UOrbitCharacterMovementComponent::StopFixedStep()
+{
+	ApplyFixedStepOffset(FVector::ZeroVector);
+	FixedStep.Children.Empty();
+	FixedStep.bActive = false;
 }
 	
 //yaw delta actually
@@ -200,6 +539,80 @@ void UOrbitCharacterMovementComponent::SumYaw(float yaw){
 	YawSum += yaw;
 }
 
+void UOrbitCharacterMovementComponent::SetYawFromRotation(const FRotator& Rotation)
+{
+	if (GravityDirection.IsNearlyZero())
+	{
+		return;
+	}
+	GetGravityOrientation();//brings GravityFrame up to date
+	const FVector Forward = GravityFrame.Inverse().RotateVector(Rotation.Vector());
+	if (FMath::Abs(Forward.X) + FMath::Abs(Forward.Y) > KINDA_SMALL_NUMBER)
+	{
+		YawSum = FMath::RadiansToDegrees(FMath::Atan2(Forward.Y, Forward.X));
+	}
+}
+
+AActor* UOrbitCharacterMovementComponent::FindNearestPlanet(const FVector& Location) const
+{
+	if (!GravityManager)
+	{
+		return NULL;
+	}
+	const FGravityPlanetCollision& Planets = GravityManager->GetPlanets();
+	AActor* Nearest = NULL;
+	float NearestHeight = BIG_NUMBER;
+	for (int32 i = 0; i < Planets.Num(); i++)
+	{
+		const float Height = FVector::Dist(Location, Planets.GetCenter(i)) - Planets.GetRadius(i);
+		AActor* Planet = Planets.GetActor(i);
+		if (Planet && Height < NearestHeight)
+		{
+			Nearest = Planet;
+			NearestHeight = Height;
+		}
+	}
+	return Nearest;
+}
+
+/* Up is against gravity. Rather than rebuilding the frame from GravityDirection.Rotation() each
+   tick, which flips heading at the poles (and needed a pitch fudge), the last frame is turned by
+   the smallest rotation that takes its up onto the new one, so heading carries over smoothly.
+   The player's yaw is then applied about that up.
+*/
+FQuat UOrbitCharacterMovementComponent::GetGravityOrientation()
+{
+	const FVector Up = -GravityDirection;
+	if (!bGravityFrameValid)
+	{
+		GravityFrame = FRotationMatrix::MakeFromZ(Up).ToQuat();
+		bGravityFrameValid = true;
+	}
+	else
+	{
+		const FVector OldUp = GravityFrame.RotateVector(FVector(0.f, 0.f, 1.f));
+		GravityFrame = FQuat::FindBetween(OldUp, Up) * GravityFrame;
+		GravityFrame.Normalize();
+	}
+	return GravityFrame * FQuat(FVector(0.f, 0.f, 1.f), FMath::DegreesToRadians(YawSum));
+}
+
+void UOrbitCharacterMovementComponent::UpdateGravityOrientation()
+{
+	ORBIT_SCOPE_CYCLE_COUNTER(RotationUpdate);
+	bGravityOriented = true;
+	if (!UpdatedComponent || GravityDirection.IsNearlyZero())
+	{
+		return;
+	}
+	const FRotator NewRotation = GetGravityOrientation().Rotator();
+	checkf(!NewRotation.ContainsNaN(), TEXT("UpdateGravityOrientation: rotation contains NaN"));
+
+	//one transform update, no sweep: the capsule only turns about its center
+	FHitResult Hit(1.f);
+	MoveUpdatedComponent(FVector::ZeroVector, NewRotation, false, &Hit);
+}
+
 void UOrbitCharacterMovementComponent::CalculateGravity()
 {
 	/*
@@ -207,8 +620,22 @@ void UOrbitCharacterMovementComponent::CalculateGravity()
 		GravityMagnitude = GravityVector.Size();
 		GravityDirection = GravityVector.GetSafeNormal();
 	*/
-	FGravityBody GB = GravityManager->GetGravityBody(FString("PlayerStart"));//don't know what 2do about this yet
-	GravityVector = GB.GravityVector;
+	FGravityBody GB;
+	if (GravityManager)
+	{
+		GB = GravityManager->GetGravityBody(GravityHandle);
+	}
+	SetGravity(GB.GravityVector, GB.GetMagnitude());
+	/*
+	if(IsValid(this)){
+		AddForce(GravityVector);
+		//AddImpulse(GravityVector);
+	}*/
+}
+
+void UOrbitCharacterMovementComponent::SetGravity(const FVector& InGravityVector, float InMagnitude)
+{
+	GravityVector = InGravityVector;
 //UE_LOG(LogTemp, Warning, TEXT("%d %s: GV %s"), __LINE__, __FUNCTIONW__, *GravityVector.ToString());
 	if (GravityVector == FVector(0,0,0) ){
 		GravityVector = FVector(0.f, 0.f, 10.f);
@@ -217,14 +644,84 @@ void UOrbitCharacterMovementComponent::CalculateGravity()
 	}
 	else
 	{
-		GravityMagnitude = GB.GetMagnitude();
-		GravityDirection = GB.GetDirection();
+		GravityMagnitude = InMagnitude;
+		GravityDirection = GravityVector.GetSafeNormal();
 	}
-	/*
-	if(IsValid(this)){
-		AddForce(GravityVector);
-		//AddImpulse(GravityVector);
-	}*/
+}
+
+UOrbitCharacterMovementComponent::FMoveGravity UOrbitCharacterMovementComponent::GetMoveGravity() const
+{
+	FMoveGravity Gravity;
+	Gravity.Vector = GravityVector;
+	Gravity.Direction = GravityDirection;
+	Gravity.Magnitude = GravityMagnitude;
+	Gravity.YawSum = YawSum;
+	Gravity.Frame = GravityFrame;
+	Gravity.bFrameValid = bGravityFrameValid;
+	return Gravity;
+}
+
+void UOrbitCharacterMovementComponent::SetMoveGravity(const FMoveGravity& Gravity)
+{
+	GravityVector = Gravity.Vector;
+	GravityDirection = Gravity.Direction;
+	GravityMagnitude = Gravity.Magnitude;
+	YawSum = Gravity.YawSum;
+	//the frame carries over from one orientation to the next, so it goes back too or replays would drift the heading
+	GravityFrame = Gravity.Frame;
+	bGravityFrameValid = Gravity.bFrameValid;
+}
+
+FNetworkPredictionData_Client* UOrbitCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		UOrbitCharacterMovementComponent* MutableThis = const_cast<UOrbitCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Orbit();
+	}
+	return ClientPredictionData;
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Orbit::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Orbit());
+}
+
+void FSavedMove_Orbit::Clear()
+{
+	Super::Clear();
+	FMemory::Memzero(&Gravity, sizeof(Gravity));
+	Gravity.Frame = FQuat::Identity;
+}
+
+void FSavedMove_Orbit::SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+	//taken before the move runs, which is what it will start from again on a replay
+	if (UOrbitCharacterMovementComponent* Movement = Cast<UOrbitCharacterMovementComponent>(C->GetCharacterMovement()))
+	{
+		Gravity = Movement->GetMoveGravity();
+	}
+}
+
+void FSavedMove_Orbit::PrepMoveFor(ACharacter* C)
+{
+	Super::PrepMoveFor(C);
+	if (UOrbitCharacterMovementComponent* Movement = Cast<UOrbitCharacterMovementComponent>(C->GetCharacterMovement()))
+	{
+		Movement->SetMoveGravity(Gravity);
+	}
+}
+
+bool FSavedMove_Orbit::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InPawn, float MaxDelta) const
+{
+	//a combined move replays with the newer one's gravity throughout
+	const FSavedMove_Orbit* NewOrbitMove = static_cast<const FSavedMove_Orbit*>(NewMove.Get());
+	if (FVector::DotProduct(Gravity.Direction, NewOrbitMove->Gravity.Direction) < SAVED_MOVE_COMBINE_GRAVITY_DOT)
+	{
+		return false;
+	}
+	return Super::CanCombineWith(NewMove, InPawn, MaxDelta);
 }
 
 float UOrbitCharacterMovementComponent::GetGravityZ() const
@@ -302,6 +799,7 @@ FindFloor(const FVector& CapsuleLocation, FFindFloorResult& OutFloorResult, bool
 		}
 	}
 
+	ORBIT_TRACE(ModeChange, this, (int32)PreviousMovementMode, (int32)MovementMode, (int32)CustomMovementMode);
 	CharacterOwner->OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
 
 }
@@ -357,6 +855,7 @@ bool UOrbitCharacterMovementComponent::IsMoonWalking() const
 
 void UOrbitCharacterMovementComponent::PhysWalking(float deltaTime, int32 Iterations)
 {
+	ORBIT_SCOPE_CYCLE_COUNTER(PhysWalking);
 //	SetMovementMode(MOVE_Custom, CUSTOM_MoonWalking);//fart
 	Super::PhysWalking(deltaTime, Iterations);
 	//all of the above is probably going away
@@ -364,6 +863,7 @@ void UOrbitCharacterMovementComponent::PhysWalking(float deltaTime, int32 Iterat
 }
 void UOrbitCharacterMovementComponent::PhysMoonWalking(float deltaTime, int32 Iterations)
 {
+	ORBIT_SCOPE_CYCLE_COUNTER(PhysWalking);
 
 	if (deltaTime < MIN_TICK_TIME)
 	{
@@ -550,14 +1050,14 @@ void UOrbitCharacterMovementComponent::PhysMoonWalking(float deltaTime, int32 It
 			// See if we need to start falling.
 			if (!CurrentFloor.IsWalkableFloor() && !CurrentFloor.HitResult.bStartPenetrating)
 			{
-			UE_LOG(LogTemp, Warning, TEXT("%d %s:"), __LINE__, __FUNCTIONW__);//hopping sometimes
+			ORBIT_TRACE(WalkingOffFloor, this, false);//hopping sometimes
 				const bool bMustJump = bJustTeleported || bZeroDelta || (OldBase == NULL || 
 					(!OldBase->IsCollisionEnabled() && MovementBaseUtility::IsDynamicBase(OldBase)));
 				if (
 					(bMustJump || !bCheckedFall) 
 					&& CheckFall(CurrentFloor.HitResult, Delta, OldLocation, remainingTime, timeTick, Iterations, bMustJump) 
 					) {
-			UE_LOG(LogTemp, Warning, TEXT("%d %s:"), __LINE__, __FUNCTIONW__); //hopping sometimes
+			ORBIT_TRACE(WalkingOffFloor, this, true); //hopping sometimes
 					return;
 				}
 				bCheckedFall = true;
@@ -614,7 +1114,7 @@ void UOrbitCharacterMovementComponent::AdjustFloorHeight()
 		//const float MoveDist = FMath::Abs(AvgFloorDist - OldFloorDist);//gdg
 		//SafeMoveUpdatedComponent( FVector(0.f,0.f,MoveDist), CharacterOwner->GetActorRotation(), true, AdjustHit );
 		SafeMoveUpdatedComponent( GravityDirection * MoveDist, CharacterOwner->GetActorRotation(), true, AdjustHit );//gdg
-		UE_LOG(LogTemp, Warning, TEXT("Adjust floor height %.3f (Hit = %d)"), MoveDist, AdjustHit.bBlockingHit);
+		ORBIT_TRACE(FloorAdjust, this, MoveDist, AdjustHit.bBlockingHit);
 
 		if (!AdjustHit.IsValidBlockingHit())
 		{
@@ -677,13 +1177,6 @@ bool UOrbitCharacterMovementComponent::IsWalkable(const FHitResult& Hit) const
 		return false;
 	}
 
-	// Never walk up vertical surfaces. bah humbug
-	//if (Hit.ImpactNormal.Z < KINDA_SMALL_NUMBER)
-	if (FVector::DotProduct(Hit.ImpactNormal, -GravityVector) < KINDA_SMALL_NUMBER)//gdg
-	{
-		return false;
-	}
-	
 	float TestWalkableZ = GetWalkableFloorZ();
 	//FVector TestWalkable = -GravityDirection;//gdg
 
@@ -697,11 +1190,11 @@ if (HitComponent)
 		TestWalkableZ = SlopeOverride.ModifyWalkableFloorZ(TestWalkableZ);
 	}
 
-	// Can't walk on this surface if it is too steep.
+	// Can't walk on this surface if it is too steep, and never up vertical surfaces. bah humbug
 	//if (Hit.ImpactNormal.Z < TestWalkableZ)
-	if ( FMath::Abs(FVector::DotProduct(Hit.ImpactNormal, GravityDirection)) < TestWalkableZ )
+	if (!OrbitCore::IsWalkableNormal(ToOrbitCore(Hit.ImpactNormal), ToOrbitCore(GravityDirection), TestWalkableZ))
 	{
-			UE_LOG(LogTemp, Warning, TEXT("%d IsWalkable NOT %s"), __LINE__, *Hit.ImpactNormal.ToString() );
+			ORBIT_TRACE(WalkableReject, this, Hit.ImpactNormal.X, Hit.ImpactNormal.Y, Hit.ImpactNormal.Z);
 		return false;
 	}
 
@@ -711,6 +1204,7 @@ if (HitComponent)
 
 void UOrbitCharacterMovementComponent::FindFloor(const FVector& CapsuleLocation, FFindFloorResult& OutFloorResult, bool bZeroDelta, const FHitResult* DownwardSweepResult) const
 {
+	ORBIT_SCOPE_CYCLE_COUNTER(FindFloor);
 	// No collision, no floor...
 	if (!UpdatedComponent->IsCollisionEnabled())
 	{
@@ -812,6 +1306,7 @@ void UOrbitCharacterMovementComponent::FindFloor(const FVector& CapsuleLocation,
 void UOrbitCharacterMovementComponent::ComputeFloorDist(const FVector& CapsuleLocation, float LineDistance, 
 	float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius, const FHitResult* DownwardSweepResult) const
 {
+	ORBIT_INC_COUNTER(FloorQueries, 1);
 	OutFloorResult.Clear();
 
 	// No collision, no floor...
@@ -861,6 +1356,18 @@ void UOrbitCharacterMovementComponent::ComputeFloorDist(const FVector& CapsuleLo
 		return;
 	}
 
+	// Nothing but a planet below us: no physics scene needed at all.
+	if (!bSkipSweep && bAnalyticPlanetCollision && ComputeFloorDistAgainstPlanets(CapsuleLocation, SweepDistance, OutFloorResult, SweepRadius))
+	{
+		return;
+	}
+
+	// Last frame may already have asked for this.
+	if (!bSkipSweep && bAsyncFloorQueries && ComputeFloorDistFromPrefetch(CapsuleLocation, LineDistance, SweepDistance, OutFloorResult, SweepRadius))
+	{
+		return;
+	}
+
 	bool bBlockingHit = false;
 	FCollisionQueryParams QueryParams(NAME_None, false, CharacterOwner);
 	FCollisionResponseParams ResponseParam;
@@ -946,6 +1453,7 @@ void UOrbitCharacterMovementComponent::ComputeFloorDist(const FVector& CapsuleLo
 		QueryParams.TraceTag = FloorLineTraceName;
 
 		FHitResult Hit(1.f);
+		ORBIT_INC_COUNTER(LineTraces, 1);
 		bBlockingHit = GetWorld()->LineTraceSingle(Hit, LineTraceStart, LineTraceStart + Down, CollisionChannel, QueryParams, ResponseParam);
 
 		if (bBlockingHit)
@@ -968,10 +1476,306 @@ void UOrbitCharacterMovementComponent::ComputeFloorDist(const FVector& CapsuleLo
 	}
 	
 	// No hits were acceptable.
-			UE_LOG(LogTemp, Warning, TEXT("%d %s: No Hitter"), __LINE__, __FUNCTIONW__);
+			ORBIT_TRACE(NoFloor, this, SweepDistance);
+	OutFloorResult.bWalkableFloor = false;
+	OutFloorResult.FloorDist = SweepDistance;
+}
+/* The same queries ComputeFloorDist makes while walking, issued at the end of this tick for where
+   Velocity puts us next frame. The physics scene runs them with the rest of the frame's async traces
+   and next frame's FindFloor picks them up instead of blocking on its own sweeps.
+   Async sweeps take no rotation, so instead of the capsule we sweep the sphere at its bottom,
+   which is the part that finds floors anyway. Hits on the capsule's sides were rejected by
+   IsWithinEdgeTolerance in any case. Perch checks and falling stay synchronous.
+*/
+void UOrbitCharacterMovementComponent::PrefetchFloor(float DeltaTime)
+{
+	FFloorPrefetch& Prefetch = FloorPrefetch;
+	Prefetch.bValid = false;
+	if (!bAsyncFloorQueries || bUseFlatBaseForFloorChecks || !IsMovingOnGround() || !HasValidData() || !UpdatedComponent->IsCollisionEnabled())
+	{
+		return;
+	}
+
+	float PawnRadius, PawnHalfHeight;
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(PawnRadius, PawnHalfHeight);
+
+	// What FindFloor passes while walking.
+	const float SweepDistance = FMath::Max(MAX_FLOOR_DIST, MaxStepHeight + MAX_FLOOR_DIST + KINDA_SMALL_NUMBER);
+
+	Prefetch.bFetched = false;
+	Prefetch.FrameNumber = GFrameCounter;
+	Prefetch.Location = UpdatedComponent->GetComponentLocation() + Velocity * DeltaTime;
+	Prefetch.GravityDirection = GravityDirection;
+	Prefetch.LineDistance = SweepDistance;
+	Prefetch.SweepDistance = SweepDistance;
+	Prefetch.SweepRadius = PawnRadius;
+	Prefetch.HalfHeight = PawnHalfHeight;
+
+	FCollisionQueryParams QueryParams(NAME_None, false, CharacterOwner);
+	FCollisionResponseParams ResponseParam;
+	InitCollisionParams(QueryParams, ResponseParam);
+	const ECollisionChannel CollisionChannel = UpdatedComponent->GetCollisionObjectType();
+	UWorld* World = GetWorld();
+
+	// Both of ComputeFloorDist's shapes; the shrunken one is only read if the first is rejected,
+	// but by then it is too late to ask.
+	static const FName ComputeFloorDistName(TEXT("ComputeFloorDistSweep"));
+	QueryParams.TraceTag = ComputeFloorDistName;
+	for (int32 i = 0; i < 2; i++)
+	{
+		const float ShrinkHeight = (PawnHalfHeight - PawnRadius) * (i == 0 ? 0.1f : 0.9f);
+		const float Radius = i == 0 ? PawnRadius : FMath::Max(0.f, PawnRadius - SWEEP_EDGE_REJECT_DISTANCE - KINDA_SMALL_NUMBER);
+		const float HalfHeight = FMath::Max(PawnHalfHeight - ShrinkHeight, Radius);
+		const float TraceDist = SweepDistance + ShrinkHeight;
+		const FVector End = Prefetch.Location + GravityDirection * TraceDist;
+		const FVector Offset = GravityDirection * (HalfHeight - Radius);
+
+		// FloorSweepTest sweeps to End / 2: half of the world space end point, not half of the trace, so from the
+		// capsule toward the world origin over half its distance from it. ComputeFloorDist still reads Hit.Time * TraceDist
+		// as the floor distance, and walking is tuned on that, so this sweeps the same way to get the same answers.
+		// Hit.Time is then a fraction of that long sweep: moving Drop along gravity onto a floor across it changes
+		// Hit.Time * TraceDist by Drop * TraceDist / (length * cos(sweep, gravity)), not by Drop.
+		const FVector Sweep = End / 2.f - Prefetch.Location;
+		const float SweepAlongGravity = FVector::DotProduct(Sweep, GravityDirection);
+		if (SweepAlongGravity <= KINDA_SMALL_NUMBER)
+		{
+			return;//pointing away from the floor, FindFloor can do that one itself
+		}
+		Prefetch.SweepDropScales[i] = TraceDist / SweepAlongGravity;
+		Prefetch.SweepOffsets[i] = Offset;
+		Prefetch.SweepHandles[i] = World->AsyncSweep(Prefetch.Location + Offset, Prefetch.Location + Sweep + Offset, CollisionChannel, FCollisionShape::MakeSphere(Radius), QueryParams, ResponseParam);
+	}
+
+	static const FName FloorLineTraceName = FName(TEXT("ComputeFloorDistLineTrace"));
+	QueryParams.TraceTag = FloorLineTraceName;
+	ORBIT_INC_COUNTER(AsyncTraces, 3);
+	Prefetch.LineHandle = World->AsyncLineTrace(Prefetch.Location, Prefetch.Location + GravityDirection * (SweepDistance + PawnHalfHeight), CollisionChannel, QueryParams, ResponseParam);
+	Prefetch.bValid = true;
+}
+
+bool UOrbitCharacterMovementComponent::ComputeFloorDistFromPrefetch(const FVector& CapsuleLocation, float LineDistance,
+	float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius) const
+{
+	FFloorPrefetch& Prefetch = FloorPrefetch;
+	if (!Prefetch.bValid)
+	{
+		return false;
+	}
+
+	float PawnRadius, PawnHalfHeight;
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(PawnRadius, PawnHalfHeight);
+
+	// Only for the question we asked: same frame, distances, shape and gravity, and close to where we guessed.
+	if (GFrameCounter != Prefetch.FrameNumber + 1 || LineDistance != Prefetch.LineDistance || SweepDistance != Prefetch.SweepDistance
+		|| SweepRadius != Prefetch.SweepRadius || PawnHalfHeight != Prefetch.HalfHeight
+		|| !GravityDirection.Equals(Prefetch.GravityDirection, ASYNC_FLOOR_GRAVITY_TOLERANCE)
+		|| FVector::DistSquared(CapsuleLocation, Prefetch.Location) > FMath::Square(AsyncFloorTolerance))
+	{
+		Prefetch.NumMissed++;
+		return false;
+	}
+
+	if (!Prefetch.bFetched)
+	{
+		UWorld* World = GetWorld();
+		FTraceDatum Datum;
+		for (int32 i = 0; i < 2; i++)
+		{
+			if (!World->QueryTraceData(Prefetch.SweepHandles[i], Datum))
+			{
+				Prefetch.bValid = false;
+				Prefetch.NumMissed++;
+				return false;
+			}
+			FHitResult& Hit = Prefetch.SweepHits[i];
+			Hit = Datum.OutHits.Num() > 0 ? Datum.OutHits[0] : FHitResult(1.f);
+			//back from the bottom sphere to the capsule center
+			Hit.Location -= Prefetch.SweepOffsets[i];
+			Hit.TraceStart = Datum.Start - Prefetch.SweepOffsets[i];
+			Hit.TraceEnd = Datum.End - Prefetch.SweepOffsets[i];
+		}
+		if (!World->QueryTraceData(Prefetch.LineHandle, Datum))
+		{
+			Prefetch.bValid = false;
+			Prefetch.NumMissed++;
+			return false;
+		}
+		Prefetch.LineHit = Datum.OutHits.Num() > 0 ? Datum.OutHits[0] : FHitResult(1.f);
+		Prefetch.bFetched = true;
+	}
+	Prefetch.NumUsed++;
+	ORBIT_INC_COUNTER(PrefetchedFloors, 1);
+
+	// Everything below is ComputeFloorDist's, less however much closer to the floor we ended up than guessed.
+	const float Drop = FVector::DotProduct(CapsuleLocation - Prefetch.Location, Prefetch.GravityDirection);
+	const float MaxPenetrationAdjust = FMath::Max(MAX_FLOOR_DIST, PawnRadius);
+
+	if (SweepDistance > 0.f && SweepRadius > 0.f && Prefetch.SweepHits[0].bBlockingHit)
+	{
+		const FHitResult& FirstHit = Prefetch.SweepHits[0];
+		const int32 Shape = (FirstHit.bStartPenetrating || !IsWithinEdgeTolerance(CapsuleLocation, FirstHit.ImpactPoint, SweepRadius)) ? 1 : 0;
+		const FHitResult& Hit = Prefetch.SweepHits[Shape];
+		const float ShrinkHeight = (PawnHalfHeight - PawnRadius) * (Shape == 0 ? 0.1f : 0.9f);
+		const float TraceDist = SweepDistance + ShrinkHeight;
+		const float SweepResult = FMath::Max(-MaxPenetrationAdjust, Hit.Time * TraceDist - ShrinkHeight - Drop * Prefetch.SweepDropScales[Shape]);
+
+		OutFloorResult.SetFromSweep(Hit, SweepResult, false);
+		if (Hit.IsValidBlockingHit() && IsWalkable(Hit) && SweepResult <= SweepDistance)
+		{
+			OutFloorResult.bWalkableFloor = true;
+			return true;
+		}
+	}
+
+	if (!OutFloorResult.bBlockingHit && !OutFloorResult.HitResult.bStartPenetrating)
+	{
+		OutFloorResult.FloorDist = SweepDistance;
+		return true;
+	}
+
+	const FHitResult& Hit = Prefetch.LineHit;
+	if (LineDistance > 0.f && Hit.bBlockingHit && Hit.Time > 0.f)
+	{
+		const float TraceDist = LineDistance + PawnHalfHeight;
+		const float LineResult = FMath::Max(-MaxPenetrationAdjust, Hit.Time * TraceDist - PawnHalfHeight - Drop);
+
+		OutFloorResult.bBlockingHit = true;
+		if (LineResult <= LineDistance && IsWalkable(Hit))
+		{
+			OutFloorResult.SetFromLineTrace(Hit, OutFloorResult.FloorDist, LineResult, true);
+			return true;
+		}
+	}
+
 	OutFloorResult.bWalkableFloor = false;
 	OutFloorResult.FloorDist = SweepDistance;
+	return true;
 }
+
+bool UOrbitCharacterMovementComponent::HasPlanetClearance(const FVector& Center, float Radius) const
+{
+	if (!GravityManager || !CharacterOwner || GravityManager->GetPlanets().Num() == 0)
+	{
+		return false;
+	}
+
+	FPlanetClearance& Clearance = PlanetClearance;
+	if (Clearance.FrameNumber != GFrameCounter || FVector::Dist(Center, Clearance.Center) + Radius > Clearance.Radius)
+	{
+		const FGravityPlanetCollision& Planets = GravityManager->GetPlanets();
+		FCollisionQueryParams QueryParams(NAME_None, false, CharacterOwner);
+		FCollisionResponseParams ResponseParam;
+		InitCollisionParams(QueryParams, ResponseParam);
+		for (int32 i = 0; i < Planets.Num(); i++)
+		{
+			QueryParams.AddIgnoredActor(Planets.GetActor(i));
+		}
+		static const FName PlanetClearanceName(TEXT("PlanetClearance"));
+		QueryParams.TraceTag = PlanetClearanceName;
+
+		// Oversized, so the rest of this frame's checks around here are answered by this one.
+		Clearance.FrameNumber = GFrameCounter;
+		Clearance.Center = Center;
+		Clearance.Radius = Radius + PlanetClearanceMargin;
+		ORBIT_INC_COUNTER(Overlaps, 1);
+		Clearance.bClear = !GetWorld()->OverlapTest(Center, FQuat::Identity, UpdatedComponent->GetCollisionObjectType(), FCollisionShape::MakeSphere(Clearance.Radius), QueryParams, ResponseParam);
+	}
+
+	if (Clearance.bClear)
+	{
+		Clearance.NumAnalytic++;
+		ORBIT_INC_COUNTER(AnalyticQueries, 1);
+	}
+	else
+	{
+		Clearance.NumPhysX++;
+	}
+	return Clearance.bClear;
+}
+
+/* Floor distance straight off the sphere equations. The capsule stands along gravity, so
+   there is no need for ComputeFloorDist's shrunken second sweep or its line trace: a sphere
+   has no edges or ledges for them to find a different answer on.
+*/
+bool UOrbitCharacterMovementComponent::ComputeFloorDistAgainstPlanets(const FVector& CapsuleLocation, float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius) const
+{
+	if (SweepDistance <= 0.f || SweepRadius <= 0.f)
+	{
+		return false;
+	}
+
+	float PawnRadius, PawnHalfHeight;
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(PawnRadius, PawnHalfHeight);
+	const FVector End = CapsuleLocation + GravityDirection * SweepDistance;
+	if (!HasPlanetClearance((CapsuleLocation + End) * 0.5f, SweepDistance * 0.5f + PawnHalfHeight))
+	{
+		return false;
+	}
+
+	FGravityPlanetHit PlanetHit;
+	if (!GravityManager->GetPlanets().SweepCapsule(CapsuleLocation, End, -GravityDirection, SweepRadius, FMath::Max(PawnHalfHeight, SweepRadius), PlanetHit))
+	{
+		OutFloorResult.FloorDist = SweepDistance;
+		return true;
+	}
+
+	FHitResult Hit;
+	SetFromPlanetHit(PlanetHit, CapsuleLocation, End, Hit);
+	const float MaxPenetrationAdjust = FMath::Max(MAX_FLOOR_DIST, PawnRadius);
+	const float FloorDist = PlanetHit.bStartPenetrating ? FMath::Max(-MaxPenetrationAdjust, -PlanetHit.PenetrationDepth) : PlanetHit.Time * SweepDistance;
+	const bool bIsWalkable = IsWalkable(Hit);
+	OutFloorResult.SetFromSweep(Hit, bIsWalkable ? FloorDist : SweepDistance, bIsWalkable);
+	return true;
+}
+
+bool UOrbitCharacterMovementComponent::MoveAgainstPlanets(const FVector& Delta, const FRotator& NewRotation, FHitResult* OutHit)
+{
+	float PawnRadius, PawnHalfHeight;
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(PawnRadius, PawnHalfHeight);
+	const FVector Start = UpdatedComponent->GetComponentLocation();
+	const FVector End = Start + Delta;
+	if (!HasPlanetClearance((Start + End) * 0.5f, Delta.Size() * 0.5f + PawnHalfHeight))
+	{
+		return false;
+	}
+
+	const FVector Axis = FRotationMatrix(NewRotation).GetScaledAxis(EAxis::Z);
+	FGravityPlanetHit PlanetHit;
+	if (!GravityManager->GetPlanets().SweepCapsule(Start, End, Axis, PawnRadius, PawnHalfHeight, PlanetHit))
+	{
+		OutHit->Reset(1.f, false);
+		UpdatedComponent->MoveComponent(Delta, NewRotation, false, NULL, MoveComponentFlags);
+		return true;
+	}
+
+	// Stop a little short, as PhysX sweeps do, so the next move doesn't start out touching.
+	const float DeltaSize = Delta.Size();
+	const float Time = DeltaSize > KINDA_SMALL_NUMBER ? FMath::Max(0.f, PlanetHit.Time - 0.125f / DeltaSize) : 0.f;
+	SetFromPlanetHit(PlanetHit, Start, End, *OutHit);
+	OutHit->Time = Time;
+	OutHit->Location = Start + Delta * Time;
+	UpdatedComponent->MoveComponent(Delta * Time, NewRotation, false, NULL, MoveComponentFlags);
+	return true;
+}
+
+void UOrbitCharacterMovementComponent::SetFromPlanetHit(const FGravityPlanetHit& PlanetHit, const FVector& Start, const FVector& End, FHitResult& OutHit) const
+{
+	OutHit.Reset(PlanetHit.Time, false);
+	OutHit.bBlockingHit = true;
+	OutHit.bStartPenetrating = PlanetHit.bStartPenetrating;
+	OutHit.PenetrationDepth = PlanetHit.PenetrationDepth;
+	OutHit.Location = PlanetHit.Location;
+	OutHit.ImpactPoint = PlanetHit.ImpactPoint;
+	OutHit.Normal = PlanetHit.Normal;
+	OutHit.ImpactNormal = PlanetHit.Normal;
+	OutHit.TraceStart = Start;
+	OutHit.TraceEnd = End;
+
+	AActor* Planet = GravityManager->GetPlanets().GetActor(PlanetHit.Planet);
+	OutHit.Actor = Planet;
+	OutHit.Component = Planet ? Cast<UPrimitiveComponent>(Planet->GetRootComponent()) : NULL;//becomes our movement base
+}
+
  void UOrbitCharacterMovementComponent::MaintainHorizontalGroundVelocity() { //if (Velocity.Z != 0.f)
 	if (FVector::DotProduct( Velocity, GravityDirection) != 0.f)//gdg
 	{
@@ -1044,6 +1848,11 @@ void UOrbitCharacterMovementComponent::SetPostLandedPhysics(const FHitResult& Hi
 void UOrbitCharacterMovementComponent::OnTeleported()
 {
 	bJustTeleported = true;
+	if (FixedStep.bActive && UpdatedComponent)
+	{
+		//don't draw the teleport as a slide
+		FixedStep.PreviousLocation = FixedStep.CurrentLocation = UpdatedComponent->GetComponentLocation();
+	}
 	if (!HasValidData())
 	{
 		return;
@@ -1144,6 +1953,7 @@ FVector UOrbitCharacterMovementComponent::GetFallingLateralAcceleration(float De
 
 void UOrbitCharacterMovementComponent::PhysFalling(float deltaTime, int32 Iterations)
 {
+	ORBIT_SCOPE_CYCLE_COUNTER(PhysFalling);
 	if (deltaTime < MIN_TICK_TIME)
 	{
 		return;
@@ -1566,6 +2376,8 @@ bool UOrbitCharacterMovementComponent::FloorSweepTest(
 		//YES!!!!!!!!!!!!! End/2.0 makes it work everywhere. Except the poles.
 		//And unless I jump in southern hemisphere which will cause sliding. Didn't I somewhere
 		//double sweep radius?
+		ORBIT_INC_COUNTER(Sweeps, 1);
+		//(that's half of the world space End, so a sweep toward the world origin; PrefetchFloor explains what it does to Hit.Time)
 		bBlockingHit = GetWorld()->SweepSingle(OutHit, Start, End/2.f, GetOwner()->GetActorRotation().Quaternion(), TraceChannel, CollisionShape, Params, ResponseParam);//gdg
 	}
 	else
@@ -1577,12 +2389,14 @@ bool UOrbitCharacterMovementComponent::FloorSweepTest(
 
 		// First test with the box rotated so the corners are along the major axes (ie rotated 45 degrees).
 		//bBlockingHit = GetWorld()->SweepSingle(OutHit, Start, End, FQuat(FVector(0.f, 0.f, -1.f), PI * 0.25f), TraceChannel, BoxShape, Params, ResponseParam);
+		ORBIT_INC_COUNTER(Sweeps, 1);
 		bBlockingHit = GetWorld()->SweepSingle(OutHit, Start, End, GetPawnOwner()->GetActorRotation().Add(0,45,0).Quaternion(), TraceChannel, BoxShape, Params, ResponseParam);
 
 		if (!bBlockingHit)
 		{
 			// Test again with the same box, not rotated.
 			OutHit.Reset(1.f, false);			
+			ORBIT_INC_COUNTER(Sweeps, 1);
 			bBlockingHit = GetWorld()->SweepSingle(OutHit, Start, End, FQuat::Identity, TraceChannel, BoxShape, Params, ResponseParam);
 		}
 	}
@@ -1642,7 +2456,7 @@ bool UOrbitCharacterMovementComponent::StepUp(const FVector& InGravDir, const FV
 	StupidShit = (FVector*) (&InGravDir);
 	*StupidShit = GravityDirection;
 */
-//	SCOPE_CYCLE_COUNTER(super::STAT_CharStepUp);
+	ORBIT_SCOPE_CYCLE_COUNTER(StepUp);
 
 
 	if (!CanStepUp(InHit))	  
@@ -1793,7 +2607,7 @@ bool UOrbitCharacterMovementComponent::StepUp(const FVector& InGravDir, const FV
 			const bool bNormalTowardsMe = (Delta | Hit.ImpactNormal) < 0.f;
 			if (bNormalTowardsMe)
 			{
-				UE_LOG(LogCharacterMovement, Warning, TEXT("- Reject StepUp (unwalkable normal %s opposed to movement)"), *Hit.ImpactNormal.ToString());
+				ORBIT_TRACE(StepUpReject, this, (int32)EOrbitStepUpReject::OpposedNormal);
 				ScopedStepUpMovement.RevertMove();
 				return false;
 			}
@@ -1802,7 +2616,7 @@ bool UOrbitCharacterMovementComponent::StepUp(const FVector& InGravDir, const FV
 			// It's fine to step down onto an unwalkable normal below us, we will just slide off. Rejecting those moves would prevent us from being able to walk off the edge.
 			if ( FVector::DotProduct(Hit.Location, GravityDirection) > FVector::DotProduct(OldLocation, GravityDirection))//gdg
 			{
-				UE_LOG(LogCharacterMovement, Warning, TEXT("- Reject StepUp (unwalkable normal %s above old position)"), *Hit.ImpactNormal.ToString());
+				ORBIT_TRACE(StepUpReject, this, (int32)EOrbitStepUpReject::AboveOldPosition);
 				ScopedStepUpMovement.RevertMove();
 				return false;
 			}
@@ -1811,7 +2625,7 @@ bool UOrbitCharacterMovementComponent::StepUp(const FVector& InGravDir, const FV
 		// Reject moves where the downward sweep hit something very close to the edge of the capsule. This maintains consistency with FindFloor as well.
 		if (!IsWithinEdgeTolerance(Hit.Location, Hit.ImpactPoint, PawnRadius))
 		{
-			UE_LOG(LogCharacterMovement, Warning, TEXT("- Reject StepUp (outside edge tolerance)"));
+			ORBIT_TRACE(StepUpReject, this, (int32)EOrbitStepUpReject::EdgeTolerance);
 			ScopedStepUpMovement.RevertMove();
 			return false;
 		}
@@ -1819,9 +2633,8 @@ bool UOrbitCharacterMovementComponent::StepUp(const FVector& InGravDir, const FV
 		// Don't step up onto invalid surfaces if traveling higher.
 		if (DeltaZ > 0.f && !CanStepUp(Hit))
 		{
-			UE_LOG(LogCharacterMovement, Warning, TEXT("- Reject StepUp (up onto surface with !CanStepUp())"));
+			ORBIT_TRACE(StepUpReject, this, (int32)EOrbitStepUpReject::CannotStepUp);
 			ScopedStepUpMovement.RevertMove();
-	UE_LOG(LogTemp, Warning, TEXT("%d Can't step up"), __LINE__);
 			return false;
 		}
 
@@ -1840,7 +2653,7 @@ bool UOrbitCharacterMovementComponent::StepUp(const FVector& InGravDir, const FV
 				if (!StepDownResult.FloorResult.bBlockingHit && StepSideZ < MAX_STEP_SIDE_Z)
 				{
 					ScopedStepUpMovement.RevertMove();
-	UE_LOG(LogTemp, Warning, TEXT("%d Can't step up"), __LINE__);
+					ORBIT_TRACE(StepUpReject, this, (int32)EOrbitStepUpReject::NoPerch);
 					return false;
 				}
 			}
@@ -2050,7 +2863,7 @@ float UOrbitCharacterMovementComponent::GetValidPerchRadius() const
 
 bool UOrbitCharacterMovementComponent::ShouldComputePerchResult(const FHitResult& InHit, bool bCheckRadius) const
 {
-	if (!InHit.IsValidBlockingHit())
+	if (!InHit.IsValidBlockingHit() || MovementLOD != EOrbitMovementLOD::Full)
 	{
 		return false;
 	}
@@ -2372,6 +3185,23 @@ void UOrbitCharacterMovementComponent::DisplayDebug(UCanvas* Canvas, const FDebu
 	T.Append(FString::Printf(TEXT("FloorDist:%f, LineDist:%f"), CurrentFloor.FloorDist, CurrentFloor.LineDist));
 	Canvas->DrawText(RenderFont, T, 4.0f, YPos );
 	YPos += YL;
+
+	T = FString::Printf(TEXT("Async floor: %s, used:%d, missed:%d"), bAsyncFloorQueries ? TEXT("on") : TEXT("off"), FloorPrefetch.NumUsed, FloorPrefetch.NumMissed);
+	Canvas->DrawText(RenderFont, T, 4.0f, YPos );
+	YPos += YL;
+
+	T = FString::Printf(TEXT("Planet collision: %s, analytic:%d, physx:%d"), bAnalyticPlanetCollision ? TEXT("on") : TEXT("off"), PlanetClearance.NumAnalytic, PlanetClearance.NumPhysX);
+	Canvas->DrawText(RenderFont, T, 4.0f, YPos );
+	YPos += YL;
+
+	T = FString::Printf(TEXT("Fixed step: %s, %.0fHz, steps:%d, dropped frames:%d"), bFixedStepMovement ? TEXT("on") : TEXT("off"), FixedStepRate, FixedStep.NumSteps, FixedStep.NumDropped);
+	Canvas->DrawText(RenderFont, T, 4.0f, YPos );
+	YPos += YL;
+
+	static const TCHAR* MovementLODNames[] = { TEXT("full"), TEXT("reduced"), TEXT("glide") };
+	T = FString::Printf(TEXT("Movement LOD: %s, %s"), bMovementLOD ? TEXT("on") : TEXT("off"), MovementLODNames[MovementLOD]);
+	Canvas->DrawText(RenderFont, T, 4.0f, YPos );
+	YPos += YL;
 }
 
 //This gets called but doesn't appear to do anything in parent
@@ -2420,7 +3250,12 @@ void UOrbitCharacterMovementComponent::MoveAlongFloor(const FVector& InVelocity,
 		{
 			//CanStepUp is called from skippy but not smooth. However, skippy doesn't always get here when skipping
 			//it seems to have something to with going forward.
-			if (CanStepUp(Hit) || (CharacterOwner->GetMovementBase() != NULL && CharacterOwner->GetMovementBase()->GetOwner() == Hit.GetActor()))
+			//nobody near enough to see us take the step at reduced LOD, so we slide along it
+			if (MovementLOD != EOrbitMovementLOD::Full)
+			{
+				SlideAlongSurface(Delta, 1.f - PercentTimeApplied, Hit.Normal, Hit, true);
+			}
+			else if (CanStepUp(Hit) || (CharacterOwner->GetMovementBase() != NULL && CharacterOwner->GetMovementBase()->GetOwner() == Hit.GetActor()))
 			{
 				// hit a barrier, try to step up
 				//const FVector GravDir(0.f, 0.f, -1.f);
@@ -2428,7 +3263,7 @@ void UOrbitCharacterMovementComponent::MoveAlongFloor(const FVector& InVelocity,
 				const FVector GravDir = GravityVector;
 				if (!StepUp(GravDir, Delta * (1.f - PercentTimeApplied), Hit, OutStepDownResult))
 				{
-					UE_LOG(LogCharacterMovement, Warning, TEXT("- StepUp (ImpactNormal %s, Normal %s"), *Hit.ImpactNormal.ToString(), *Hit.Normal.ToString());
+					ORBIT_TRACE(StepUp, this, false, Hit.ImpactNormal | GravityDirection);
 					HandleImpact(Hit, LastMoveTimeSlice, RampVector);
 					//get blocked by my luna
 					SlideAlongSurface(Delta, 1.f - PercentTimeApplied, Hit.Normal, Hit, true);
@@ -2437,7 +3272,7 @@ void UOrbitCharacterMovementComponent::MoveAlongFloor(const FVector& InVelocity,
 				else
 				{
 					// Don't recalculate velocity based on this height adjustment, if considering vertical adjustments.
-					UE_LOG(LogCharacterMovement, Warning, TEXT("+ StepUp (ImpactNormal %s, Normal %s"), *Hit.ImpactNormal.ToString(), *Hit.Normal.ToString());
+					ORBIT_TRACE(StepUp, this, true, Hit.ImpactNormal | GravityDirection);
 					bJustTeleported |= !bMaintainHorizontalGroundVelocity;
 				}
 			}
@@ -2607,6 +3442,14 @@ bool UOrbitCharacterMovementComponent::MoveUpdatedComponent( const FVector& Delt
 	if (UpdatedComponent)
 	{
 		const FVector NewDelta = ConstrainDirectionToPlane(Delta);
+		if (bSweep && OutHit && bAnalyticPlanetCollision && IsFalling() && MoveAgainstPlanets(NewDelta, NewRotation, OutHit))
+		{
+			return true;
+		}
+		if (bSweep)
+		{
+			ORBIT_INC_COUNTER(Sweeps, 1);
+		}
 		bool ret = UpdatedComponent->MoveComponent(NewDelta, NewRotation, bSweep, OutHit, MoveComponentFlags);
 		return ret;
 	}
@@ -2853,8 +3696,7 @@ bool UOrbitCharacterMovementComponent::IsFalling() const
 }
 void UOrbitCharacterMovementComponent::PerformMovement(float DeltaSeconds)
 {
-//	SCOPE_CYCLE_COUNTER(STAT_CharacterMovement);
-//	SCOPE_CYCLE_COUNTER(STAT_CharacterMovementAuthority);
+	ORBIT_SCOPE_CYCLE_COUNTER(PerformMovement);
 
 	if (!HasValidData())
 	{
@@ -3017,6 +3859,9 @@ void UOrbitCharacterMovementComponent::PerformMovement(float DeltaSeconds)
 			RootMotionParams.Clear();
 		}
 
+		// Last, so gravity decides which way is up whatever PhysicsRotation or root motion did.
+		UpdateGravityOrientation();
+
 		// consume path following requested velocity
 		bHasRequestedVelocity = false;
 
@@ -3034,9 +3879,15 @@ void UOrbitCharacterMovementComponent::PerformMovement(float DeltaSeconds)
 
 
 void UOrbitCharacterMovementComponent::RemoveVertical(FVector &OutVector){
-	//should this be GravityDirection or GravityVector...school was so long ago and in a galaxy far, far away
-	OutVector -= OutVector.ProjectOnTo(GravityVector);
+	//either works, only the direction of GravityVector matters
+	OutVector = FromOrbitCore(OrbitCore::RemoveVertical(ToOrbitCore(OutVector), ToOrbitCore(GravityVector)));
 }
 void UOrbitCharacterMovementComponent::RemoveVertical(FVector &OutVector, FVector VerticalComponent){
-	OutVector -= OutVector.ProjectOnTo(VerticalComponent);
+	OutVector = FromOrbitCore(OrbitCore::RemoveVertical(ToOrbitCore(OutVector), ToOrbitCore(VerticalComponent)));
+}
+
+FVector UOrbitCharacterMovementComponent::NewFallVelocity(const FVector& InitialVelocity, const FVector& Gravity, float DeltaTime) const
+{
+	const float TerminalLimit = FMath::Abs(GetPhysicsVolume()->TerminalVelocity);
+	return FromOrbitCore(OrbitCore::NewFallVelocity(ToOrbitCore(InitialVelocity), ToOrbitCore(Gravity), DeltaTime, TerminalLimit));
 }
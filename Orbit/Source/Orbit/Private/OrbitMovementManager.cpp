@@ -0,0 +1,227 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "OrbitMovementManager.h"
+#include "OrbitCharacterMovementComponent.h"
+#include "OrbitStats.h"
+
+static TMap<UWorld*, UOrbitMovementManager*> WorldMovementManagers;
+
+UOrbitMovementManager::UOrbitMovementManager(const class FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	World = NULL;
+	GravityManager = NULL;
+
+	BeforeTick.TickGroup = TG_PrePhysics;
+	BeforeTick.bCanEverTick = true;
+	BeforeTick.bStartWithTickEnabled = true;
+	AfterTick.TickGroup = TG_PrePhysics;
+	AfterTick.bCanEverTick = true;
+	AfterTick.bStartWithTickEnabled = true;
+	AfterTick.bAfterCharacters = true;
+}
+
+UOrbitMovementManager* UOrbitMovementManager::Get(UWorld* InWorld)
+{
+	if (!InWorld)
+	{
+		return NULL;
+	}
+	if (UOrbitMovementManager** Found = WorldMovementManagers.Find(InWorld))
+	{
+		return *Found;
+	}
+
+	static bool bCleanupBound = false;
+	if (!bCleanupBound)
+	{
+		FWorldDelegates::OnWorldCleanup.AddStatic(&UOrbitMovementManager::OnWorldCleanup);
+		bCleanupBound = true;
+	}
+
+	UOrbitMovementManager* Manager = ConstructObject<UOrbitMovementManager>(UOrbitMovementManager::StaticClass(), InWorld);
+	Manager->AddToRoot();//only the map below points at it
+	Manager->World = InWorld;
+	Manager->GravityManager = UGravityManager::Get(InWorld);
+	Manager->BeforeTick.Manager = Manager;
+	Manager->AfterTick.Manager = Manager;
+	if (Manager->GravityManager)
+	{
+		Manager->BeforeTick.AddPrerequisite(Manager->GravityManager, Manager->GravityManager->GravityTick);//read this frame's gravity
+	}
+	Manager->BeforeTick.RegisterTickFunction(InWorld->PersistentLevel);
+	Manager->AfterTick.RegisterTickFunction(InWorld->PersistentLevel);
+	WorldMovementManagers.Add(InWorld, Manager);
+	return Manager;
+}
+
+void UOrbitMovementManager::OnWorldCleanup(UWorld* InWorld, bool bSessionEnded, bool bCleanupResources)
+{
+	UOrbitMovementManager** Found = WorldMovementManagers.Find(InWorld);
+	if (Found)
+	{
+		UOrbitMovementManager* Manager = *Found;
+		WorldMovementManagers.Remove(InWorld);
+		Manager->BeforeTick.UnRegisterTickFunction();
+		Manager->AfterTick.UnRegisterTickFunction();
+		Manager->Components.Empty();
+		Manager->World = NULL;
+		Manager->GravityManager = NULL;
+		Manager->RemoveFromRoot();
+	}
+}
+
+void FOrbitMovementTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Manager && TickType != LEVELTICK_ViewportsOnly)
+	{
+		if (bAfterCharacters)
+		{
+			Manager->TickAfter(DeltaTime);
+		}
+		else
+		{
+			Manager->TickBefore(DeltaTime);
+		}
+	}
+}
+
+FString FOrbitMovementTickFunction::DiagnosticMessage()
+{
+	return bAfterCharacters ? TEXT("FOrbitMovementTickFunction[After]") : TEXT("FOrbitMovementTickFunction[Before]");
+}
+
+void UOrbitMovementManager::Register(UOrbitCharacterMovementComponent* Component)
+{
+	if (!Component || Component->MovementBatchIndex != INDEX_NONE)
+	{
+		return;
+	}
+	Component->MovementBatchIndex = Components.Add(Component);
+	Component->PrimaryComponentTick.AddPrerequisite(this, BeforeTick);
+	AfterTick.AddPrerequisite(Component, Component->PrimaryComponentTick);
+}
+
+void UOrbitMovementManager::Unregister(UOrbitCharacterMovementComponent* Component)
+{
+	if (!Component || !Components.IsValidIndex(Component->MovementBatchIndex) || Components[Component->MovementBatchIndex] != Component)
+	{
+		return;
+	}
+	const int32 Index = Component->MovementBatchIndex;
+	Components.RemoveAtSwap(Index);
+	if (Components.IsValidIndex(Index))
+	{
+		Components[Index]->MovementBatchIndex = Index;
+	}
+	Component->MovementBatchIndex = INDEX_NONE;
+	Component->PrimaryComponentTick.RemovePrerequisite(this, BeforeTick);
+	AfterTick.RemovePrerequisite(Component, Component->PrimaryComponentTick);
+}
+
+/* Gliders use the Acceleration their last tick made from input, so they answer it a frame late.
+   Nobody is close enough to see that, or they wouldn't be gliding.
+*/
+void UOrbitMovementManager::TickBefore(float DeltaTime)
+{
+	ORBIT_SCOPE_CYCLE_COUNTER(MovementBatch);
+
+	// Gravity: one pass through the registry for everyone, in place of each CalculateGravity.
+	const int32 NumComponents = Components.Num();
+	GravityHandles.SetNumUninitialized(NumComponents);
+	for (int32 i = 0; i < NumComponents; i++)
+	{
+		GravityHandles[i] = Components[i]->GravityHandle;
+	}
+	if (GravityManager)
+	{
+		GravityManager->GetGravity(GravityHandles, GravityVectors, GravityMagnitudes);
+	}
+	else
+	{
+		GravityVectors.Init(FVector::ZeroVector, NumComponents);
+		GravityMagnitudes.Init(0.f, NumComponents);
+	}
+	for (int32 i = 0; i < NumComponents; i++)
+	{
+		Components[i]->SetGravity(GravityVectors[i], GravityMagnitudes[i]);
+		Components[i]->MovementBatchFrame = GFrameCounter;
+	}
+
+	// Gliding: gather, step them all, then move each capsule.
+	GlideIndices.Reset();
+	GlideStartLocations.Reset();
+	GlideStartVelocities.Reset();
+	GlideLocations.Reset();
+	GlideVelocities.Reset();
+	GlideAccelerations.Reset();
+	GlideCenters.Reset();
+	GlideHeights.Reset();
+	GlideParams.Reset();
+	for (int32 i = 0; i < NumComponents; i++)
+	{
+		GatherGlide(Components[i], i, DeltaTime);
+	}
+
+	const int32 NumGliders = GlideIndices.Num();
+	if (NumGliders == 0)
+	{
+		return;
+	}
+	OrbitCore::GlideBatch(NumGliders, GlideLocations.GetData(), GlideVelocities.GetData(), GlideAccelerations.GetData(), GlideCenters.GetData(), GlideHeights.GetData(), GlideParams.GetData(), DeltaTime);
+	ORBIT_INC_COUNTER(BatchedGlides, NumGliders);
+
+	for (int32 i = 0; i < NumGliders; i++)
+	{
+		UOrbitCharacterMovementComponent* Component = Components[GlideIndices[i]];
+		Component->EndGlide(DeltaTime, GlideStartLocations[i], GlideStartVelocities[i], FromOrbitCore(GlideLocations[i]), FromOrbitCore(GlideVelocities[i]));
+		Component->GlideBatchFrame = GFrameCounter;
+	}
+}
+
+void UOrbitMovementManager::GatherGlide(UOrbitCharacterMovementComponent* Component, int32 Index, float DeltaTime)
+{
+	// Path following goes through CalcVelocity's requested velocity, which GlideBatch doesn't do; PerformGlide takes those.
+	if (Component->MovementLOD != EOrbitMovementLOD::Glide || !Component->IsGlideSafe() || Component->bHasRequestedVelocity
+		|| !Component->HasGlidePlanet() || !Component->IsComponentTickEnabled() || !Component->HasValidData())
+	{
+		return;
+	}
+
+	Component->BeginGlide(DeltaTime);
+	if (!Component->HasValidData())
+	{
+		return;
+	}
+
+	GlideIndices.Add(Index);
+	GlideStartLocations.Add(Component->UpdatedComponent->GetComponentLocation());
+	GlideStartVelocities.Add(Component->Velocity);
+	GlideLocations.Add(ToOrbitCore(Component->UpdatedComponent->GetComponentLocation()));
+	GlideVelocities.Add(ToOrbitCore(Component->Velocity));
+	GlideAccelerations.Add(ToOrbitCore(Component->Acceleration));
+	GlideCenters.Add(ToOrbitCore(GravityManager->GetPlanets().GetCenter(Component->GlidePlanet)));
+	GlideHeights.Add(Component->GetGlideHeight());
+
+	// What CalcVelocity would have used.
+	OrbitCore::FWalkParams Params;
+	Params.MaxSpeed = FMath::Max(Component->GetMaxSpeed() * Component->AnalogInputModifier, Component->GetMinAnalogSpeed());
+	Params.Friction = Component->GroundFriction;
+	Params.BrakingFriction = (Component->bUseSeparateBrakingFriction ? Component->BrakingFriction : Component->GroundFriction) * FMath::Max(0.f, Component->BrakingFrictionFactor);
+	Params.BrakingDeceleration = Component->BrakingDecelerationWalking;
+	GlideParams.Add(Params);
+}
+
+void UOrbitMovementManager::TickAfter(float DeltaTime)
+{
+	ORBIT_SCOPE_CYCLE_COUNTER(MovementBatch);
+
+	for (UOrbitCharacterMovementComponent* Component : Components)
+	{
+		if (Component->FloorPrefetchFrame == GFrameCounter && Component->HasValidData())
+		{
+			Component->PrefetchFloor(DeltaTime);
+		}
+	}
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "OrbitPerfController.h"
+#include "OrbitCharacterMovementComponent.h"
+
+AOrbitPerfController::AOrbitPerfController(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	JumpInterval = 3.f;
+	TurnInterval = 2.f;
+	NextJump = 0.f;
+	NextTurn = 0.f;
+	TurnRate = 0.f;
+}
+
+void AOrbitPerfController::SetSeed(int32 Seed)
+{
+	Random.Initialize(Seed);
+	NextJump = Random.FRandRange(0.f, 2.f * JumpInterval);
+	NextTurn = Random.FRandRange(0.f, 2.f * TurnInterval);
+}
+
+void AOrbitPerfController::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	ACharacter* Character = Cast<ACharacter>(GetPawn());
+	if (!Character)
+	{
+		return;
+	}
+
+	//the same input a player gives: forward along the capsule, yaw through SumYaw
+	Character->AddMovementInput(Character->GetActorForwardVector(), 1.f);
+
+	NextTurn -= DeltaSeconds;
+	if (NextTurn <= 0.f)
+	{
+		TurnRate = Random.FRandRange(-90.f, 90.f);
+		NextTurn = Random.FRandRange(0.5f, 1.5f) * TurnInterval;
+	}
+	UOrbitCharacterMovementComponent* OrbitMovementComponent = Cast<UOrbitCharacterMovementComponent>(Character->GetCharacterMovement());
+	if (OrbitMovementComponent)
+	{
+		OrbitMovementComponent->SumYaw(TurnRate * DeltaSeconds);
+	}
+
+	NextJump -= DeltaSeconds;
+	if (NextJump <= 0.f)
+	{
+		Character->Jump();
+		NextJump = Random.FRandRange(0.5f, 1.5f) * JumpInterval;
+	}
+	else
+	{
+		Character->StopJumping();
+	}
+}
@@ -0,0 +1,276 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "OrbitPerfGameMode.h"
+#include "OrbitPerfController.h"
+#include "OrbitCharacter.h"
+#include "OrbitStats.h"
+#include "GravityManager.h"
+#include "GameFramework/SpectatorPawn.h"
+#include "Json.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogOrbitPerf, Log, All);
+
+AOrbitPerfGameMode::AOrbitPerfGameMode(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	DefaultPawnClass = ASpectatorPawn::StaticClass();//the player only watches
+	CharacterClass = AOrbitCharacter::StaticClass();
+
+	CharacterCounts.Add(1);
+	CharacterCounts.Add(16);
+	CharacterCounts.Add(64);
+	CharacterCounts.Add(256);
+	WarmupFrames = 120;
+	MeasureFrames = 600;
+	RegressionThreshold = 0.2f;
+	PlanetCenter = FVector(0.f, 0.f, 5000.f);
+	PlanetRadius = 1000.f;
+	SpawnHeight = 150.f;
+
+	CountIndex = 0;
+	Frame = 0;
+	bFinished = false;
+	MovementTickMs = 0.0;
+	Sweeps = 0.0;
+	Queries = 0.0;
+}
+
+void AOrbitPerfGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	FString Counts;
+	if (FParse::Value(FCommandLine::Get(), TEXT("OrbitPerfCounts="), Counts, false))
+	{
+		CharacterCounts.Empty();
+		FString Left;
+		while (Counts.Split(TEXT(","), &Left, &Counts))
+		{
+			CharacterCounts.Add(FCString::Atoi(*Left));
+		}
+		CharacterCounts.Add(FCString::Atoi(*Counts));
+	}
+	CharacterCounts.Sort();//characters are only ever added
+	FParse::Value(FCommandLine::Get(), TEXT("OrbitPerfThreshold="), RegressionThreshold);
+
+	if (UGravityManager* GravityManager = UGravityManager::Get(GetWorld()))
+	{
+		if (GravityManager->GetPlanets().Num() > 0)
+		{
+			PlanetCenter = GravityManager->GetPlanets().GetCenter(0);
+			PlanetRadius = GravityManager->GetPlanets().GetRadius(0);
+		}
+	}
+
+	FOrbitStatsCsv::StartCounting();
+	UE_LOG(LogOrbitPerf, Log, TEXT("OrbitPerf: %d counts, %d warm-up and %d measured frames each, planet %s radius %.0f"),
+		CharacterCounts.Num(), WarmupFrames, MeasureFrames, *PlanetCenter.ToString(), PlanetRadius);
+
+	if (CharacterCounts.Num() == 0)
+	{
+		Finish();
+		return;
+	}
+	SpawnCharacters(CharacterCounts[0]);
+}
+
+void AOrbitPerfGameMode::SpawnCharacters(int32 Count)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.bNoCollisionFail = true;
+	for (int32 i = Characters.Num(); i < Count; i++)
+	{
+		//each character gets its own stream, so a count adds the same characters whatever came before
+		FRandomStream Random(i);
+		const FVector Up = Random.GetUnitVector();
+		const FVector Location = PlanetCenter + Up * (PlanetRadius + SpawnHeight);
+		const FRotator Rotation = FRotationMatrix::MakeFromZ(Up).Rotator();
+
+		AOrbitCharacter* Character = GetWorld()->SpawnActor<AOrbitCharacter>(CharacterClass, Location, Rotation, SpawnParams);
+		AOrbitPerfController* Controller = GetWorld()->SpawnActor<AOrbitPerfController>(SpawnParams);
+		if (!Character || !Controller)
+		{
+			UE_LOG(LogOrbitPerf, Error, TEXT("OrbitPerf: can't spawn character %d"), i);
+			return;
+		}
+		Controller->SetSeed(i);
+		Controller->Possess(Character);
+		Characters.Add(Character);
+	}
+}
+
+void AOrbitPerfGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (bFinished || CountIndex >= CharacterCounts.Num())
+	{
+		return;
+	}
+
+	Frame++;
+	if (Frame <= WarmupFrames)
+	{
+		return;
+	}
+
+	// Both are the last finished frame's.
+	GameThreadMs.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+	MovementTickMs += FOrbitStatsCsv::GetLastFrame(EOrbitStat::MovementTick) + FOrbitStatsCsv::GetLastFrame(EOrbitStat::MovementBatch);
+	Sweeps += FOrbitStatsCsv::GetLastFrame(EOrbitStat::Sweeps);
+	Queries += FOrbitStatsCsv::GetLastFrame(EOrbitStat::Sweeps) + FOrbitStatsCsv::GetLastFrame(EOrbitStat::LineTraces)
+		+ FOrbitStatsCsv::GetLastFrame(EOrbitStat::Overlaps) + FOrbitStatsCsv::GetLastFrame(EOrbitStat::AsyncTraces);
+
+	if (GameThreadMs.Num() >= MeasureFrames)
+	{
+		FinishCount();
+	}
+}
+
+void AOrbitPerfGameMode::FinishCount()
+{
+	FOrbitPerfResult Result;
+	Result.NumCharacters = Characters.Num();
+	Result.NumFrames = GameThreadMs.Num();
+
+	double Total = 0.0;
+	for (float Ms : GameThreadMs)
+	{
+		Total += Ms;
+	}
+	GameThreadMs.Sort();
+	Result.GameThreadMsMean = Total / Result.NumFrames;
+	Result.GameThreadMsP95 = GameThreadMs[FMath::Min(Result.NumFrames * 95 / 100, Result.NumFrames - 1)];
+	Result.GameThreadMsMax = GameThreadMs.Last();
+	Result.MovementTickMsMean = MovementTickMs / Result.NumFrames;
+	Result.SweepsPerFrame = Sweeps / Result.NumFrames;
+	Result.QueriesPerFrame = Queries / Result.NumFrames;
+	Results.Add(Result);
+
+	UE_LOG(LogOrbitPerf, Log, TEXT("OrbitPerf: %d characters: game thread %.2f ms (p95 %.2f, max %.2f), movement %.2f ms, %.1f sweeps and %.1f queries per frame"),
+		Result.NumCharacters, Result.GameThreadMsMean, Result.GameThreadMsP95, Result.GameThreadMsMax, Result.MovementTickMsMean, Result.SweepsPerFrame, Result.QueriesPerFrame);
+
+	GameThreadMs.Empty();
+	MovementTickMs = Sweeps = Queries = 0.0;
+	Frame = 0;
+	CountIndex++;
+	if (CountIndex < CharacterCounts.Num())
+	{
+		SpawnCharacters(CharacterCounts[CountIndex]);
+	}
+	else
+	{
+		Finish();
+	}
+}
+
+void AOrbitPerfGameMode::Finish()
+{
+	bFinished = true;
+
+	TArray<FString> Regressions;
+	bool bPassed = true;
+	FString BaselinePath;
+	if (FParse::Value(FCommandLine::Get(), TEXT("OrbitPerfBaseline="), BaselinePath))
+	{
+		bPassed = CompareWithBaseline(BaselinePath, Regressions);
+	}
+
+	FString ReportPath;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("OrbitPerfReport="), ReportPath))
+	{
+		ReportPath = FPaths::ProfilingDir() / FString::Printf(TEXT("OrbitPerf-%s.json"), *FDateTime::Now().ToString());
+	}
+	if (!WriteReport(ReportPath, bPassed, Regressions))
+	{
+		UE_LOG(LogOrbitPerf, Error, TEXT("OrbitPerf: can't write %s"), *ReportPath);
+		bPassed = false;
+	}
+
+	for (const FString& Regression : Regressions)
+	{
+		UE_LOG(LogOrbitPerf, Error, TEXT("OrbitPerf: %s"), *Regression);
+	}
+	UE_LOG(LogOrbitPerf, Log, TEXT("OrbitPerf: %s, report in %s"), bPassed ? TEXT("passed") : TEXT("FAILED"), *ReportPath);
+	GLog->Flush();
+
+	//forcing is the only way to get a non-zero exit status out of the engine loop
+	FPlatformMisc::RequestExit(!bPassed);
+}
+
+bool AOrbitPerfGameMode::CompareWithBaseline(const FString& BaselinePath, TArray<FString>& Regressions) const
+{
+	FString Text;
+	TSharedPtr<FJsonObject> Baseline;
+	if (!FFileHelper::LoadFileToString(Text, *BaselinePath) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Text), Baseline) || !Baseline.IsValid())
+	{
+		Regressions.Add(FString::Printf(TEXT("can't read baseline %s"), *BaselinePath));
+		return false;
+	}
+
+	const float Limit = 1.f + RegressionThreshold;
+	for (const TSharedPtr<FJsonValue>& Value : Baseline->GetArrayField(TEXT("results")))
+	{
+		const TSharedPtr<FJsonObject> Base = Value->AsObject();
+		if (!Base.IsValid())
+		{
+			continue;
+		}
+		const int32 NumCharacters = (int32)Base->GetNumberField(TEXT("characters"));
+		for (const FOrbitPerfResult& Result : Results)
+		{
+			if (Result.NumCharacters != NumCharacters)
+			{
+				continue;
+			}
+			const double BaseMs = Base->GetNumberField(TEXT("gameThreadMsMean"));
+			const double BaseQueries = Base->GetNumberField(TEXT("queriesPerFrame"));
+			if (Result.GameThreadMsMean > BaseMs * Limit)
+			{
+				Regressions.Add(FString::Printf(TEXT("%d characters: game thread %.2f ms, baseline %.2f ms"), NumCharacters, Result.GameThreadMsMean, BaseMs));
+			}
+			if (Result.QueriesPerFrame > BaseQueries * Limit)
+			{
+				Regressions.Add(FString::Printf(TEXT("%d characters: %.1f queries per frame, baseline %.1f"), NumCharacters, Result.QueriesPerFrame, BaseQueries));
+			}
+		}
+	}
+	return Regressions.Num() == 0;
+}
+
+bool AOrbitPerfGameMode::WriteReport(const FString& Path, bool bPassed, const TArray<FString>& Regressions) const
+{
+	FString Json;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("map"), GetWorld()->GetMapName());
+	Writer->WriteValue(TEXT("passed"), bPassed);
+	Writer->WriteValue(TEXT("threshold"), RegressionThreshold);
+	Writer->WriteArrayStart(TEXT("results"));
+	for (const FOrbitPerfResult& Result : Results)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("characters"), Result.NumCharacters);
+		Writer->WriteValue(TEXT("frames"), Result.NumFrames);
+		Writer->WriteValue(TEXT("gameThreadMsMean"), Result.GameThreadMsMean);
+		Writer->WriteValue(TEXT("gameThreadMsP95"), Result.GameThreadMsP95);
+		Writer->WriteValue(TEXT("gameThreadMsMax"), Result.GameThreadMsMax);
+		Writer->WriteValue(TEXT("movementTickMsMean"), Result.MovementTickMsMean);
+		Writer->WriteValue(TEXT("sweepsPerFrame"), Result.SweepsPerFrame);
+		Writer->WriteValue(TEXT("queriesPerFrame"), Result.QueriesPerFrame);
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+	Writer->WriteArrayStart(TEXT("regressions"));
+	for (const FString& Regression : Regressions)
+	{
+		Writer->WriteValue(Regression);
+	}
+	Writer->WriteArrayEnd();
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	return FFileHelper::SaveStringToFile(Json, *Path);
+}
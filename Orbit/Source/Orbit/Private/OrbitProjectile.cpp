@@ -2,6 +2,7 @@
 
 #include "Orbit.h"
 #include "OrbitProjectile.h"
+#include "OrbitProjectilePool.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 
 AOrbitProjectile::AOrbitProjectile(const FObjectInitializer& ObjectInitializer) 
@@ -29,6 +30,41 @@ AOrbitProjectile::AOrbitProjectile(const FObjectInitializer& ObjectInitializer)
 
 	// Die after 3 seconds by default
 	InitialLifeSpan = 3.0f;
+	PoolSlot = INDEX_NONE;
+}
+
+void AOrbitProjectile::Activate(const FVector& Location, const FRotator& Rotation, APawn* InInstigator)
+{
+	Instigator = InInstigator;
+	SetActorLocationAndRotation(Location, Rotation, false);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	ProjectileMovement->SetUpdatedComponent(CollisionComp);//StopSimulating on a bounce clears it
+	ProjectileMovement->Velocity = Rotation.Vector() * ProjectileMovement->InitialSpeed;
+	ProjectileMovement->UpdateComponentVelocity();
+	ProjectileMovement->SetComponentTickEnabled(true);
+}
+
+void AOrbitProjectile::Deactivate()
+{
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->SetComponentTickEnabled(false);
+	SetActorEnableCollision(false);
+	SetActorHiddenInGame(true);
+	Instigator = NULL;
+}
+
+void AOrbitProjectile::Release()
+{
+	if (AOrbitProjectilePool* OwningPool = Pool.Get())
+	{
+		OwningPool->Release(this);
+	}
+	else
+	{
+		Destroy();
+	}
 }
 
 void AOrbitProjectile::OnHit(AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
@@ -38,6 +74,6 @@ void AOrbitProjectile::OnHit(AActor* OtherActor, UPrimitiveComponent* OtherComp,
 	{
 		OtherComp->AddImpulseAtLocation(GetVelocity() * 100.0f, GetActorLocation());
 
-		Destroy();
+		Release();
 	}
 }
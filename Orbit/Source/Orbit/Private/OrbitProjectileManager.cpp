@@ -0,0 +1,250 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "OrbitProjectileManager.h"
+#include "OrbitProjectile.h"
+#include "OrbitProjectilePool.h"
+#include "GravityManager.h"
+#include "OrbitStats.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+
+AOrbitProjectileManager::AOrbitProjectileManager(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	Instances = ObjectInitializer.CreateDefaultSubobject<UInstancedStaticMeshComponent>(this, TEXT("Instances"));
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);//projectiles sweep for themselves
+	Instances->bCastDynamicShadow = false;
+	RootComponent = Instances;
+
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	ProjectileMesh = NULL;
+	ProjectileMeshScale = FVector(1.f);
+	MaxProjectiles = 4096;
+	GravityManager = NULL;
+}
+
+AOrbitProjectileManager* AOrbitProjectileManager::Get(UWorld* World)
+{
+	if (!World)
+	{
+		return NULL;
+	}
+	for (TActorIterator<AOrbitProjectileManager> Itr(World); Itr; ++Itr)
+	{
+		if (!Itr->IsPendingKill())
+		{
+			return *Itr;
+		}
+	}
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.bNoCollisionFail = true;
+	return World->SpawnActor<AOrbitProjectileManager>(AOrbitProjectileManager::StaticClass(), FVector::ZeroVector, FRotator::ZeroRotator, SpawnInfo);
+}
+
+void AOrbitProjectileManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	GravityManager = UGravityManager::Get(GetWorld());
+	if (GravityManager)
+	{
+		PrimaryActorTick.AddPrerequisite(GravityManager, GravityManager->GravityTick);//sample this frame's sources
+	}
+}
+
+int32 AOrbitProjectileManager::FindOrAddKind(TSubclassOf<AOrbitProjectile> Class)
+{
+	for (int32 i = 0; i < Kinds.Num(); i++)
+	{
+		if (Kinds[i].Class == Class)
+		{
+			return i;
+		}
+	}
+	if (!Class || Kinds.Num() > MAX_uint8)
+	{
+		return INDEX_NONE;
+	}
+
+	const AOrbitProjectile* Defaults = Class->GetDefaultObject<AOrbitProjectile>();
+	const UProjectileMovementComponent* Movement = Defaults->GetProjectileMovement();
+	const USphereComponent* Collision = Defaults->GetCollisionComp();
+
+	FProjectileKind Kind;
+	Kind.Class = Class;
+	Kind.InitialSpeed = Movement->InitialSpeed;
+	Kind.MaxSpeed = Movement->MaxSpeed;
+	Kind.LifeSpan = Defaults->InitialLifeSpan > 0.f ? Defaults->InitialLifeSpan : MAX_FLT;
+	Kind.Radius = Collision->GetScaledSphereRadius();
+	Kind.GravityScale = Movement->ProjectileGravityScale;
+	Kind.Bounciness = Movement->Bounciness;
+	Kind.Friction = Movement->Friction;
+	Kind.bShouldBounce = Movement->bShouldBounce;
+	Kind.Channel = Collision->GetCollisionObjectType();
+	Kind.ResponseParams = FCollisionResponseParams(Collision->GetCollisionResponseToChannels());
+	return Kinds.Add(Kind);
+}
+
+int32 AOrbitProjectileManager::Fire(TSubclassOf<AOrbitProjectile> Class, const FVector& Location, const FRotator& Rotation, APawn* Instigator)
+{
+	const int32 Kind = FindOrAddKind(Class);
+	if (Kind == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+	if (Positions.Num() >= MaxProjectiles)
+	{
+		int32 Oldest = 0;
+		for (int32 i = 1; i < TimeLeft.Num(); i++)
+		{
+			Oldest = TimeLeft[i] < TimeLeft[Oldest] ? i : Oldest;
+		}
+		RemoveProjectile(Oldest);
+	}
+
+	Positions.Add(Location);
+	Velocities.Add(Rotation.Vector() * Kinds[Kind].InitialSpeed);
+	TimeLeft.Add(Kinds[Kind].LifeSpan);
+	KindIndices.Add((uint8)Kind);
+	Instigators.Add(Instigator);
+	return Positions.Num() - 1;
+}
+
+AOrbitProjectile* AOrbitProjectileManager::Promote(int32 Index)
+{
+	if (!Positions.IsValidIndex(Index))
+	{
+		return NULL;
+	}
+
+	AOrbitProjectilePool* ProjectilePool = AOrbitProjectilePool::Get(GetWorld());
+	AOrbitProjectile* Projectile = ProjectilePool ? ProjectilePool->Fire(Kinds[KindIndices[Index]].Class, Positions[Index], Velocities[Index].Rotation(), Instigators[Index].Get()) : NULL;
+	if (Projectile)
+	{
+		Projectile->GetProjectileMovement()->Velocity = Velocities[Index];
+	}
+	RemoveProjectile(Index);
+	return Projectile;
+}
+
+void AOrbitProjectileManager::RemoveProjectile(int32 Index)
+{
+	Positions.RemoveAtSwap(Index);
+	Velocities.RemoveAtSwap(Index);
+	TimeLeft.RemoveAtSwap(Index);
+	KindIndices.RemoveAtSwap(Index);
+	Instigators.RemoveAtSwap(Index);
+}
+
+void AOrbitProjectileManager::Tick(float DeltaSeconds)
+{
+	ORBIT_SCOPE_CYCLE_COUNTER(ProjectileBatch);
+	Super::Tick(DeltaSeconds);
+
+	if (Positions.Num() == 0)
+	{
+		if (Instances->PerInstanceSMData.Num() > 0)
+		{
+			UpdateInstances();
+		}
+		return;
+	}
+
+	// One field sample for the whole batch, through the same kernel as registered bodies.
+	if (GravityManager)
+	{
+		GravityManager->SampleField(Positions, Field);
+	}
+	else
+	{
+		Field.Init(FVector::ZeroVector, Positions.Num());
+	}
+
+	// There is no multi-query call in the physics scene interface, so the batch is one tight
+	// loop of sweeps sharing a single set of query params.
+	UWorld* World = GetWorld();
+	const FCollisionQueryParams Params(NAME_None, false, this);
+	for (int32 i = Positions.Num() - 1; i >= 0; i--)//backwards, so a removal only swaps in one already moved
+	{
+		TimeLeft[i] -= DeltaSeconds;
+		if (TimeLeft[i] <= 0.f)
+		{
+			RemoveProjectile(i);
+			continue;
+		}
+
+		const FProjectileKind& Kind = Kinds[KindIndices[i]];
+		FVector Velocity = Velocities[i] + Field[i] * (Kind.GravityScale * DeltaSeconds);
+		if (Kind.MaxSpeed > 0.f)
+		{
+			Velocity = Velocity.GetClampedToMaxSize(Kind.MaxSpeed);
+		}
+
+		const FVector End = Positions[i] + Velocity * DeltaSeconds;
+		FHitResult Hit;
+		ORBIT_INC_COUNTER(Sweeps, 1);
+		if (!World->SweepSingle(Hit, Positions[i], End, FQuat::Identity, Kind.Channel, FCollisionShape::MakeSphere(Kind.Radius), Params, Kind.ResponseParams))
+		{
+			Positions[i] = End;
+			Velocities[i] = Velocity;
+			continue;
+		}
+		if (Hit.Component.IsValid() && Hit.Component->IsSimulatingPhysics())
+		{
+			// Pushing physics bodies around is the projectile actor's job (its OnHit), so hand this one over at the contact.
+			Positions[i] = Hit.Location;
+			Velocities[i] = Velocity;
+			Promote(i);
+			continue;
+		}
+		if (!Kind.bShouldBounce)
+		{
+			RemoveProjectile(i);
+			continue;
+		}
+
+		// Bounce the way UProjectileMovementComponent does: Bounciness of the normal part survives, Friction takes from the rest.
+		const float Into = Velocity | Hit.Normal;
+		if (Into < 0.f)
+		{
+			const FVector Tangent = Velocity - Hit.Normal * Into;
+			Velocity = Tangent * (1.f - Kind.Friction) - Hit.Normal * (Into * Kind.Bounciness);
+		}
+		Positions[i] = Hit.Location;
+		Velocities[i] = Velocity;
+	}
+
+	UpdateInstances();
+}
+
+// Instance transforms are written in place and the render state rebuilt once, rather than
+// UpdateInstanceTransform per projectile, which dirties the render state on every call.
+void AOrbitProjectileManager::UpdateInstances()
+{
+	if (ProjectileMesh && Instances->StaticMesh != ProjectileMesh)
+	{
+		Instances->SetStaticMesh(ProjectileMesh);
+	}
+
+	TArray<FInstancedStaticMeshInstanceData>& Data = Instances->PerInstanceSMData;
+	const int32 OldNum = Data.Num();
+	Data.SetNumUninitialized(Positions.Num());
+	for (int32 i = OldNum; i < Data.Num(); i++)
+	{
+		Data[i].LightmapUVBias = FVector2D(-1.f, -1.f);
+		Data[i].ShadowmapUVBias = FVector2D(-1.f, -1.f);
+	}
+
+	const FScaleMatrix Scale(ProjectileMeshScale);
+	for (int32 i = 0; i < Data.Num(); i++)
+	{
+		FMatrix Transform = Velocities[i].IsNearlyZero() ? Scale : Scale * FRotationMatrix::MakeFromX(Velocities[i]);
+		Transform.SetOrigin(Positions[i]);
+		Data[i].Transform = Transform;
+	}
+
+	Instances->UpdateBounds();
+	Instances->MarkRenderStateDirty();
+}
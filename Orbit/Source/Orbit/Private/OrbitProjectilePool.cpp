@@ -0,0 +1,363 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "OrbitProjectilePool.h"
+#include "OrbitProjectile.h"
+#include "OrbitCharacter.h"
+
+// Wall time spent in garbage collection, for Orbit.ProjectileBench.
+static double GBenchGcStart = 0.0;
+static double GBenchGcTime = 0.0;
+static int32 GBenchNumGc = 0;
+
+static void OnBenchPreGarbageCollect()
+{
+	GBenchGcStart = FPlatformTime::Seconds();
+}
+
+static void OnBenchPostGarbageCollect()
+{
+	GBenchGcTime += FPlatformTime::Seconds() - GBenchGcStart;
+	GBenchNumGc++;
+}
+
+static void RunProjectileBench(const TArray<FString>& Args, UWorld* World)
+{
+	AOrbitProjectilePool* Pool = AOrbitProjectilePool::Get(World);
+	if (Pool)
+	{
+		const int32 Rounds = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000;
+		const int32 RoundsPerFrame = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 50;
+		Pool->StartBench(Rounds, RoundsPerFrame);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ProjectileBenchCommand(
+	TEXT("Orbit.ProjectileBench"),
+	TEXT("Orbit.ProjectileBench [Rounds=10000] [RoundsPerFrame=50]: fires Rounds projectiles as spawned actors, then from the pool, and logs frame and GC time of both."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunProjectileBench));
+
+AOrbitProjectilePool::AOrbitProjectilePool(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	WarmUpSize = 64;
+	MaxPoolSize = 512;
+
+	FMemory::Memzero(Bench.Results, sizeof(Bench.Results));
+	Bench.Rounds = 0;
+	Bench.RoundsPerFrame = 0;
+	Bench.Phase = 2;
+	Bench.DrainUntil = 0.0;
+	Bench.bCollecting = false;
+	Bench.bSkipFrame = false;
+	Bench.NumGcAtRequest = 0;
+	Bench.SavedMaxPoolSize = 0;
+	Bench.PeakInFlight = 0;
+}
+
+AOrbitProjectilePool* AOrbitProjectilePool::Get(UWorld* World)
+{
+	if (!World)
+	{
+		return NULL;
+	}
+	for (TActorIterator<AOrbitProjectilePool> Itr(World); Itr; ++Itr)
+	{
+		if (!Itr->IsPendingKill())
+		{
+			return *Itr;
+		}
+	}
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.bNoCollisionFail = true;
+	return World->SpawnActor<AOrbitProjectilePool>(AOrbitProjectilePool::StaticClass(), FVector::ZeroVector, FRotator::ZeroRotator, SpawnInfo);
+}
+
+FOrbitProjectileClassPool& AOrbitProjectilePool::FindOrAddPool(TSubclassOf<AOrbitProjectile> Class)
+{
+	for (FOrbitProjectileClassPool& Pool : Pools)
+	{
+		if (Pool.Class == Class)
+		{
+			return Pool;
+		}
+	}
+
+	FOrbitProjectileClassPool& Pool = Pools[Pools.Add(FOrbitProjectileClassPool())];
+	Pool.Class = Class;
+	Pool.LifeSpan = Class->GetDefaultObject<AOrbitProjectile>()->InitialLifeSpan;
+	for (int32 i = 0; i < WarmUpSize && i < MaxPoolSize; i++)
+	{
+		SpawnParked(Pool);
+	}
+	return Pool;
+}
+
+void AOrbitProjectilePool::WarmUp(TSubclassOf<AOrbitProjectile> Class, int32 Count)
+{
+	if (!Class)
+	{
+		return;
+	}
+	FOrbitProjectileClassPool& Pool = FindOrAddPool(Class);
+	while (Pool.Free.Num() + Pool.Active.Num() < FMath::Min(Count, MaxPoolSize) && SpawnParked(Pool))
+	{
+	}
+}
+
+AOrbitProjectile* AOrbitProjectilePool::SpawnParked(FOrbitProjectileClassPool& Pool)
+{
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.Owner = this;
+	SpawnInfo.bNoCollisionFail = true;
+	AOrbitProjectile* Projectile = GetWorld()->SpawnActor<AOrbitProjectile>(Pool.Class, GetActorLocation(), FRotator::ZeroRotator, SpawnInfo);
+	if (!Projectile)
+	{
+		return NULL;
+	}
+	Projectile->SetLifeSpan(0.f);//timed here instead, its own timer would destroy it
+	Projectile->Pool = this;
+	Projectile->Deactivate();
+	Pool.Free.Add(Projectile);
+	Stats.NumSpawned++;
+	return Projectile;
+}
+
+AOrbitProjectile* AOrbitProjectilePool::Fire(TSubclassOf<AOrbitProjectile> Class, const FVector& Location, const FRotator& Rotation, APawn* InInstigator)
+{
+	if (!Class)
+	{
+		return NULL;
+	}
+	FOrbitProjectileClassPool& Pool = FindOrAddPool(Class);
+
+	AOrbitProjectile* Projectile = NULL;
+	while (!Projectile && Pool.Free.Num() > 0)
+	{
+		Projectile = Pool.Free.Pop(false);//NULL if something destroyed it while parked
+	}
+	if (Projectile)
+	{
+		Stats.NumReused++;
+	}
+	else if (Pool.Active.Num() < MaxPoolSize)
+	{
+		Stats.NumGrown++;
+		Projectile = SpawnParked(Pool) ? Pool.Free.Pop(false) : NULL;
+	}
+	else
+	{
+		Stats.NumRecycled++;
+		int32 Oldest = 0;
+		for (int32 i = 1; i < Pool.ExpireTimes.Num(); i++)
+		{
+			Oldest = Pool.ExpireTimes[i] < Pool.ExpireTimes[Oldest] ? i : Oldest;
+		}
+		Park(Pool, Oldest);
+		Projectile = Pool.Free.Num() > 0 ? Pool.Free.Pop(false) : NULL;
+	}
+	if (!Projectile)
+	{
+		return NULL;
+	}
+
+	Projectile->Activate(Location, Rotation, InInstigator);
+	Projectile->PoolSlot = Pool.Active.Add(Projectile);
+	Pool.ExpireTimes.Add(Pool.LifeSpan > 0.f ? GetWorld()->GetTimeSeconds() + Pool.LifeSpan : MAX_FLT);
+	Stats.NumFired++;
+	Stats.NumActive++;
+	Stats.PeakActive = FMath::Max(Stats.PeakActive, Stats.NumActive);
+	return Projectile;
+}
+
+void AOrbitProjectilePool::Release(AOrbitProjectile* Projectile)
+{
+	if (!Projectile)
+	{
+		return;
+	}
+	for (FOrbitProjectileClassPool& Pool : Pools)
+	{
+		if (Pool.Active.IsValidIndex(Projectile->PoolSlot) && Pool.Active[Projectile->PoolSlot] == Projectile)
+		{
+			Park(Pool, Projectile->PoolSlot);
+			return;
+		}
+	}
+	if (Projectile->Pool.Get() != this)
+	{
+		Projectile->Destroy();
+	}
+}
+
+void AOrbitProjectilePool::Park(FOrbitProjectileClassPool& Pool, int32 ActiveIndex)
+{
+	AOrbitProjectile* Projectile = Pool.Active[ActiveIndex];
+	Pool.Active.RemoveAtSwap(ActiveIndex);
+	Pool.ExpireTimes.RemoveAtSwap(ActiveIndex);
+	if (Pool.Active.IsValidIndex(ActiveIndex) && Pool.Active[ActiveIndex])
+	{
+		Pool.Active[ActiveIndex]->PoolSlot = ActiveIndex;
+	}
+	Stats.NumActive--;
+
+	if (Projectile)
+	{
+		Projectile->Deactivate();
+		Projectile->PoolSlot = INDEX_NONE;
+		Pool.Free.Add(Projectile);
+	}
+}
+
+void AOrbitProjectilePool::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (FOrbitProjectileClassPool& Pool : Pools)
+	{
+		for (int32 i = Pool.Active.Num() - 1; i >= 0; i--)
+		{
+			if (!Pool.Active[i] || Pool.ExpireTimes[i] <= Now)
+			{
+				Park(Pool, i);
+			}
+		}
+	}
+
+	if (Bench.Phase < 2)
+	{
+		TickBench(DeltaSeconds);
+	}
+}
+
+void AOrbitProjectilePool::StartBench(int32 Rounds, int32 RoundsPerFrame)
+{
+	static bool bGcBound = false;
+	if (!bGcBound)
+	{
+		FCoreUObjectDelegates::PreGarbageCollect.AddStatic(&OnBenchPreGarbageCollect);
+		FCoreUObjectDelegates::PostGarbageCollect.AddStatic(&OnBenchPostGarbageCollect);
+		bGcBound = true;
+	}
+
+	Bench.Class = AOrbitProjectile::StaticClass();
+	for (TActorIterator<AOrbitCharacter> Itr(GetWorld()); Itr; ++Itr)
+	{
+		if (Itr->ProjectileClass)
+		{
+			Bench.Class = Itr->ProjectileClass;//the blueprint has the mesh and any OnHit wiring
+			break;
+		}
+	}
+	FMemory::Memzero(Bench.Results, sizeof(Bench.Results));
+	Bench.Rounds = FMath::Max(Rounds, 1);
+	Bench.RoundsPerFrame = FMath::Max(RoundsPerFrame, 1);
+	Bench.Phase = 0;
+	Bench.DrainUntil = 0.0;
+	Bench.bCollecting = false;
+	Bench.bSkipFrame = false;
+	Bench.PeakInFlight = 0;
+	Bench.SavedMaxPoolSize = MaxPoolSize;
+	MaxPoolSize = FMath::Max(MaxPoolSize, Bench.Rounds);//same number in flight as the spawn phase
+	GBenchGcTime = 0.0;
+	GBenchNumGc = 0;
+	UE_LOG(LogTemp, Log, TEXT("ProjectileBench: %d rounds of %s, %d per frame"), Bench.Rounds, *Bench.Class->GetName(), Bench.RoundsPerFrame);
+}
+
+// Each phase fires its rounds, waits out their life span, then forces a collection so the
+// garbage it left behind is paid for inside the phase.
+void AOrbitProjectilePool::TickBench(float DeltaSeconds)
+{
+	if (Bench.bSkipFrame)
+	{
+		Bench.bSkipFrame = false;
+		return;
+	}
+
+	FBenchPhase& Result = Bench.Results[Bench.Phase];
+	Result.Frames++;
+	Result.FrameTime += DeltaSeconds;
+	Result.MaxFrameTime = FMath::Max(Result.MaxFrameTime, (double)DeltaSeconds);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (Result.Fired < Bench.Rounds)
+	{
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.bNoCollisionFail = true;
+		for (int32 k = 0; k < Bench.RoundsPerFrame && Result.Fired < Bench.Rounds; k++, Result.Fired++)
+		{
+			const FRotator Rotation = FMath::VRand().Rotation();
+			if (Bench.Phase == 1)
+			{
+				Fire(Bench.Class, GetActorLocation(), Rotation, NULL);
+			}
+			else
+			{
+				GetWorld()->SpawnActor<AOrbitProjectile>(Bench.Class, GetActorLocation(), Rotation, SpawnInfo);
+			}
+		}
+		if (Result.Fired == Bench.Rounds && Bench.Phase == 0)
+		{
+			// Everything fired within the last life span is still up, the most the pool will have to hold at once.
+			for (TActorIterator<AOrbitProjectile> Itr(GetWorld()); Itr; ++Itr)
+			{
+				if (Itr->GetOwner() != this && !Itr->IsPendingKill())
+				{
+					Bench.PeakInFlight++;
+				}
+			}
+		}
+		if (Result.Fired == Bench.Rounds)
+		{
+			Bench.DrainUntil = Now + Bench.Class->GetDefaultObject<AOrbitProjectile>()->InitialLifeSpan + 0.5f;
+		}
+		return;
+	}
+
+	if (!Bench.bCollecting)
+	{
+		if (Now >= Bench.DrainUntil)
+		{
+			GEngine->ForceGarbageCollection(true);
+			Bench.bCollecting = true;
+			Bench.NumGcAtRequest = GBenchNumGc;
+		}
+		return;
+	}
+	if (GBenchNumGc == Bench.NumGcAtRequest)
+	{
+		return;
+	}
+
+	Result.GcTime = GBenchGcTime;
+	Result.NumGc = GBenchNumGc;
+	GBenchGcTime = 0.0;
+	GBenchNumGc = 0;
+	Bench.bCollecting = false;
+	Bench.Phase++;
+	if (Bench.Phase < 2)
+	{
+		// Park the spawn phase's peak up front, plus slack for pooled frames running faster, so the
+		// timed phase measures reuse rather than the pool growing.
+		WarmUp(Bench.Class, FMath::Max(WarmUpSize, Bench.PeakInFlight + Bench.PeakInFlight / 4 + Bench.RoundsPerFrame));
+		Bench.StatsBefore = Stats;
+		Bench.bSkipFrame = true;
+		return;
+	}
+
+	MaxPoolSize = Bench.SavedMaxPoolSize;
+	static const TCHAR* PhaseNames[] = { TEXT("spawn/destroy"), TEXT("pooled") };
+	for (int32 Phase = 0; Phase < 2; Phase++)
+	{
+		const FBenchPhase& Done = Bench.Results[Phase];
+		UE_LOG(LogTemp, Log, TEXT("ProjectileBench %s: %d frames, frame avg %.2f ms max %.2f ms, GC %d passes %.2f ms"),
+			PhaseNames[Phase], Done.Frames, 1000.0 * Done.FrameTime / FMath::Max(Done.Frames, 1), 1000.0 * Done.MaxFrameTime, Done.NumGc, 1000.0 * Done.GcTime);
+	}
+	const int32 Fired = Stats.NumFired - Bench.StatsBefore.NumFired;
+	const int32 Reused = Stats.NumReused - Bench.StatsBefore.NumReused;
+	UE_LOG(LogTemp, Log, TEXT("ProjectileBench pooled: %d of %d shots reused (%.1f%%), %d grown, %d recycled; peak %d in flight, %d in the spawn phase"),
+		Reused, Fired, 100.0 * Reused / FMath::Max(Fired, 1), Stats.NumGrown - Bench.StatsBefore.NumGrown, Stats.NumRecycled - Bench.StatsBefore.NumRecycled,
+		Stats.PeakActive, Bench.PeakInFlight);
+}
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "OrbitRepMovement.h"
+
+void FOrbitRepMovement::Set(AActor* InBody, const FVector& Location, const FVector& Velocity, const FRotator& Rotation)
+{
+	// A body the client can't resolve (spawned at runtime and not replicated) would never come through; world space instead.
+	Body = InBody && (InBody->IsNameStableForNetworking() || InBody->GetIsReplicated()) ? InBody : NULL;
+	if (Body)
+	{
+		Quantized = OrbitCore::QuantizeRelative(ToOrbitCore(Body->GetActorLocation()), ToOrbitCore(Location), ToOrbitCore(Velocity), ToOrbitCore(Rotation.Vector()));
+	}
+	else
+	{
+		Quantized = OrbitCore::QuantizeWorld(ToOrbitCore(Location), ToOrbitCore(Velocity), Rotation.Pitch, Rotation.Yaw, Rotation.Roll);
+	}
+}
+
+bool FOrbitRepMovement::Get(FVector& OutLocation, FVector& OutVelocity, FRotator& OutRotation) const
+{
+	if (!Quantized.bRelative)
+	{
+		OrbitCore::FVec Location, Velocity;
+		OrbitCore::DequantizeWorld(Quantized, Location, Velocity, OutRotation.Pitch, OutRotation.Yaw, OutRotation.Roll);
+		OutLocation = FromOrbitCore(Location);
+		OutVelocity = FromOrbitCore(Velocity);
+		return true;
+	}
+	if (!Body)
+	{
+		return false;
+	}
+
+	OrbitCore::FVec Location, Velocity, Up, Forward;
+	OrbitCore::DequantizeRelative(Quantized, ToOrbitCore(Body->GetActorLocation()), Location, Velocity, Up, Forward);
+	OutLocation = FromOrbitCore(Location);
+	OutVelocity = FromOrbitCore(Velocity);
+	OutRotation = FRotationMatrix::MakeFromZX(FromOrbitCore(Up), FromOrbitCore(Forward)).Rotator();
+	return true;
+}
+
+bool FOrbitRepMovement::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	OrbitCore::SerializeQuantized(Ar, Quantized);
+
+	bOutSuccess = true;
+	if (Quantized.bRelative)
+	{
+		UObject* Object = Body;
+		bOutSuccess = Map->SerializeObject(Ar, AActor::StaticClass(), Object);
+		Body = Cast<AActor>(Object);
+	}
+	else if (Ar.IsLoading())
+	{
+		Body = NULL;
+	}
+	return true;
+}
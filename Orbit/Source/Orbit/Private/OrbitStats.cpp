@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "OrbitStats.h"
+
+DEFINE_STAT(STAT_OrbitGravitySolve);
+DEFINE_STAT(STAT_OrbitGravityIntegrate);
+DEFINE_STAT(STAT_OrbitGravitySample);
+DEFINE_STAT(STAT_OrbitTrajectories);
+DEFINE_STAT(STAT_OrbitMovementTick);
+DEFINE_STAT(STAT_OrbitPerformMovement);
+DEFINE_STAT(STAT_OrbitPerformGlide);
+DEFINE_STAT(STAT_OrbitFindFloor);
+DEFINE_STAT(STAT_OrbitStepUp);
+DEFINE_STAT(STAT_OrbitPhysWalking);
+DEFINE_STAT(STAT_OrbitPhysFalling);
+DEFINE_STAT(STAT_OrbitRotationUpdate);
+DEFINE_STAT(STAT_OrbitProjectileBatch);
+DEFINE_STAT(STAT_OrbitMovementBatch);
+
+DEFINE_STAT(STAT_OrbitFloorQueries);
+DEFINE_STAT(STAT_OrbitSweeps);
+DEFINE_STAT(STAT_OrbitLineTraces);
+DEFINE_STAT(STAT_OrbitOverlaps);
+DEFINE_STAT(STAT_OrbitAsyncTraces);
+DEFINE_STAT(STAT_OrbitPrefetchedFloors);
+DEFINE_STAT(STAT_OrbitAnalyticQueries);
+DEFINE_STAT(STAT_OrbitGravityReceivers);
+DEFINE_STAT(STAT_OrbitGravitySamplePoints);
+DEFINE_STAT(STAT_OrbitMovementSteps);
+DEFINE_STAT(STAT_OrbitBatchedGlides);
+
+static const TCHAR* OrbitStatNames[EOrbitStat::Num] =
+{
+	TEXT("GravitySolveMs"),
+	TEXT("GravityIntegrateMs"),
+	TEXT("GravitySampleMs"),
+	TEXT("TrajectoriesMs"),
+	TEXT("MovementTickMs"),
+	TEXT("PerformMovementMs"),
+	TEXT("PerformGlideMs"),
+	TEXT("FindFloorMs"),
+	TEXT("StepUpMs"),
+	TEXT("PhysWalkingMs"),
+	TEXT("PhysFallingMs"),
+	TEXT("RotationUpdateMs"),
+	TEXT("ProjectileBatchMs"),
+	TEXT("MovementBatchMs"),
+	TEXT("FloorQueries"),
+	TEXT("Sweeps"),
+	TEXT("LineTraces"),
+	TEXT("Overlaps"),
+	TEXT("AsyncTraces"),
+	TEXT("PrefetchedFloors"),
+	TEXT("AnalyticQueries"),
+	TEXT("GravityReceivers"),
+	TEXT("GravitySamplePoints"),
+	TEXT("MovementSteps"),
+	TEXT("BatchedGlides"),
+};
+
+bool FOrbitStatsCsv::bEnabled = false;
+bool FOrbitStatsCsv::bInitialized = false;
+FArchive* FOrbitStatsCsv::Writer = NULL;
+uint64 FOrbitStatsCsv::Frame = 0;
+double FOrbitStatsCsv::Values[EOrbitStat::Num];
+double FOrbitStatsCsv::LastValues[EOrbitStat::Num];
+
+void FOrbitStatsCsv::AddCycles(EOrbitStat::Type Stat, uint32 Cycles)
+{
+	if (bEnabled && IsInGameThread())
+	{
+		Values[Stat] += FPlatformTime::ToMilliseconds(Cycles);
+	}
+}
+
+void FOrbitStatsCsv::AddCount(EOrbitStat::Type Stat, int32 Count)
+{
+	if (bEnabled && IsInGameThread())
+	{
+		Values[Stat] += Count;
+	}
+}
+
+void FOrbitStatsCsv::Initialize()
+{
+	bInitialized = true;
+	if (!FParse::Param(FCommandLine::Get(), TEXT("OrbitStatsCsv")) && !FCString::Strifind(FCommandLine::Get(), TEXT("-OrbitStatsCsv=")))
+	{
+		return;
+	}
+
+	FString Path;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("OrbitStatsCsv="), Path))
+	{
+		Path = FPaths::ProfilingDir() / FString::Printf(TEXT("OrbitStats-%s.csv"), *FDateTime::Now().ToString());
+	}
+	Writer = IFileManager::Get().CreateFileWriter(*Path);
+	if (!Writer)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("OrbitStatsCsv: can't write %s"), *Path);
+		return;
+	}
+
+	FString Header = TEXT("Frame,FrameMs");
+	for (int32 i = 0; i < EOrbitStat::Num; i++)
+	{
+		Header += TEXT(",");
+		Header += OrbitStatNames[i];
+	}
+	Header += LINE_TERMINATOR;
+	FTCHARToUTF8 Utf8(*Header);
+	Writer->Serialize((void*)Utf8.Get(), Utf8.Length());
+
+	FMemory::Memzero(Values, sizeof(Values));
+	Frame = GFrameCounter;
+	bEnabled = true;
+	FCoreDelegates::OnExit.AddStatic(&FOrbitStatsCsv::Shutdown);
+	UE_LOG(LogTemp, Log, TEXT("OrbitStatsCsv: writing %s"), *Path);
+}
+
+void FOrbitStatsCsv::Shutdown()
+{
+	bEnabled = false;
+	if (Writer)
+	{
+		Writer->Close();
+		delete Writer;
+		Writer = NULL;
+	}
+}
+
+void FOrbitStatsCsv::StartCounting()
+{
+	if (!bInitialized)
+	{
+		Initialize();
+	}
+	if (!bEnabled)
+	{
+		FMemory::Memzero(Values, sizeof(Values));
+		FMemory::Memzero(LastValues, sizeof(LastValues));
+		Frame = GFrameCounter;
+		bEnabled = true;
+	}
+}
+
+void FOrbitStatsCsv::Tick()
+{
+	if (!bInitialized)
+	{
+		Initialize();
+	}
+	if (!bEnabled || GFrameCounter == Frame)
+	{
+		return;//PIE has a gravity tick per world
+	}
+
+	FMemory::Memcpy(LastValues, Values, sizeof(Values));
+	if (Writer)
+	{
+		FString Row = FString::Printf(TEXT("%llu,%.3f"), Frame, FApp::GetDeltaTime() * 1000.0);
+		for (int32 i = 0; i < EOrbitStat::Num; i++)
+		{
+			Row += i < EOrbitStat::NumTimers ? FString::Printf(TEXT(",%.3f"), Values[i]) : FString::Printf(TEXT(",%d"), (int32)Values[i]);
+		}
+		Row += LINE_TERMINATOR;
+		FTCHARToUTF8 Utf8(*Row);
+		Writer->Serialize((void*)Utf8.Get(), Utf8.Length());
+	}
+
+	FMemory::Memzero(Values, sizeof(Values));
+	Frame = GFrameCounter;
+}
@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Orbit.h"
+#include "OrbitTrace.h"
+
+static_assert(sizeof(FOrbitTraceEvent) == 32, "The decoder reads 32 byte events");
+
+// Names and fields for the file, in EOrbitTrace order. Fields are Name:f (float), Name:i (int) or Name:x (hex).
+static const ANSICHAR* OrbitTraceTypes[EOrbitTrace::Num][2] =
+{
+	{ "FloorAdjust", "MoveDist:f,Hit:i" },
+	{ "WalkableReject", "NormalX:f,NormalY:f,NormalZ:f" },
+	{ "NoFloor", "SweepDistance:f" },
+	{ "WalkingOffFloor", "Falling:i" },
+	{ "StepUp", "Result:i,NormalDotGravity:f" },
+	{ "StepUpReject", "Reason:i" },
+	{ "ModeChange", "PrevMode:i,Mode:i,CustomMode:i" },
+	{ "MissingGravityBody", "NameCrc:x" },
+};
+
+static const uint32 OrbitTraceVersion = 1;
+
+int32 FOrbitTrace::Enabled = 1;
+
+static uint32 OrbitTraceTlsSlot = FPlatformTLS::AllocTlsSlot();
+static TArray<void*> OrbitTraceBuffers;	// every thread that ever wrote; kept for the dump after it exits
+static FCriticalSection OrbitTraceBuffersLock;
+
+static FAutoConsoleVariableRef CVarOrbitTrace(
+	TEXT("Orbit.Trace"),
+	FOrbitTrace::Enabled,
+	TEXT("Record Orbit hot-path events for Orbit.TraceDump. 0 off, 1 on."));
+
+static void DumpOrbitTrace(const TArray<FString>& Args)
+{
+	const FString Path = Args.Num() > 0 ? Args[0] : FPaths::ProfilingDir() / FString::Printf(TEXT("OrbitTrace-%s.otrace"), *FDateTime::Now().ToString());
+	if (FOrbitTrace::Dump(Path))
+	{
+		UE_LOG(LogTemp, Log, TEXT("OrbitTrace: wrote %s"), *Path);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("OrbitTrace: can't write %s"), *Path);
+	}
+}
+
+static FAutoConsoleCommand OrbitTraceDumpCommand(
+	TEXT("Orbit.TraceDump"),
+	TEXT("Orbit.TraceDump [Path]: write the recorded Orbit events for Orbit/Tools/OrbitTraceDecode.py."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&DumpOrbitTrace));
+
+FOrbitTrace::FBuffer* FOrbitTrace::AddThread()
+{
+	FBuffer* Buffer = new FBuffer();
+	Buffer->Head = 0;
+	Buffer->ThreadId = FPlatformTLS::GetCurrentThreadId();
+	FPlatformTLS::SetTlsValue(OrbitTraceTlsSlot, Buffer);
+
+	FScopeLock Lock(&OrbitTraceBuffersLock);//once per thread
+	OrbitTraceBuffers.Add(Buffer);
+	return Buffer;
+}
+
+void FOrbitTrace::Write(EOrbitTrace::Type Type, const UObject* Object, FOrbitTraceValue A, FOrbitTraceValue B, FOrbitTraceValue C)
+{
+	FBuffer* Buffer = (FBuffer*)FPlatformTLS::GetTlsValue(OrbitTraceTlsSlot);
+	if (!Buffer)
+	{
+		Buffer = AddThread();
+	}
+
+	const uint32 Head = Buffer->Head;
+	FOrbitTraceEvent& Event = Buffer->Events[Head & (EventsPerThread - 1)];
+	Event.Time = FPlatformTime::Seconds();
+	Event.Frame = (uint32)GFrameCounter;
+	Event.Type = (uint16)Type;
+	Event.Reserved = 0;
+	Event.Object = Object ? Object->GetUniqueID() : 0;
+	Event.Data[0] = A;
+	Event.Data[1] = B;
+	Event.Data[2] = C;
+
+	// The event has to be in memory before a dump on another thread can see it counted.
+	FPlatformMisc::MemoryBarrier();
+	Buffer->Head = Head + 1;
+}
+
+/* File layout, little endian:
+     "ORBTRACE" uint32 Version uint32 NumTypes
+     NumTypes x { uint8 NameLength, Name, uint8 FieldsLength, Fields }
+     uint32 NumThreads
+     NumThreads x { uint32 ThreadId, uint32 NumEvents, NumEvents x FOrbitTraceEvent }
+*/
+bool FOrbitTrace::Dump(const FString& Path)
+{
+	FArchive* Writer = IFileManager::Get().CreateFileWriter(*Path);
+	if (!Writer)
+	{
+		return false;
+	}
+
+	Writer->Serialize((void*)"ORBTRACE", 8);
+	uint32 Version = OrbitTraceVersion;
+	uint32 NumTypes = EOrbitTrace::Num;
+	*Writer << Version << NumTypes;
+	for (uint32 i = 0; i < NumTypes; i++)
+	{
+		for (int32 k = 0; k < 2; k++)
+		{
+			uint8 Length = (uint8)FCStringAnsi::Strlen(OrbitTraceTypes[i][k]);
+			*Writer << Length;
+			Writer->Serialize((void*)OrbitTraceTypes[i][k], Length);
+		}
+	}
+
+	TArray<void*> Buffers;
+	{
+		FScopeLock Lock(&OrbitTraceBuffersLock);
+		Buffers = OrbitTraceBuffers;
+	}
+	uint32 NumThreads = Buffers.Num();
+	*Writer << NumThreads;
+
+	TArray<FOrbitTraceEvent> Events;
+	for (void* Entry : Buffers)
+	{
+		const FBuffer* Buffer = (const FBuffer*)Entry;
+
+		// Copy without stopping the writer, then drop whatever it lapped while we copied.
+		const uint32 Head = Buffer->Head;
+		FPlatformMisc::MemoryBarrier();
+		const uint32 Count = FMath::Min(Head, EventsPerThread);
+		Events.SetNumUninitialized(Count);
+		for (uint32 i = 0; i < Count; i++)
+		{
+			Events[i] = Buffer->Events[(Head - Count + i) & (EventsPerThread - 1)];
+		}
+		FPlatformMisc::MemoryBarrier();
+		// Copied event i is number Head - Count + i, in the slot event number + EventsPerThread reuses. The
+		// writer has finished everything before its current Head and may be halfway through that one, so
+		// events up to NewHead - EventsPerThread can be torn: (NewHead + 1) - (Head - Count + EventsPerThread)
+		// of them from the front, none while the ring hasn't wrapped onto the copy yet.
+		const uint32 Written = Buffer->Head - Head + 1;
+		const uint32 Overwritten = Written + Count > EventsPerThread ? FMath::Min(Written + Count - EventsPerThread, Count) : 0;
+
+		uint32 ThreadId = Buffer->ThreadId;
+		uint32 NumEvents = Count - Overwritten;
+		*Writer << ThreadId << NumEvents;
+		Writer->Serialize(Events.GetData() + Overwritten, NumEvents * sizeof(FOrbitTraceEvent));
+	}
+
+	Writer->Close();
+	delete Writer;
+	return true;
+}
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "Components/ActorComponent.h"
+#include "GravityManager.h"
+#include "GravityBodyComponent.generated.h"
+
+/**
+ * Puts its owner into the world's gravity simulation for as long as the component is
+ * initialized. Add it to anything that should pull or be pulled: planets, asteroids,
+ * spawned debris. Replaces the old "GravitationalBody"/"GratitationallyActive" tags.
+ */
+UCLASS(ClassGroup = Gravity, meta = (BlueprintSpawnableComponent))
+class ORBIT_API UGravityBodyComponent : public UActorComponent
+{
+	GENERATED_BODY()
+public:
+	UGravityBodyComponent(const class FObjectInitializer& PCIP);
+
+	/** Pulls on receivers. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gravity)
+	bool bGravitySource;
+
+	/** Is pulled by sources. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gravity)
+	bool bGravityReceiver;
+
+	/** Push the solved force into the owner's root primitive each frame. Only does anything if it simulates physics. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gravity)
+	bool bApplyForce;
+
+	/** Sources only: with the SOI hierarchy, pull on every receiver rather than only those inside this body's SOI. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gravity)
+	bool bAlwaysPerturb;
+
+	/** This body is a smooth sphere: characters collide with it in closed form instead of through PhysX. Leave off for planets with terrain. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gravity)
+	bool bAnalyticCollision;
+
+	/** Sphere radius for bAnalyticCollision. 0 takes the root primitive's bounding sphere. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gravity, meta = (ClampMin = "0.0", EditCondition = "bAnalyticCollision"))
+	float CollisionRadius;
+
+	/** Mass the solver uses. 0 takes the root primitive's physics mass. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gravity, meta = (ClampMin = "0.0"))
+	float Mass;
+
+	virtual void InitializeComponent() override;
+	virtual void UninitializeComponent() override;
+
+	/** Gravity on this body from the last solve. Zero for pure sources. */
+	UFUNCTION(BlueprintCallable, Category = Gravity)
+	FVector GetGravityVector() const;
+
+	FGravityBodyHandle GetHandle() const { return Handle; }
+
+protected:
+	FGravityBodyHandle Handle;
+	TWeakObjectPtr<UGravityManager> Manager;//the world may be torn down before we are
+};
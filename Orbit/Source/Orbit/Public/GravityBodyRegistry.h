@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+
+/** Stable reference to a body in FGravityBodyRegistry. A reused slot bumps its generation, so old handles go stale instead of aliasing. */
+struct ORBIT_API FGravityBodyHandle
+{
+	int32 Index;
+	int32 Generation;
+
+	FGravityBodyHandle() : Index(INDEX_NONE), Generation(0) {}
+	FGravityBodyHandle(int32 InIndex, int32 InGeneration) : Index(InIndex), Generation(InGeneration) {}
+
+	bool IsSet() const { return Index != INDEX_NONE; }
+	bool operator==(const FGravityBodyHandle& Other) const { return Index == Other.Index && Generation == Other.Generation; }
+	bool operator!=(const FGravityBodyHandle& Other) const { return !(*this == Other); }
+	friend uint32 GetTypeHash(const FGravityBodyHandle& Handle) { return GetTypeHash(Handle.Index) ^ (Handle.Generation << 16); }
+};
+
+namespace EGravityBodyFlags
+{
+	enum Type
+	{
+		None = 0,
+		Source = 1 << 0,	// creates gravity (GravitationalBody)
+		Receiver = 1 << 1,	// is pulled by gravity
+		ApplyForce = 1 << 2,	// solver pushes the result into Component with AddForce
+		Perturber = 1 << 3,		// with the SOI hierarchy, pulls on every receiver, not just those in its SOI
+	};
+}
+
+/**
+ * Structure-of-arrays storage for everything the gravity solver touches.
+ * Per-body data lives in parallel arrays indexed by slot; Sources and Receivers are dense
+ * slot lists so the solver loops never test flags, hash names or copy FGravityBody around.
+ * Names are only kept for the legacy GetGravityBody(FString) lookups.
+ */
+class ORBIT_API FGravityBodyRegistry
+{
+public:
+	FGravityBodyHandle Register(const FString& Name, AActor* Actor, UPrimitiveComponent* Component, int32 InFlags, float Mass);
+	void Unregister(FGravityBodyHandle Handle);
+	void Empty();
+
+	bool IsValid(FGravityBodyHandle Handle) const
+	{
+		return Handle.Index >= 0 && Handle.Index < Generations.Num() && Generations[Handle.Index] == Handle.Generation && Flags[Handle.Index] != EGravityBodyFlags::None;
+	}
+
+	/** Slow path, hashes the name. Resolve once and keep the handle. */
+	FGravityBodyHandle Find(const FString& Name) const;
+
+	/** Pulls every actor location into Positions and drops bodies whose actor went away. Call once per solve. */
+	void SyncPositions();
+
+	/** Zeroes accumulated GravityVectors/Magnitudes of every receiver. */
+	void ResetAccumulators();
+
+	int32 NumSlots() const { return Flags.Num(); }
+	FGravityBodyHandle GetHandle(int32 Slot) const { return FGravityBodyHandle(Slot, Generations[Slot]); }
+
+	// Per-slot data
+	TArray<FVector> Positions;
+	TArray<float> Masses;
+	TArray<FVector> GravityVectors;
+	TArray<float> Magnitudes;
+	TArray<uint8> Flags;
+	TArray<TWeakObjectPtr<AActor>> Actors;
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> Components;
+
+	// Dense slot lists
+	TArray<int32> Sources;
+	TArray<int32> Receivers;
+
+private:
+	void AddToList(TArray<int32>& List, TArray<int32>& ListIndex, int32 Slot);
+	void RemoveFromList(TArray<int32>& List, TArray<int32>& ListIndex, int32 Slot);
+
+	TArray<int32> Generations;
+	TArray<int32> SourceIndex;		// slot -> position in Sources, INDEX_NONE if absent
+	TArray<int32> ReceiverIndex;	// slot -> position in Receivers
+	TArray<FString> Names;
+	TArray<int32> FreeSlots;
+	TMap<FString, FGravityBodyHandle> NameToHandle;
+};
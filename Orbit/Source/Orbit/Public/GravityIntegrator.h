@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "OrbitCore/GravityIntegration.h"
+#include "GravityIntegrator.generated.h"
+
+UENUM(BlueprintType)
+namespace EGravityIntegrator
+{
+	enum Type
+	{
+		/** Legacy: AddForce every frame and let the physics engine integrate (semi-implicit Euler at frame rate). */
+		PhysicsEngine,
+		/** Semi-implicit Euler on fixed substeps. First order, mostly here as a baseline. */
+		SemiImplicitEuler,
+		/** Kick-drift-kick leapfrog (velocity Verlet). Second order, symplectic, one force evaluation per substep. */
+		Leapfrog,
+		/** Yoshida's 4th order composition of leapfrog. Symplectic, three force evaluations per substep. */
+		Yoshida4,
+		/** Classic Runge-Kutta. 4th order but not symplectic, so energy slowly drifts; four evaluations per substep. */
+		RK4,
+	};
+}
+
+/** Anything the integrators can ask for accelerations at trial positions. */
+class IGravityAccelerationSource
+{
+public:
+	virtual ~IGravityAccelerationSource() {}
+
+	/** OutAccelerations is sized to match Positions by the caller. */
+	virtual void GetAccelerations(const TArray<FVector>& Positions, TArray<FVector>& OutAccelerations) = 0;
+
+	/** Same, but only for Positions[Bodies[k]], written to OutAccelerations[k]. Every body in Positions still pulls. */
+	virtual void GetAccelerationsFor(const TArray<FVector>& Positions, const TArray<int32>& Bodies, TArray<FVector>& OutAccelerations) = 0;
+};
+
+/** What the block-timestep leapfrog carries for a body between calls. */
+struct FGravityBlockStepState
+{
+	FVector Acceleration;	// from the last sync, kicks the open step closed
+	int32 Rung;				// step is FinestStep * 2^Rung
+	bool bOpen;				// opening half kick done, waiting for the closing one
+
+	FGravityBlockStepState() : Acceleration(FVector::ZeroVector), Rung(0), bOpen(false) {}
+};
+
+/**
+ * Advances a set of bodies through NumSteps fixed substeps. Holds the scratch buffers the
+ * multi-stage methods need, so keep one around instead of making one per call.
+ */
+class ORBIT_API FGravityIntegrator
+{
+public:
+	void Advance(EGravityIntegrator::Type Method, IGravityAccelerationSource& Source, TArray<FVector>& Positions, TArray<FVector>& Velocities, float Substep, int32 NumSteps);
+
+	/**
+	 * Leapfrog with individual power-of-two timesteps. Every body drifts each FinestStep, but is
+	 * only kicked (and only costs a force evaluation) at the end of its own step, which is picked
+	 * from Eta * |a| / |jerk| and capped at FinestStep * 2^MaxRung. Tick is the global step
+	 * counter, kept by the caller across calls. Returns the number of per-body force evaluations.
+	 */
+	int32 AdvanceBlockLeapfrog(IGravityAccelerationSource& Source, TArray<FVector>& Positions, TArray<FVector>& Velocities, TArray<FGravityBlockStepState>& States, float FinestStep, int32 MaxRung, float Eta, int32& Tick, int32 NumSteps);
+
+private:
+	static int32 PickRung(const FVector& Acceleration, const FVector& Jerk, float FinestStep, float Eta, int32 MaxRung);
+
+	/** The fixed-step methods are OrbitCore's (GravityIntegration.h), so OrbitCoreBench can measure their energy drift. */
+	OrbitCore::TIntegratorScratch<TArray<FVector>> Scratch;
+	TArray<int32> Active;
+};
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "OrbitCoreBridge.h"
+#include "GravityKernel.generated.h"
+
+UENUM(BlueprintType)
+namespace EGravityFalloff
+{
+	enum Type
+	{
+		/** Legacy: Mass * D / |D|^2, so the pull only falls off as 1/r. */
+		Linear,
+		/** Newtonian: Mass * D / |D|^3. Needed for real (Keplerian) orbits. */
+		InverseSquare,
+	};
+}
+
+/**
+ * Receiver positions and accumulated fields in structure-of-arrays form, padded to a
+ * multiple of 4 so the vector kernel never needs a remainder loop. Padding lanes are
+ * computed and ignored.
+ */
+struct ORBIT_API FGravityReceiverBatch
+{
+	TArray<float> X, Y, Z;
+	TArray<float> FieldX, FieldY, FieldZ, Magnitude;
+
+	FGravityReceiverBatch() : NumReceivers(0) {}
+
+	/** Sizes for InNum receivers and zeroes every field. */
+	void Reset(int32 InNum);
+
+	void SetPosition(int32 Index, const FVector& Position)
+	{
+		X[Index] = Position.X;
+		Y[Index] = Position.Y;
+		Z[Index] = Position.Z;
+	}
+
+	FVector GetField(int32 Index) const { return FVector(FieldX[Index], FieldY[Index], FieldZ[Index]); }
+	int32 Num() const { return NumReceivers; }
+	int32 NumPadded() const { return X.Num(); }
+
+private:
+	int32 NumReceivers;
+};
+
+/**
+ * The pairwise gravity term, Mass * D / (|D|^2 + SofteningSq) with D from receiver to source,
+ * or Mass * D / (|D|^2 + SofteningSq)^(3/2) with bInverseSquare, added from one source into
+ * receivers [Begin, End) of a batch. Magnitude gets Mass / (|D|^2 + SofteningSq) either way.
+ * Begin and End must be multiples of 4. Pairs closer than SMALL_NUMBER (a body and itself)
+ * contribute nothing.
+ */
+struct ORBIT_API FGravityKernel
+{
+	/** Four receivers per step with SSE, from OrbitCore. Falls back to the scalar loop without SSE2. */
+	static void AccumulateSourceSimd(FGravityReceiverBatch& Batch, int32 Begin, int32 End, const FVector& SourcePosition, float SourceMass, float SofteningSq, bool bInverseSquare);
+
+	/** Reference version, one receiver at a time, from OrbitCore. */
+	static void AccumulateSourceScalar(FGravityReceiverBatch& Batch, int32 Begin, int32 End, const FVector& SourcePosition, float SourceMass, float SofteningSq, bool bInverseSquare);
+
+	static void AccumulateSource(FGravityReceiverBatch& Batch, int32 Begin, int32 End, const FVector& SourcePosition, float SourceMass, float SofteningSq, bool bInverseSquare, bool bSimd)
+	{
+		if (bSimd)
+		{
+			AccumulateSourceSimd(Batch, Begin, End, SourcePosition, SourceMass, SofteningSq, bInverseSquare);
+		}
+		else
+		{
+			AccumulateSourceScalar(Batch, Begin, End, SourcePosition, SourceMass, SofteningSq, bInverseSquare);
+		}
+	}
+
+	/** One pair, for callers that choose their sources individually. */
+	static FORCEINLINE void AccumulatePair(const FVector& Point, const FVector& SourcePosition, float SourceMass, float SofteningSq, bool bInverseSquare, FVector& InOutField, float& InOutMagnitude)
+	{
+		OrbitCore::FVec Field = ToOrbitCore(InOutField);
+		OrbitCore::AccumulatePair(ToOrbitCore(Point), ToOrbitCore(SourcePosition), SourceMass, SofteningSq, bInverseSquare, Field, InOutMagnitude);
+		InOutField = FromOrbitCore(Field);
+	}
+
+	static void AccumulateSource(FGravityReceiverBatch& Batch, const FVector& SourcePosition, float SourceMass, float SofteningSq, bool bInverseSquare, bool bSimd)
+	{
+		AccumulateSource(Batch, 0, Batch.NumPadded(), SourcePosition, SourceMass, SofteningSq, bInverseSquare, bSimd);
+	}
+};
@@ -5,6 +5,14 @@
 #include "Orbit.h"
 #include <map>
 #include "GameFramework/Actor.h"
+#include "GravityOctree.h"
+#include "GravitySoiTree.h"
+#include "GravityKernel.h"
+#include "GravityIntegrator.h"
+#include "KeplerOrbit.h"
+#include "GravityBodyRegistry.h"
+#include "GravityTrajectoryPredictor.h"
+#include "GravityPlanetCollision.h"
 #include "GravityManager.generated.h"
 
 USTRUCT()
@@ -24,8 +32,23 @@ public:
 	FVector GetDirection(void){ return GravityVector.GetSafeNormal(); }
 };
 
+/** Runs UGravityManager::ApplyGravity and IntegrateBodies once per frame in TG_PrePhysics. Movement components list it as a prerequisite. */
+USTRUCT()
+struct FGravityTickFunction : public FTickFunction
+{
+	GENERATED_USTRUCT_BODY()
+
+	class UGravityManager* Manager;
+
+	FGravityTickFunction() : Manager(NULL) {}
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
 /**
- * Coordinates Gravitational forces between actors 
+ * Coordinates Gravitational forces between actors.
+ * One per world (see Get), solved by its own tick function before anything that reads it.
  */
 UCLASS()
 class ORBIT_API UGravityManager : public UObject
@@ -34,10 +57,223 @@ class ORBIT_API UGravityManager : public UObject
 public:
 	UGravityManager(){}
 	UGravityManager::UGravityManager(const class FObjectInitializer& ObjectInitializer);
+
+	/** Approximate far sources with a Barnes-Hut octree instead of summing every pair. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity)
+	bool bUseBarnesHut;
+
+	/** Barnes-Hut opening angle. 0 opens every cell, the direct sum up to rounding; larger is faster and rougher. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity, meta = (ClampMin = "0.0", ClampMax = "1.5"))
+	float BarnesHutTheta;
+
+	/**
+	 * Patched conics: each receiver only feels the body whose sphere of influence it is in, plus
+	 * SoiAncestorPerturbers of that body's parents and any source flagged to always perturb.
+	 * Cost per receiver no longer grows with the number of planets. Overrides bUseBarnesHut.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity)
+	bool bUseSoiHierarchy;
+
+	/** How many levels above the receiver's SOI body also pull on it (1: a moon's planet, 2: and its star). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity, meta = (ClampMin = "0"))
+	int32 SoiAncestorPerturbers;
+
+	/**
+	 * Run the direct sum with the hand-written SSE kernel. Off by default: the scalar kernel gives the same results and,
+	 * vectorized by the compiler, was as fast or faster in OrbitCoreBench simd-*. For compilers that leave it scalar.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity)
+	bool bUseSimdKernel;
+
+	/** Plummer softening length; pairs use |D|^2 + Softening^2. 0 keeps the legacy kernel. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity, meta = (ClampMin = "0.0"))
+	float GravitySoftening;
+
+	/** How the pull falls off with distance. Kepler rails need InverseSquare. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity)
+	TEnumAsByte<EGravityFalloff::Type> Falloff;
+
+	/** Split receivers into fixed blocks and solve them on task graph workers. Results do not depend on the thread count. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity)
+	bool bParallelGravity;
+
+	/** How ApplyForce bodies that simulate physics are moved. PhysicsEngine is the old AddForce-every-frame path. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity)
+	TEnumAsByte<EGravityIntegrator::Type> Integrator;
+
+	/** Fixed step for Integrator in seconds, independent of the frame rate. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity, meta = (ClampMin = "0.001"))
+	float IntegratorSubstep;
+
+	/** Substeps allowed in one frame. Time beyond that is dropped instead of spiralling on a hitch. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity, meta = (ClampMin = "1"))
+	int32 MaxSubstepsPerFrame;
+
+	/**
+	 * Leapfrog only: give each body its own power-of-two step, up to IntegratorSubstep * 2^MaxTimestepRung,
+	 * so quiet bodies are evaluated far less often than ones in a close encounter. 0 steps everything every substep.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity, meta = (ClampMin = "0", ClampMax = "10"))
+	int32 MaxTimestepRung;
+
+	/** Eta in step = Eta * |a| / |jerk|. Smaller is more accurate and puts bodies on finer rungs. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity, meta = (ClampMin = "0.001"))
+	float TimestepAccuracy;
+
+	/**
+	 * InverseSquare with an integrator only: integrated bodies dominated by a single source leave the
+	 * integrator and ride an analytic Kepler orbit around it until something else starts to matter.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity)
+	bool bUseKeplerRails;
+
+	/** Bodies stay on rails while everything but their primary pulls less than this fraction of the primary. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity, meta = (ClampMin = "0.0"))
+	float RailsPerturbationThreshold;
+
+	/** Bodies whose orbit comes this close to the primary's bounds stay integrated, so physics sees the approach. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity, meta = (ClampMin = "0.0"))
+	float RailsClearance;
+
+	/** Frames between perturbation checks of one body. Checks are spread across frames by slot. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gravity, meta = (ClampMin = "1"))
+	int32 RailsCheckInterval;
+
+	/** Seconds between points of predicted trajectories. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory, meta = (ClampMin = "0.01"))
+	float TrajectoryInterval;
+
+	/** Integrator substeps between two points. Uses Integrator's method, Leapfrog with PhysicsEngine. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory, meta = (ClampMin = "1"))
+	int32 TrajectorySubsteps;
+
+	/** A source moving this far from where a prediction saw it throws the prediction away. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory, meta = (ClampMin = "0.0"))
+	float TrajectorySourceTolerance;
+
+	/** So does the body itself ending up this far off its predicted position... */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory, meta = (ClampMin = "0.0"))
+	float TrajectoryPositionTolerance;
+
+	/** ...or velocity. Below both, predictions are only extended at the far end. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trajectory, meta = (ClampMin = "0.0"))
+	float TrajectoryVelocityTolerance;
+
 	//void RegisterActor(AActor& InActor, FVector &GravityVector);
 	void ApplyGravity(void);
+	/** Advances integrated bodies by DeltaTime worth of fixed substeps. Does nothing with the PhysicsEngine integrator. */
+	void IntegrateBodies(float DeltaTime);
 	FVector ApplyGravityTo(FString Name);
 	FGravityBody GetGravityBody(FString Name);
 	bool SetGravityBody(FString Name, FGravityBody GB);
-	void Start();
+
+	/** Adds a body to the simulation, O(1). Flags are EGravityBodyFlags; Component gets the force when ApplyForce is set. */
+	FGravityBodyHandle RegisterBody(AActor* Actor, UPrimitiveComponent* Component, int32 Flags, float Mass);
+	/** Removes a body, O(1). Stale or unset handles are ignored. */
+	void UnregisterBody(FGravityBodyHandle Handle);
+
+	/** The manager for InWorld, created and registered to tick on first use. Released when the world is cleaned up. */
+	static UGravityManager* Get(UWorld* InWorld);
+
+	FGravityTickFunction GravityTick;
+
+	/** Resolve a name once, then read results through the handle. */
+	FGravityBodyHandle FindGravityBody(const FString& Name) const;
+	FGravityBody GetGravityBody(FGravityBodyHandle Handle) const;
+	/** GetGravityBody for many bodies in one pass, into arrays in the same order. Stale or unset handles read as zero. */
+	void GetGravity(const TArray<FGravityBodyHandle>& Handles, TArray<FVector>& OutVectors, TArray<float>& OutMagnitudes) const;
+
+	/**
+	 * Gravitational acceleration at arbitrary points from this frame's sources, for things too
+	 * short-lived to register as bodies. Direct sum through the same kernel as receivers. Game thread only.
+	 */
+	void SampleField(const TArray<FVector>& Points, TArray<FVector>& OutField);
+
+	/** Keep predicting Body's path Duration seconds ahead on worker threads until cancelled or the body goes away. */
+	void RequestTrajectory(FGravityBodyHandle Body, float Duration);
+	void CancelTrajectory(FGravityBodyHandle Body);
+	/** Last finished prediction for Body, NULL until the first one is in. Good until the next gravity tick. */
+	const FGravityTrajectory* GetTrajectory(FGravityBodyHandle Body) const;
+	/** Publishes finished predictions and starts the ones that went stale. Runs at the end of the gravity tick. */
+	void UpdateTrajectories();
+
+	/** Lets character movement collide with Actor as a sphere of Radius around its location, without PhysX. */
+	void RegisterPlanet(AActor* Actor, float Radius);
+	void UnregisterPlanet(AActor* Actor);
+	/** Registered planets, centered where this frame's gravity tick left them. */
+	const FGravityPlanetCollision& GetPlanets() const { return Planets; }
+
+	/** Receivers per task. A multiple of 4 so blocks line up with FGravityKernel lanes. */
+	static const int32 ReceiversPerBlock = 256;
+
+protected:
+	friend class FGravityBlockTask;
+	friend struct FGravityTickFunction;
+
+	void ApplyGravityDirect();
+	void ApplyGravityBarnesHut();
+	void ApplyGravitySoi();
+	/** Sources into SourcePositions/SourceMasses, in Registry.Sources order. */
+	void GatherSources();
+	void ApplyForces();
+	/** Moved by IntegrateBodies rather than by AddForce. */
+	bool IsIntegrated(int32 Slot) const;
+	bool IsOnRails(int32 Slot) const;
+
+	/** Propagates bodies on rails, and moves bodies on or off them when their check comes up. */
+	void UpdateRails(float DeltaTime);
+	/** Strongest source at Position (ignoring Self), and how hard all the others pull relative to it. INDEX_NONE without sources. */
+	int32 FindDominantSource(const FVector& Position, int32 Self, float& OutPerturbation) const;
+	/** Where Slot is going: the integrator's velocity for integrated bodies, the component's for anything else. */
+	FVector GetBodyVelocity(int32 Slot) const;
+	/** Distance from Primary's centre a rails orbit has to keep. */
+	float GetRailsMinRadius(int32 Primary) const;
+
+	/** Runs SolveReceiverBlock over every block, on workers when bParallelGravity is set. */
+	void SolveReceivers();
+	/** Solves one block of SolveList. Blocks share no outputs, so any thread may run any block. */
+	void SolveReceiverBlock(int32 Block);
+
+	static void OnWorldCleanup(UWorld* InWorld, bool bSessionEnded, bool bCleanupResources);
+
+	/** One pass over the world's static mesh actors for maps still using the old tags instead of UGravityBodyComponent. */
+	void ImportTaggedActors();
+
+	UWorld* World;
+	FGravityBodyRegistry Registry;
+	FGravityOctree SourceTree;
+	FGravitySoiTree SoiTree;
+	TArray<int32> SoiPerturbers;	// SoiTree indices
+	TArray<int32> SoiHints;			// per receiver slot: source slot of its SOI last solve
+	TArray<int32> SoiSourceOfSlot;	// per slot: SoiTree index this solve, INDEX_NONE if not a source
+	TArray<FVector> SourcePositions;
+	TArray<float> SourceMasses;
+	FGravityReceiverBatch ReceiverBatch;
+	TArray<int32> SolveList;	// receivers the per-frame solve covers
+
+	struct FIntegratedBodyState
+	{
+		FVector Velocity;	// integrator's own velocity
+		FVector Drive;		// velocity handed to physics so it lands on the integrated position
+		FGravityBlockStepState Block;
+		FKeplerOrbit Orbit;
+		FGravityBodyHandle RailsPrimary;
+		double RailsTime;	// since Orbit's epoch
+		bool bOnRails;
+		bool bValid;
+	};
+	TArray<FIntegratedBodyState> IntegratedStates;	// per registry slot
+	FGravityIntegrator BodyIntegrator;
+	float IntegratorAccumulator;
+	TArray<int32> IntegratedSlots;
+	TArray<FVector> IntegratedStart, IntegratedPositions, IntegratedVelocities;
+	TArray<FGravityBlockStepState> IntegratedBlocks;
+	int32 BlockTick;
+	int32 BlockTickRung;	// MaxTimestepRung BlockTick was counted for
+	TArray<int32> RailsSlots;
+	int32 RailsFrame;
+	FGravityReceiverBatch IntegratorBatch;
+	FGravityTrajectoryPredictor Trajectories;
+	FGravityReceiverBatch SampleBatch;
+	FGravityPlanetCollision Planets;
 };
\ No newline at end of file
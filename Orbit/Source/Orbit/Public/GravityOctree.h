@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "OrbitCoreBridge.h"
+#include "OrbitCore/GravityOctree.h"
+
+/**
+ * Barnes-Hut octree of gravitational sources.
+ * Rebuilt from point masses every solve, then queried once per receiver. A cell whose
+ * size over distance is below Theta is treated as a single mass at its centre of mass,
+ * so a query is O(log N) instead of visiting every source.
+ *
+ * The field uses the same kernel as the direct sum in UGravityManager::ApplyGravity
+ * (Mass * D / |D|^2, D pointing from receiver to source), so a force is just
+ * ReceiverMass * GetField(). With Theta = 0 the result is the direct sum up to rounding
+ * (the leaves are added in tree order); at the default Theta of 0.5 it is off by under 1%
+ * on average for clustered asteroid fields, about 5% at worst (OrbitCoreTests gravity-octree
+ * checks both).
+ */
+class ORBIT_API FGravityOctree
+{
+public:
+	/** Throws away the previous tree and builds a new one. Positions and Masses must be the same length. */
+	void Build(const TArray<FVector>& Positions, const TArray<float>& Masses);
+
+	/**
+	 * Summed field of all sources at Point. Sources sitting on Point are skipped.
+	 * OutMagnitude, if given, receives the summed Mass / |D|^2 terms (FGravityBody::Magnitude per unit mass).
+	 * SofteningSq is added to every |D|^2, and bInverseSquare switches the falloff, as in FGravityKernel.
+	 */
+	FVector GetField(const FVector& Point, float Theta, float* OutMagnitude = NULL, float SofteningSq = 0.f, bool bInverseSquare = false) const
+	{
+		return FromOrbitCore(Tree.GetField(ToOrbitCore(Point), Theta, OutMagnitude, SofteningSq, bInverseSquare));
+	}
+
+	void Reset() { Tree.Reset(); }
+
+	bool IsEmpty() const { return Tree.IsEmpty(); }
+	int32 GetNumNodes() const { return Tree.GetNumNodes(); }
+
+	/** Stop subdividing past this depth; coincident bodies are merged into one leaf. */
+	static const int32 MaxDepth = OrbitCore::FGravityOctree::MaxDepth;
+
+private:
+	/** The tree itself is engine-free so OrbitCoreTests can check it against the direct sum. */
+	OrbitCore::FGravityOctree Tree;
+
+	/** Positions converted for Build, kept to avoid reallocating every solve. */
+	TArray<OrbitCore::FVec> ScratchPositions;
+};
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+
+/** Where a capsule sweep first touched a planet. Directions point from the planet out. */
+struct FGravityPlanetHit
+{
+	float Time;				// fraction of Start..End
+	FVector Location;		// capsule center at Time
+	FVector ImpactPoint;	// on the planet's surface
+	FVector Normal;
+	bool bStartPenetrating;
+	float PenetrationDepth;	// along Normal, when starting inside
+	int32 Planet;
+
+	FGravityPlanetHit() : Time(1.f), Location(FVector::ZeroVector), ImpactPoint(FVector::ZeroVector), Normal(FVector::ZeroVector), bStartPenetrating(false), PenetrationDepth(0.f), Planet(INDEX_NONE) {}
+};
+
+/**
+ * Planets that are plain spheres, so character movement can collide with them in closed form
+ * instead of sweeping PhysX capsules against their tessellated meshes. Only for smooth spheres:
+ * anything with terrain, or any other geometry nearby, still has to go through the physics scene,
+ * and deciding that is up to the caller.
+ *
+ * Capsules are a segment of half length HalfHeight - Radius along Axis, swept from Start to End.
+ */
+class ORBIT_API FGravityPlanetCollision
+{
+public:
+	/** Adds or updates Actor's sphere. Its center follows the actor's location. */
+	void Add(AActor* Actor, float Radius);
+	void Remove(AActor* Actor);
+	void Empty();
+
+	/** Pulls every planet's center from its actor and drops the ones whose actor went away. */
+	void SyncCenters();
+
+	int32 Num() const { return Actors.Num(); }
+	AActor* GetActor(int32 Planet) const { return Actors[Planet].Get(); }
+	const FVector& GetCenter(int32 Planet) const { return Centers[Planet]; }
+	float GetRadius(int32 Planet) const { return Radii[Planet]; }
+
+	/** Earliest hit of the capsule against any planet. False if it touches none on the way. */
+	bool SweepCapsule(const FVector& Start, const FVector& End, const FVector& Axis, float CapsuleRadius, float CapsuleHalfHeight, FGravityPlanetHit& OutHit) const;
+
+	/** The same against a single sphere. */
+	static bool SweepCapsuleSphere(const FVector& Center, float SphereRadius, const FVector& Start, const FVector& End, const FVector& Axis, float CapsuleRadius, float CapsuleHalfHeight, FGravityPlanetHit& OutHit);
+
+private:
+	TArray<TWeakObjectPtr<AActor>> Actors;
+	TArray<FVector> Centers;
+	TArray<float> Radii;
+};
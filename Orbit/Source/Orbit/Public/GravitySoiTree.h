@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+
+/**
+ * Sphere-of-influence hierarchy of gravitational sources (star -> planets -> moons).
+ * Rebuilt from point masses every solve, heaviest first: each body's parent is the deepest
+ * heavier body whose SOI contains it, and its own SOI is the Laplace radius
+ * |D| * (m / M)^(2/5) around it. The heaviest body is the root and its SOI is unbounded.
+ *
+ * Body indices are positions in the arrays given to Build, as with FGravityOctree.
+ */
+class ORBIT_API FGravitySoiTree
+{
+public:
+	FGravitySoiTree();
+
+	/** Throws away the previous tree and builds a new one. Positions and Masses must be the same length; massless entries are left out. */
+	void Build(const TArray<FVector>& Positions, const TArray<float>& Masses);
+
+	/**
+	 * Deepest body whose SOI contains Point. Hint is the answer for the same receiver last
+	 * time: the walk climbs out of it only as far as needed and then looks at children, so a
+	 * receiver that stays put costs one distance test per child.
+	 */
+	int32 FindSoi(const FVector& Point, int32 Hint = INDEX_NONE) const;
+
+	void Reset();
+
+	bool IsEmpty() const { return Root == INDEX_NONE; }
+	bool Contains(int32 Body) const { return Bodies.IsValidIndex(Body) && Bodies[Body].bInTree; }
+	int32 GetRoot() const { return Root; }
+	int32 GetParent(int32 Body) const { return Bodies[Body].Parent; }
+	float GetSoiRadius(int32 Body) const { return Bodies[Body].SoiRadius; }
+
+private:
+	struct FBody
+	{
+		FVector Position;
+		float Mass;
+		float SoiRadius;
+		float SoiRadiusSq;
+		int32 Parent;
+		int32 FirstChild;
+		int32 NextSibling;
+		bool bInTree;
+	};
+
+	/** Descends from Body into children containing Point until none does. */
+	int32 Descend(int32 Body, const FVector& Point) const;
+
+	TArray<FBody> Bodies;
+	TArray<int32> Order;
+	int32 Root;
+};
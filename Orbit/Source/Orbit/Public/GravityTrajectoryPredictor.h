@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "GravityIntegrator.h"
+#include "GravityBodyRegistry.h"
+
+/** A predicted path. Points[i] is where the body will be at StartTime + i * Interval. */
+struct ORBIT_API FGravityTrajectory
+{
+	TArray<FVector> Points;
+	TArray<FVector> Velocities;
+	double StartTime;
+	float Interval;
+	int32 Revision;	// bumped every time a new prediction is published
+
+	FGravityTrajectory() : StartTime(0.0), Interval(0.f), Revision(0) {}
+
+	double GetEndTime() const { return StartTime + Interval * FMath::Max(Points.Num() - 1, 0); }
+
+	/** State at Time, linear between points. False outside [StartTime, GetEndTime()]. */
+	bool Sample(double Time, FVector& OutPosition, FVector& OutVelocity) const;
+};
+
+/** What the predictor needs from UGravityManager each update. */
+struct FGravityTrajectorySettings
+{
+	EGravityIntegrator::Type Method;
+	float Interval;				// seconds between points
+	int32 SubstepsPerPoint;
+	float SofteningSq;
+	bool bInverseSquare;
+	float SourceTolerance;		// a source moving further than this invalidates the whole path
+	float PositionTolerance;	// so does the body drifting off its predicted position...
+	float VelocityTolerance;	// ...or velocity
+};
+
+/**
+ * Predicts trajectories of registered bodies on thread pool workers.
+ *
+ * Sources are snapshotted when a job starts and held still while it runs, so a prediction is
+ * only as good as that snapshot: once any source has moved further than SourceTolerance from
+ * where the path was computed, or the body has left the path, it is recomputed from scratch.
+ * Otherwise the points that are now in the past are dropped and only the tail is extended,
+ * which costs one interval of integration per elapsed interval instead of the whole path.
+ *
+ * Each request is double buffered: readers always see the last finished path while the next
+ * one is written into the back buffer, and the two are swapped on the game thread.
+ */
+class ORBIT_API FGravityTrajectoryPredictor
+{
+public:
+	/** Starts (or resizes) a prediction Duration seconds ahead for Body. */
+	void Request(FGravityBodyHandle Body, float Duration);
+	void Cancel(FGravityBodyHandle Body);
+	/** Drops every request. Jobs still running finish on their own and are thrown away. */
+	void Reset();
+
+	/** Last published path of Body, NULL before the first one lands. */
+	const FGravityTrajectory* Find(FGravityBodyHandle Body) const;
+
+	/** Game thread, after the solve: publishes finished jobs and starts new ones where needed. */
+	void Update(const FGravityBodyRegistry& Registry, const FGravityTrajectorySettings& Settings, double Now);
+
+	int32 GetNumInFlight() const;
+
+private:
+	friend class FGravityTrajectoryTask;
+
+	struct FSourceSnapshot
+	{
+		TArray<int32> Slots;
+		TArray<FVector> Positions;
+		TArray<float> Masses;
+	};
+	typedef TSharedPtr<const FSourceSnapshot, ESPMode::ThreadSafe> FSourceSnapshotPtr;
+
+	/** One prediction in flight, shared between the game thread and the worker running it. */
+	struct FJob;
+	typedef TSharedPtr<FJob, ESPMode::ThreadSafe> FJobPtr;
+
+	struct FRequest
+	{
+		float Duration;
+		FGravityTrajectory Front;
+		TArray<FVector> BackPoints, BackVelocities;
+		FSourceSnapshotPtr BaseSnapshot;	// sources the oldest points in Front were computed against
+		FJobPtr Job;
+
+		FRequest() : Duration(0.f) {}
+	};
+
+	/** Worker side: integrates the job's tail out to its full length. */
+	static void Run(FJob& Job);
+	/** Swaps a finished job into the front buffer and keeps the old front as the next back buffer. */
+	static void Publish(FRequest& Request);
+
+	/** Whether any source other than Self has moved, appeared or gone since Snapshot. */
+	static bool SourcesChanged(const FGravityBodyRegistry& Registry, const FSourceSnapshot& Snapshot, int32 Self, float Tolerance);
+	void Launch(FRequest& Request, int32 Slot, const FGravityBodyRegistry& Registry, const FGravityTrajectorySettings& Settings, const FVector& Position, const FVector& Velocity, double StartTime, int32 NumKept);
+
+	TMap<FGravityBodyHandle, FRequest> Requests;
+	FSourceSnapshotPtr FrameSnapshot;	// made on the first launch of an update, shared by the rest
+};
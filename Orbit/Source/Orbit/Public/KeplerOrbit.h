@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+
+/**
+ * Two-body orbit around a fixed primary, propagated analytically with the universal-variable
+ * formulation (Curtis, Orbital Mechanics for Engineering Students, ch. 3), so elliptic,
+ * parabolic and hyperbolic paths all go through the same code.
+ * Positions and velocities are relative to the primary; Mu is the primary's mass in the
+ * InverseSquare gravity units. Math is done in doubles since rails run for a long time.
+ */
+struct ORBIT_API FKeplerOrbit
+{
+	FKeplerOrbit();
+
+	/** Captures the elements of a body at R, V relative to the primary. Time since epoch restarts at 0. */
+	void Init(const FVector& R, const FVector& V, float InMu);
+
+	/** State Time seconds after the epoch. False if the solver did not converge (caller should stop trusting the rails). */
+	bool Propagate(double Time, FVector& OutR, FVector& OutV) const;
+
+	/** 1/a: positive for ellipses, zero for parabolas, negative for hyperbolas. */
+	double GetAlpha() const { return Alpha; }
+	/** Closest approach to the primary. */
+	double GetPeriapsis() const;
+	/** Orbital period, or 0 when the orbit is not closed. */
+	double GetPeriod() const;
+
+	static const int32 MaxIterations = 50;
+
+private:
+	/** Stumpff functions C(z) and S(z). */
+	static double StumpffC(double Z);
+	static double StumpffS(double Z);
+
+	double R0[3];
+	double V0[3];
+	double Mu;
+	double SqrtMu;
+	double RadiusAtEpoch;	// |R0|
+	double RadialSpeed;		// R0.V0 / |R0|
+	double Alpha;
+};
@@ -2,6 +2,7 @@
 #pragma once
 #include "Orbit.h"
 #include "GameFramework/Character.h"
+#include "OrbitRepMovement.h"
 #include "OrbitCharacter.generated.h"
 #define VERSION27
 UCLASS(config=Game)
@@ -41,6 +42,21 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category=Projectile)
 	TSubclassOf<class AOrbitProjectile> ProjectileClass;
 
+	/**
+	 * Fire into the world's AOrbitProjectileManager instead of spawning a ProjectileClass actor per shot. Needs ProjectileMesh
+	 * (or one set on the manager) since the manager can't draw ProjectileClass's blueprint mesh; without one shots go to the pool.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Projectile)
+	bool bBatchProjectiles;
+
+	/** When not batching, reuse ProjectileClass actors from the world's AOrbitProjectilePool instead of spawning one per shot. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Projectile)
+	bool bPoolProjectiles;
+
+	/** What batched projectiles are drawn with, since ProjectileClass's mesh lives in its blueprint. */
+	UPROPERTY(EditDefaultsOnly, Category=Projectile)
+	class UStaticMesh* ProjectileMesh;
+
 	/** Sound to play each time we fire */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Gameplay)
 	class USoundBase* FireSound;
@@ -49,6 +65,21 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay)
 	class UAnimMontage* FireAnimation;
 
+	/** Replicate movement to simulated proxies relative to the nearest planet, in OrbitReplicatedMovement, instead of ReplicatedMovement's world space. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Replication, AdvancedDisplay)
+	bool bGravityRelativeReplication;
+
+	/** What simulated proxies get in place of ReplicatedMovement while bGravityRelativeReplication. */
+	UPROPERTY(ReplicatedUsing=OnRep_OrbitReplicatedMovement)
+	FOrbitRepMovement OrbitReplicatedMovement;
+
+	/** Hands the movement to the engine's ReplicatedMovement path, so smoothing works as usual. */
+	UFUNCTION()
+	void OnRep_OrbitReplicatedMovement();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
 
 
 protected:
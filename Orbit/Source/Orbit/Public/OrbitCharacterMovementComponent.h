@@ -50,6 +50,18 @@ public:
 	void SetFromSweep(const FHitResult& InHit, const float InSweepFloorDist, const bool bIsWalkableFloor);
 	void SetFromLineTrace(const FHitResult& InHit, const float InSweepFloorDist, const float InLineDist, const bool bIsWalkableFloor);
 };
+
+/** How much of the movement pipeline an AI character runs, picked by UOrbitCharacterMovementComponent::UpdateMovementLOD. */
+namespace EOrbitMovementLOD
+{
+	enum Type
+	{
+		Full,		// every frame, everything
+		Reduced,	// ReducedLODRate steps with the children interpolated, no perching or stepping up
+		Glide,		// walking on an analytic planet: slid along the sphere with no queries at all
+	};
+}
+
 UCLASS()
 class ORBIT_API UOrbitCharacterMovementComponent : public UCharacterMovementComponent //, public UPrimitiveComponent
 {
@@ -64,16 +76,118 @@ public:
 	};
 	/*
 */
+	/** This world's manager. Solved once per frame before we tick; we only read from it. */
+	UPROPERTY(Transient, VisibleAnywhere, BlueprintReadOnly, Category = Gravity)
 	UGravityManager* GravityManager;
+	FGravityBodyHandle GravityHandle;
 
 	FVector GravityDirection, GravityDistanceVector, GravityVector;
 	float GravityMagnitude, GravityDistance;
 	float YawSum;
 	void SumYaw(float yaw);
 
+	/** Up against gravity, carried over from last time, turned by YawSum about up. */
+	FQuat GetGravityOrientation();
+	/** Turns the capsule to GetGravityOrientation in a single move. */
+	void UpdateGravityOrientation();
+	/** Points YawSum at Rotation's heading about our up. Simulated proxies get rotations rather than input to sum. */
+	void SetYawFromRotation(const FRotator& Rotation);
+
+	/** The registered planet whose surface is nearest Location, to replicate relative to. NULL if there are none. */
+	AActor* FindNearestPlanet(const FVector& Location) const;
+
+	/**
+	 * Issue the next frame's floor sweeps and line trace as async traces at the end of each walking tick, so FindFloor reads finished
+	 * results instead of waiting on the physics scene. Off by default: the floor is then where the capsule was predicted to be a frame
+	 * ago, corrected for how far off that was, which is close to but not exactly what FindFloor would have found.
+	 */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay)
+	uint32 bAsyncFloorQueries:1;
+
+	/** How far from where it was predicted a floor check may start and still use the async results. Further than this it queries synchronously. */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0"))
+	float AsyncFloorTolerance;
+
+	/**
+	 * Floor checks and falling moves against planets registered for analytic collision skip PhysX while nothing else is near.
+	 * Off by default: the analytic floor distance is the true distance along gravity, while the PhysX sweep it falls back to
+	 * near other actors reports it on the halved sweep's scale walking is tuned on, so characters would change height as
+	 * neighbours came and went.
+	 */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay)
+	uint32 bAnalyticPlanetCollision:1;
+
+	/** Extra radius around the swept capsule that has to be free of anything but planets for the analytic path. */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0"))
+	float PlanetClearanceMargin;
+
+	/**
+	 * Run PerformMovement in steps of 1/FixedStepRate instead of once with the frame's DeltaTime, and draw what is attached
+	 * to the capsule (mesh, camera) between the last two steps. Standalone and listen server players only: clients send
+	 * their moves to the server with their own timestamps.
+	 */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay)
+	uint32 bFixedStepMovement:1;
+
+	/** Steps per second with bFixedStepMovement. */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay, meta = (ClampMin = "10", UIMin = "10"))
+	float FixedStepRate;
+
+	/** Most steps a single frame may take. Time past that is dropped, so a hitch slows the character down instead of making the next frame longer too. */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay, meta = (ClampMin = "1", UIMin = "1"))
+	int32 MaxFixedStepsPerFrame;
+
+	/**
+	 * Run less of the movement pipeline for characters no player is near or looking at. Characters
+	 * controlled by a player always get all of it. See EOrbitMovementLOD. Off by default: AI far away
+	 * skips perching and stepping up and can glide through what it would have bumped into.
+	 */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay)
+	uint32 bMovementLOD:1;
+
+	/** Past this far from every player's view, step at ReducedLODRate. */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0"))
+	float ReducedLODDistance;
+
+	/** Past this far, or past ReducedLODDistance and not rendered lately, glide when walking on an analytic planet. */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0"))
+	float GlideLODDistance;
+
+	/** Steps per second at EOrbitMovementLOD::Reduced. */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay, meta = (ClampMin = "1", UIMin = "1"))
+	float ReducedLODRate;
+
+	EOrbitMovementLOD::Type GetMovementLOD() const { return MovementLOD; }
+
+	/**
+	 * Let UOrbitMovementManager read this character's gravity, glide it and issue its floor queries
+	 * in passes over every character, instead of in its own tick. Off by default: the passes put
+	 * ticks before and after every batched character, which only pays off with many of them.
+	 */
+	UPROPERTY(Category = "Character Movement", EditAnywhere, BlueprintReadWrite, AdvancedDisplay)
+	uint32 bBatchedMovement:1;
+
 	virtual void CalculateGravity();
+	/** Takes InGravityVector as this frame's gravity. Nothing pulling at all reads as the old default. */
+	void SetGravity(const FVector& InGravityVector, float InMagnitude);
+
+	/** The gravity and heading a move was made with, kept in each FSavedMove_Orbit so a replay makes it the same way. */
+	struct FMoveGravity
+	{
+		FVector Vector;
+		FVector Direction;
+		float Magnitude;
+		float YawSum;
+		FQuat Frame;
+		bool bFrameValid;
+	};
+	FMoveGravity GetMoveGravity() const;
+	/** Puts Gravity back as it was, without asking the gravity manager. */
+	void SetMoveGravity(const FMoveGravity& Gravity);
+	virtual class FNetworkPredictionData_Client* GetPredictionData_Client() const override;
 	virtual float GetGravityZ() const override;
 	virtual void InitializeComponent() override;
+	virtual void UninitializeComponent() override;
 	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction);
 	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
 	virtual void ApplyAccumulatedForces(float DeltaSeconds) override;
@@ -89,6 +203,8 @@ public:
 	virtual void FindFloor(const FVector& CapsuleLocation, FFindFloorResult& OutFloorResult, bool bZeroDelta, const FHitResult* DownwardSweepResult) const override;
 	virtual void ComputeFloorDist(const FVector& CapsuleLocation, float LineDistance, float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius, const FHitResult* DownwardSweepResult) const override;
 	virtual void MaintainHorizontalGroundVelocity() override;
+	/** Terminal velocity along gravity, wherever it points. */
+	virtual FVector NewFallVelocity(const FVector& InitialVelocity, const FVector& Gravity, float DeltaTime) const override;
 	virtual bool DoJump(bool bReplayingMoves) override;
 	//virtual void SimulateMovement(float DeltaSeconds) override;
 	virtual bool IsMovingOnGround() const override;//fixed not jumping , but now can't move
@@ -148,5 +264,155 @@ public:
 	virtual void RemoveVertical(FVector &OutVector, FVector VerticalComponent);
 
 protected:
+	friend class UOrbitMovementManager;
+
 	int TickCounter; //TODO, get rid of this
+
+	FQuat GravityFrame;	// orientation without YawSum
+	bool bGravityFrameValid;
+	bool bGravityOriented;	// this tick
+
+	/** Floor queries issued by PrefetchFloor for where we expect to be next frame. */
+	struct FFloorPrefetch
+	{
+		bool bValid;
+		bool bFetched;
+		uint64 FrameNumber;		// issued on, results are readable on the frame after
+		FVector Location;
+		FVector GravityDirection;
+		float LineDistance;
+		float SweepDistance;
+		float SweepRadius;
+		float HalfHeight;
+		FVector SweepOffsets[2];	// capsule center to the bottom sphere, normal and shrunken shape
+		float SweepDropScales[2];	// change in Hit.Time * TraceDist per unit moved along gravity, see PrefetchFloor
+		FTraceHandle SweepHandles[2];
+		FTraceHandle LineHandle;
+		FHitResult SweepHits[2];
+		FHitResult LineHit;
+		int32 NumUsed;
+		int32 NumMissed;
+
+		FFloorPrefetch() : bValid(false), bFetched(false), FrameNumber(0), NumUsed(0), NumMissed(0) {}
+	};
+	mutable FFloorPrefetch FloorPrefetch;
+
+	/** Starts next frame's floor queries, aimed at where Velocity takes us. */
+	void PrefetchFloor(float DeltaTime);
+
+	/** ComputeFloorDist from the prefetched results. False if they don't apply here and the caller must query. */
+	bool ComputeFloorDistFromPrefetch(const FVector& CapsuleLocation, float LineDistance, float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius) const;
+
+	/** Last clearance check against everything but planets. One overlap answers every query inside it for the rest of the frame. */
+	struct FPlanetClearance
+	{
+		uint64 FrameNumber;
+		FVector Center;
+		float Radius;
+		bool bClear;
+		int32 NumAnalytic;
+		int32 NumPhysX;
+
+		FPlanetClearance() : FrameNumber(0), Center(FVector::ZeroVector), Radius(0.f), bClear(false), NumAnalytic(0), NumPhysX(0) {}
+	};
+	mutable FPlanetClearance PlanetClearance;
+
+	/** True if the analytic planet path may answer for the sphere at Center: planets are registered and nothing else is in it. */
+	bool HasPlanetClearance(const FVector& Center, float Radius) const;
+
+	/** ComputeFloorDist against planets alone. False if something else is near and the caller must query. */
+	bool ComputeFloorDistAgainstPlanets(const FVector& CapsuleLocation, float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius) const;
+
+	/** Sweeping move against planets alone. False if something else is near and the caller must sweep. */
+	bool MoveAgainstPlanets(const FVector& Delta, const FRotator& NewRotation, FHitResult* OutHit);
+
+	void SetFromPlanetHit(const FGravityPlanetHit& PlanetHit, const FVector& Start, const FVector& End, FHitResult& OutHit) const;
+
+	/** bFixedStepMovement state: time not simulated yet, and where the capsule was before and after the last step. */
+	struct FFixedStep
+	{
+		bool bActive;
+		uint64 FrameNumber;		// last frame we stepped on
+		float Accumulator;
+		FVector PreviousLocation;
+		FVector CurrentLocation;
+		FVector AppliedOffset;	// capsule space, currently added to the children
+		TArray<TWeakObjectPtr<USceneComponent>> Children;	// attached to the capsule when stepping started
+		float Step;				// seconds, of the last steps taken
+		int32 NumSteps;			// last frame
+		int32 NumDropped;		// frames that ran out of steps
+
+		FFixedStep() : bActive(false), FrameNumber(0), Accumulator(0.f), PreviousLocation(FVector::ZeroVector), CurrentLocation(FVector::ZeroVector), AppliedOffset(FVector::ZeroVector), Step(0.f), NumSteps(0), NumDropped(0) {}
+	};
+	FFixedStep FixedStep;
+
+	/** PerformMovement for as many whole Steps as DeltaTime and the leftover from last frame allow. */
+	void PerformFixedStepMovement(float DeltaTime, float Step);
+
+	/** Moves the children to where the capsule would be between the last two steps. */
+	void InterpolateFixedStep();
+
+	/** Eases the children back onto the capsule over a few frames, then stops. For when we didn't step this frame. */
+	void BlendOutFixedStep(float DeltaTime);
+
+	/** Moves the children by RelativeOffset (capsule space) from where they are attached. */
+	void ApplyFixedStepOffset(const FVector& RelativeOffset);
+
+	/** Puts the children back on the capsule and forgets the steps. */
+	void StopFixedStep();
+
+	EOrbitMovementLOD::Type MovementLOD;
+	float MovementLODTimer;		// until the next UpdateMovementLOD that looks at the players
+	int32 GlidePlanet;			// index in GravityManager->GetPlanets() while gliding
+
+	/** Picks MovementLOD from the distance to the nearest player view, every MOVEMENT_LOD_INTERVAL or so. */
+	void UpdateMovementLOD(float DeltaTime);
+
+	/** Nothing this frame that only the full pipeline handles: walking, and no pending forces, launch, crouch change or root motion. */
+	bool IsGlideSafe() const;
+
+	/** True if we stand on a registered planet with nothing else near enough to matter before the next update. */
+	bool CanGlide(int32& OutPlanet) const;
+
+	/** PhysWalking without a single query: velocity along the surface, location put back on the sphere. */
+	void PerformGlide(float DeltaTime);
+
+	/** GlidePlanet is still registered. */
+	bool HasGlidePlanet() const;
+
+	/** Capsule center distance from GlidePlanet's center that the floor checks would keep us at. */
+	float GetGlideHeight() const;
+
+	/** Start of a glide step, before the math: follow the base, take the jump input. */
+	void BeginGlide(float DeltaTime);
+
+	/** End of a glide step: move and turn the capsule to where the math put it, then what PerformMovement does after moving. */
+	void EndGlide(float DeltaTime, const FVector& OldLocation, const FVector& OldVelocity, const FVector& NewLocation, const FVector& NewVelocity);
+
+	UPROPERTY(Transient)
+	class UOrbitMovementManager* MovementManager;
+	int32 MovementBatchIndex;	// in MovementManager
+	uint64 MovementBatchFrame;	// last frame MovementManager set our gravity
+	uint64 GlideBatchFrame;		// ...moved us
+	uint64 FloorPrefetchFrame;	// ...was asked for PrefetchFloor
+};
+
+/** A saved move that remembers its gravity, so replaying it after a correction needn't look gravity up again or use today's. */
+class ORBIT_API FSavedMove_Orbit : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	UOrbitCharacterMovementComponent::FMoveGravity Gravity;
+
+	virtual void Clear() override;
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual void PrepMoveFor(ACharacter* C) override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InPawn, float MaxDelta) const override;
+};
+
+class ORBIT_API FNetworkPredictionData_Client_Orbit : public FNetworkPredictionData_Client_Character
+{
+public:
+	virtual FSavedMovePtr AllocateNewMove() override;
 };
@@ -0,0 +1,18 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "OrbitCore/GravityMath.h"
+#include "OrbitCore/MovementMath.h"
+
+/** Conversions for calling the engine-free math in OrbitCore/include (added to the include path by Orbit.Build.cs). */
+FORCEINLINE OrbitCore::FVec ToOrbitCore(const FVector& V)
+{
+	return OrbitCore::FVec(V.X, V.Y, V.Z);
+}
+
+FORCEINLINE FVector FromOrbitCore(const OrbitCore::FVec& V)
+{
+	return FVector(V.X, V.Y, V.Z);
+}
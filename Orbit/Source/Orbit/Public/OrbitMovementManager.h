@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "GravityManager.h"
+#include "OrbitCoreBridge.h"
+#include "OrbitMovementManager.generated.h"
+
+class UOrbitCharacterMovementComponent;
+
+/** One of UOrbitMovementManager's passes: before every registered character ticks, or after. */
+USTRUCT()
+struct FOrbitMovementTickFunction : public FTickFunction
+{
+	GENERATED_USTRUCT_BODY()
+
+	class UOrbitMovementManager* Manager;
+	bool bAfterCharacters;
+
+	FOrbitMovementTickFunction() : Manager(NULL), bAfterCharacters(false) {}
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+/**
+ * Does the work of UOrbitCharacterMovementComponent that doesn't need the scene as passes over
+ * every character, instead of inside each component's tick:
+ *   before they tick (after gravity): reads gravity for all of them from the gravity manager at
+ *   once, and steps every character in EOrbitMovementLOD::Glide together with OrbitCore::GlideBatch.
+ *   Each glider is left with one capsule move of its own.
+ *   after they tick: issues every character's floor queries for next frame in one go.
+ * Whatever touches the scene (sweeps, floors, steps) stays in the components.
+ * One per world, like UGravityManager.
+ */
+UCLASS()
+class ORBIT_API UOrbitMovementManager : public UObject
+{
+	GENERATED_BODY()
+public:
+	UOrbitMovementManager(const class FObjectInitializer& ObjectInitializer);
+
+	/** The manager for InWorld, created and registered to tick on first use. Released when the world is cleaned up. */
+	static UOrbitMovementManager* Get(UWorld* InWorld);
+
+	/** Adds Component to the passes and orders its tick between them. O(1). */
+	void Register(UOrbitCharacterMovementComponent* Component);
+	/** O(1). Components that aren't registered are ignored. */
+	void Unregister(UOrbitCharacterMovementComponent* Component);
+
+	int32 Num() const { return Components.Num(); }
+
+	FOrbitMovementTickFunction BeforeTick;
+	FOrbitMovementTickFunction AfterTick;
+
+protected:
+	friend struct FOrbitMovementTickFunction;
+
+	/** Gravity and gliding for everyone. */
+	void TickBefore(float DeltaTime);
+	/** Floor prefetches of the characters that asked for one this frame. */
+	void TickAfter(float DeltaTime);
+
+	/** Appends Component to the Glide arrays if it is gliding and GlideBatch can step it. */
+	void GatherGlide(UOrbitCharacterMovementComponent* Component, int32 Index, float DeltaTime);
+
+	static void OnWorldCleanup(UWorld* InWorld, bool bSessionEnded, bool bCleanupResources);
+
+	UWorld* World;
+	UGravityManager* GravityManager;
+
+	// Per character, all in the same order; each component knows its index. Removal swaps the last one in.
+	TArray<UOrbitCharacterMovementComponent*> Components;	// they unregister in UninitializeComponent
+	TArray<FGravityBodyHandle> GravityHandles;
+	TArray<FVector> GravityVectors;
+	TArray<float> GravityMagnitudes;
+
+	// This frame's gliders, the way GlideBatch takes them.
+	TArray<int32> GlideIndices;		// into Components
+	TArray<FVector> GlideStartLocations, GlideStartVelocities;
+	TArray<OrbitCore::FVec> GlideLocations, GlideVelocities, GlideAccelerations, GlideCenters;
+	TArray<float> GlideHeights;
+	TArray<OrbitCore::FWalkParams> GlideParams;
+};
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "GameFramework/Controller.h"
+#include "OrbitPerfController.generated.h"
+
+/**
+ * Drives an AOrbitCharacter around a planet for AOrbitPerfGameMode: runs forward, turns a little
+ * every so often and jumps now and then, so the movement component sees walking, jumping and
+ * falling. Seeded, so the same seed repeats the same run at a fixed frame rate.
+ */
+UCLASS()
+class ORBIT_API AOrbitPerfController : public AController
+{
+	GENERATED_BODY()
+public:
+	AOrbitPerfController(const FObjectInitializer& ObjectInitializer);
+
+	/** Average seconds between jumps. */
+	UPROPERTY(EditAnywhere, Category = Perf, meta = (ClampMin = "0.1"))
+	float JumpInterval;
+
+	/** Average seconds between changes of heading. */
+	UPROPERTY(EditAnywhere, Category = Perf, meta = (ClampMin = "0.1"))
+	float TurnInterval;
+
+	void SetSeed(int32 Seed);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+private:
+	FRandomStream Random;
+	float NextJump;
+	float NextTurn;
+	float TurnRate;	// yaw per second, same units as AOrbitCharacter::Turn
+};
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "OrbitGameMode.h"
+#include "OrbitPerfGameMode.generated.h"
+
+/** One character count's numbers in the report. */
+struct FOrbitPerfResult
+{
+	int32 NumCharacters;
+	int32 NumFrames;
+	double GameThreadMsMean;
+	double GameThreadMsP95;
+	double GameThreadMsMax;
+	double MovementTickMsMean;	// all characters' TickComponent and UOrbitMovementManager's passes, from the Orbit stats
+	double SweepsPerFrame;
+	double QueriesPerFrame;		// sweeps, line traces, overlaps and async traces
+
+	FOrbitPerfResult() : NumCharacters(0), NumFrames(0), GameThreadMsMean(0.0), GameThreadMsP95(0.0), GameThreadMsMax(0.0), MovementTickMsMean(0.0), SweepsPerFrame(0.0), QueriesPerFrame(0.0) {}
+};
+
+/**
+ * Repeatable character scaling test. Spawns AOrbitCharacters driven by AOrbitPerfController on the
+ * planet for each of CharacterCounts in turn, lets them settle for WarmupFrames, then records game
+ * thread time and scene queries for MeasureFrames. When done it writes a JSON report, compares it
+ * against a baseline report if given, and quits: normally if everything is within RegressionThreshold
+ * of the baseline, forced (non-zero exit status) if not. For example
+ *
+ *   UE4Editor Orbit /Game/Maps/Example_Map?game=/Script/Orbit.OrbitPerfGameMode -game -nullrhi -unattended
+ *     -benchmark -fps=60 -OrbitPerfReport=Perf.json -OrbitPerfBaseline=Baseline.json
+ *
+ * -benchmark -fps=60 fixes DeltaTime so runs simulate the same moves. Also -OrbitPerfCounts=1,16,64
+ * and -OrbitPerfThreshold=0.2. The planet is the first one registered for analytic collision, else
+ * PlanetCenter and PlanetRadius, which match the BSP sphere in Example_Map.
+ */
+UCLASS()
+class ORBIT_API AOrbitPerfGameMode : public AOrbitGameMode
+{
+	GENERATED_BODY()
+public:
+	AOrbitPerfGameMode(const FObjectInitializer& ObjectInitializer);
+
+	UPROPERTY(EditDefaultsOnly, Category = Perf)
+	TArray<int32> CharacterCounts;
+
+	UPROPERTY(EditDefaultsOnly, Category = Perf, meta = (ClampMin = "0"))
+	int32 WarmupFrames;
+
+	UPROPERTY(EditDefaultsOnly, Category = Perf, meta = (ClampMin = "1"))
+	int32 MeasureFrames;
+
+	/** How much slower than the baseline (0.2 is 20%) game thread time or queries per frame may get. */
+	UPROPERTY(EditDefaultsOnly, Category = Perf, meta = (ClampMin = "0.0"))
+	float RegressionThreshold;
+
+	UPROPERTY(EditDefaultsOnly, Category = Perf)
+	FVector PlanetCenter;
+
+	UPROPERTY(EditDefaultsOnly, Category = Perf, meta = (ClampMin = "0.0"))
+	float PlanetRadius;
+
+	/** How far above the surface characters are dropped. */
+	UPROPERTY(EditDefaultsOnly, Category = Perf, meta = (ClampMin = "0.0"))
+	float SpawnHeight;
+
+	UPROPERTY(EditDefaultsOnly, Category = Perf)
+	TSubclassOf<class AOrbitCharacter> CharacterClass;
+
+	virtual void StartPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+
+private:
+	void SpawnCharacters(int32 Count);
+	void FinishCount();
+	void Finish();
+
+	/** False if any count is slower than Baseline allows; Regressions says which. */
+	bool CompareWithBaseline(const FString& BaselinePath, TArray<FString>& Regressions) const;
+	bool WriteReport(const FString& Path, bool bPassed, const TArray<FString>& Regressions) const;
+
+	TArray<class AOrbitCharacter*> Characters;
+	TArray<FOrbitPerfResult> Results;
+
+	int32 CountIndex;
+	int32 Frame;	// within the current count, warm-up first
+	bool bFinished;
+
+	TArray<float> GameThreadMs;
+	double MovementTickMs;
+	double Sweeps;
+	double Queries;
+};
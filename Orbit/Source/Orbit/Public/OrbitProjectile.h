@@ -20,6 +20,19 @@ class AOrbitProjectile : public AActor
 public:
 	AOrbitProjectile(const FObjectInitializer& ObjectInitializer);
 
+	/** Pool side: puts a parked projectile back in play at Location, flying along Rotation at InitialSpeed. */
+	void Activate(const FVector& Location, const FRotator& Rotation, APawn* InInstigator);
+
+	/** Pool side: hides it and stops it. Components stay registered so Activate is cheap. */
+	void Deactivate();
+
+	/** Done with it: back to its pool, or destroyed if it did not come from one. */
+	void Release();
+
+	/** Set by the pool that owns it. */
+	TWeakObjectPtr<class AOrbitProjectilePool> Pool;
+	int32 PoolSlot;	// index in the pool's active list, INDEX_NONE while parked
+
 	/** called when projectile hits something */
 	UFUNCTION()
 	void OnHit(AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "GameFramework/Actor.h"
+#include "OrbitProjectileManager.generated.h"
+
+class AOrbitProjectile;
+class UGravityManager;
+
+/**
+ * Simulates every live projectile of a world in one structure-of-arrays batch instead of an
+ * AOrbitProjectile actor per shot: gravity for all of them in one field sample, one sweep
+ * loop, and one instanced mesh to draw them. Movement settings (speed, life span, radius,
+ * bounce) are read from the AOrbitProjectile class a shot is fired with, so a projectile
+ * behaves the same whether it is batched or spawned as an actor with Promote.
+ */
+UCLASS()
+class ORBIT_API AOrbitProjectileManager : public AActor
+{
+	GENERATED_BODY()
+public:
+	AOrbitProjectileManager(const FObjectInitializer& ObjectInitializer);
+
+	/** Drawn at every projectile. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Projectile)
+	UStaticMesh* ProjectileMesh;
+
+	/** Scale of ProjectileMesh at each projectile. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Projectile)
+	FVector ProjectileMeshScale;
+
+	/** Most projectiles alive at once. Firing past it retires the oldest. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Projectile, meta = (ClampMin = "1"))
+	int32 MaxProjectiles;
+
+	/** The world's manager, spawned on first use. */
+	static AOrbitProjectileManager* Get(UWorld* World);
+
+	/** Launches a projectile of Class along Rotation with its class's initial speed. Returns its index until the next tick. */
+	int32 Fire(TSubclassOf<AOrbitProjectile> Class, const FVector& Location, const FRotator& Rotation, APawn* Instigator);
+
+	/** Takes projectile Index out of the batch and fires it from the projectile pool as a full actor in the same state, for gameplay that needs one. Tick does this when one hits a simulating body. */
+	AOrbitProjectile* Promote(int32 Index);
+
+	int32 Num() const { return Positions.Num(); }
+
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+	/** Movement settings of one projectile class, read off its default object once. */
+	struct FProjectileKind
+	{
+		TSubclassOf<AOrbitProjectile> Class;
+		float InitialSpeed;
+		float MaxSpeed;
+		float LifeSpan;
+		float Radius;
+		float GravityScale;
+		float Bounciness;
+		float Friction;
+		bool bShouldBounce;
+		ECollisionChannel Channel;
+		FCollisionResponseParams ResponseParams;
+	};
+
+	int32 FindOrAddKind(TSubclassOf<AOrbitProjectile> Class);
+	void RemoveProjectile(int32 Index);
+	void UpdateInstances();
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Instances;
+
+	UPROPERTY(Transient)
+	UGravityManager* GravityManager;
+
+	TArray<FProjectileKind> Kinds;
+
+	// Per projectile, all in the same order. Removal swaps the last one in.
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<float> TimeLeft;
+	TArray<uint8> KindIndices;
+	TArray<TWeakObjectPtr<APawn>> Instigators;
+
+	TArray<FVector> Field;
+};
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "GameFramework/Actor.h"
+#include "OrbitProjectilePool.generated.h"
+
+class AOrbitProjectile;
+
+/** Projectiles of one class, parked and in flight. */
+USTRUCT()
+struct FOrbitProjectileClassPool
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TSubclassOf<AOrbitProjectile> Class;
+
+	UPROPERTY()
+	TArray<AOrbitProjectile*> Free;
+
+	/** In flight, in the same order as ExpireTimes. */
+	UPROPERTY()
+	TArray<AOrbitProjectile*> Active;
+
+	TArray<float> ExpireTimes;
+	float LifeSpan;
+
+	FOrbitProjectileClassPool() : LifeSpan(0.f) {}
+};
+
+struct FOrbitProjectilePoolStats
+{
+	int32 NumSpawned;		// actors ever created, warm-up included
+	int32 NumFired;
+	int32 NumReused;		// shots served from the free list
+	int32 NumGrown;			// shots that found the free list empty and spawned
+	int32 NumRecycled;		// shots that found the pool at MaxPoolSize and took the oldest in flight
+	int32 NumActive;
+	int32 PeakActive;
+
+	FOrbitProjectilePoolStats() : NumSpawned(0), NumFired(0), NumReused(0), NumGrown(0), NumRecycled(0), NumActive(0), PeakActive(0) {}
+};
+
+/**
+ * Keeps spawned AOrbitProjectiles around instead of destroying them. A released projectile is
+ * hidden, loses collision and stops its movement component, but stays registered, so firing it
+ * again is a teleport and a few flag flips rather than a spawn. Life span is tracked here
+ * rather than with the actor's own timer, which would destroy it.
+ *
+ * Orbit.ProjectileBench [Rounds] [RoundsPerFrame] fires Rounds shots without and then with the
+ * pool and logs frame and garbage collection time for both, and how many pooled shots were
+ * reuses. It needs no player, e.g.
+ * UE4Editor Orbit -game -nullrhi -ExecCmds="Orbit.ProjectileBench 10000".
+ */
+UCLASS()
+class ORBIT_API AOrbitProjectilePool : public AActor
+{
+	GENERATED_BODY()
+public:
+	AOrbitProjectilePool(const FObjectInitializer& ObjectInitializer);
+
+	/** Projectiles spawned up front the first time a class is fired. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Pool, meta = (ClampMin = "0"))
+	int32 WarmUpSize;
+
+	/** Most projectiles of one class. Past it, a shot takes over the oldest one still in flight. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Pool, meta = (ClampMin = "1"))
+	int32 MaxPoolSize;
+
+	/** The world's pool, spawned on first use. */
+	static AOrbitProjectilePool* Get(UWorld* World);
+
+	/** Spawns parked projectiles of Class until Count of them exist. */
+	void WarmUp(TSubclassOf<AOrbitProjectile> Class, int32 Count);
+
+	/** Launches a projectile of Class from the pool. */
+	AOrbitProjectile* Fire(TSubclassOf<AOrbitProjectile> Class, const FVector& Location, const FRotator& Rotation, APawn* InInstigator);
+
+	/** Parks Projectile for reuse. Projectiles that did not come from a pool are destroyed. */
+	void Release(AOrbitProjectile* Projectile);
+
+	const FOrbitProjectilePoolStats& GetStats() const { return Stats; }
+
+	/** Starts Orbit.ProjectileBench in this pool's world. Results are logged when it finishes. */
+	void StartBench(int32 Rounds, int32 RoundsPerFrame);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+	FOrbitProjectileClassPool& FindOrAddPool(TSubclassOf<AOrbitProjectile> Class);
+	AOrbitProjectile* SpawnParked(FOrbitProjectileClassPool& Pool);
+	void Park(FOrbitProjectileClassPool& Pool, int32 ActiveIndex);
+
+	/** Drives Orbit.ProjectileBench, one frame at a time. */
+	void TickBench(float DeltaSeconds);
+
+	UPROPERTY()
+	TArray<FOrbitProjectileClassPool> Pools;
+
+	FOrbitProjectilePoolStats Stats;
+
+	struct FBenchPhase
+	{
+		int32 Fired;
+		int32 Frames;
+		double FrameTime;
+		double MaxFrameTime;
+		double GcTime;
+		int32 NumGc;
+	};
+	struct FBench
+	{
+		int32 Rounds;
+		int32 RoundsPerFrame;
+		int32 Phase;				// 0 spawn/destroy, 1 pooled, 2 done
+		double DrainUntil;			// world time the phase's last shots have expired by
+		bool bCollecting;			// forced a GC, waiting for it to show up
+		bool bSkipFrame;			// the pool was just warmed up, keep that frame out of the times
+		int32 NumGcAtRequest;
+		int32 SavedMaxPoolSize;
+		int32 PeakInFlight;			// spawn phase projectiles up when the last one was fired
+		FOrbitProjectilePoolStats StatsBefore;	// at the start of the pooled phase
+		TSubclassOf<AOrbitProjectile> Class;
+		FBenchPhase Results[2];
+	};
+	FBench Bench;
+};
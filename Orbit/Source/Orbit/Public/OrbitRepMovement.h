@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+#include "OrbitCoreBridge.h"
+#include "OrbitCore/MovementQuantize.h"
+#include "OrbitRepMovement.generated.h"
+
+/**
+ * A character's movement for simulated proxies, relative to the planet it is on instead of FRepMovement's
+ * world space: a quantized direction and distance from the planet's center, velocity in the tangent plane,
+ * and the heading about up. See OrbitCore/MovementQuantize.h for the layout and OrbitNetBench for what it saves.
+ * Off every planet, or on one clients can't resolve, it is world space, still quantized.
+ *
+ * Only the quantized form is kept, so comparing two of these is what decides whether anything is sent.
+ */
+USTRUCT()
+struct ORBIT_API FOrbitRepMovement
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** What we are relative to; NULL for world space. Needs to be net addressable, which level actors are. */
+	UPROPERTY()
+	AActor* Body;
+
+	OrbitCore::FQuantizedMovement Quantized;
+
+	FOrbitRepMovement() : Body(NULL) {}
+
+	/** Quantizes a character at Location facing Rotation, relative to InBody if there is one and it is net addressable. */
+	void Set(AActor* InBody, const FVector& Location, const FVector& Velocity, const FRotator& Rotation);
+
+	/**
+	 * Back out in world space, about the body where it is here. Relative rotations come out upright on the
+	 * body with the heading that was sent. False if the body hasn't resolved on this end.
+	 */
+	bool Get(FVector& OutLocation, FVector& OutVelocity, FRotator& OutRotation) const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FOrbitRepMovement& Other) const
+	{
+		return Body == Other.Body && Quantized == Other.Quantized;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FOrbitRepMovement> : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
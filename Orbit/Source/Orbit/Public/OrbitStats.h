@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+
+/**
+ * Orbit's own stats: "stat Orbit" in the console shows them with the usual stats system.
+ * Cycle stats are inclusive, so PerformMovement contains FindFloor and so on.
+ */
+DECLARE_STATS_GROUP(TEXT("Orbit"), STATGROUP_Orbit, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gravity Solve"), STAT_OrbitGravitySolve, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gravity Integrate"), STAT_OrbitGravityIntegrate, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gravity Sample"), STAT_OrbitGravitySample, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Trajectories"), STAT_OrbitTrajectories, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Movement Tick"), STAT_OrbitMovementTick, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Perform Movement"), STAT_OrbitPerformMovement, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Perform Glide"), STAT_OrbitPerformGlide, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Find Floor"), STAT_OrbitFindFloor, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Step Up"), STAT_OrbitStepUp, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Phys Walking"), STAT_OrbitPhysWalking, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Phys Falling"), STAT_OrbitPhysFalling, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rotation Update"), STAT_OrbitRotationUpdate, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile Batch"), STAT_OrbitProjectileBatch, STATGROUP_Orbit, ORBIT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Movement Batch"), STAT_OrbitMovementBatch, STATGROUP_Orbit, ORBIT_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Floor Queries"), STAT_OrbitFloorQueries, STATGROUP_Orbit, ORBIT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sweeps"), STAT_OrbitSweeps, STATGROUP_Orbit, ORBIT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Line Traces"), STAT_OrbitLineTraces, STATGROUP_Orbit, ORBIT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Overlaps"), STAT_OrbitOverlaps, STATGROUP_Orbit, ORBIT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Async Traces"), STAT_OrbitAsyncTraces, STATGROUP_Orbit, ORBIT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Prefetched Floors"), STAT_OrbitPrefetchedFloors, STATGROUP_Orbit, ORBIT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Analytic Planet Queries"), STAT_OrbitAnalyticQueries, STATGROUP_Orbit, ORBIT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Gravity Receivers"), STAT_OrbitGravityReceivers, STATGROUP_Orbit, ORBIT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Gravity Sample Points"), STAT_OrbitGravitySamplePoints, STATGROUP_Orbit, ORBIT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Fixed Movement Steps"), STAT_OrbitMovementSteps, STATGROUP_Orbit, ORBIT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Batched Glides"), STAT_OrbitBatchedGlides, STATGROUP_Orbit, ORBIT_API);
+
+/** Everything above, as CSV columns. Timers come first. */
+namespace EOrbitStat
+{
+	enum Type
+	{
+		GravitySolve,
+		GravityIntegrate,
+		GravitySample,
+		Trajectories,
+		MovementTick,
+		PerformMovement,
+		PerformGlide,
+		FindFloor,
+		StepUp,
+		PhysWalking,
+		PhysFalling,
+		RotationUpdate,
+		ProjectileBatch,
+		MovementBatch,
+		NumTimers,
+
+		FloorQueries = NumTimers,
+		Sweeps,
+		LineTraces,
+		Overlaps,
+		AsyncTraces,
+		PrefetchedFloors,
+		AnalyticQueries,
+		GravityReceivers,
+		GravitySamplePoints,
+		MovementSteps,
+		BatchedGlides,
+		Num
+	};
+}
+
+/**
+ * The same numbers, kept by hand so they can be logged where the stats system is compiled
+ * out or nobody is looking, like a dedicated server. Start the game with -OrbitStatsCsv to get
+ * one row per frame in Saved/Profiling, or -OrbitStatsCsv=Path for somewhere else. Game thread only;
+ * work on other threads is counted where it is waited for.
+ */
+class ORBIT_API FOrbitStatsCsv
+{
+public:
+	static bool IsEnabled() { return bEnabled; }
+
+	static void AddCycles(EOrbitStat::Type Stat, uint32 Cycles);
+	static void AddCount(EOrbitStat::Type Stat, int32 Count);
+
+	/** Writes out the previous frame once per frame. Called from the gravity tick, which every frame with a world has. */
+	static void Tick();
+
+	/** Keeps the numbers without -OrbitStatsCsv, for in-game readers like AOrbitPerfGameMode. No file is written. */
+	static void StartCounting();
+
+	/** What the last finished frame added up to, once counting. */
+	static double GetLastFrame(EOrbitStat::Type Stat) { return LastValues[Stat]; }
+
+	/** Times a scope into the CSV, next to the SCOPE_CYCLE_COUNTER for the stats system. */
+	class FScope
+	{
+	public:
+		FScope(EOrbitStat::Type InStat)
+			: Stat(InStat)
+			, StartCycles(bEnabled ? FPlatformTime::Cycles() : 0)
+		{
+		}
+		~FScope()
+		{
+			if (bEnabled)
+			{
+				AddCycles(Stat, FPlatformTime::Cycles() - StartCycles);
+			}
+		}
+	private:
+		EOrbitStat::Type Stat;
+		uint32 StartCycles;
+	};
+
+private:
+	static void Initialize();
+	static void Shutdown();
+
+	static bool bEnabled;
+	static bool bInitialized;
+	static FArchive* Writer;
+	static uint64 Frame;
+	static double Values[EOrbitStat::Num];
+	static double LastValues[EOrbitStat::Num];
+};
+
+#define ORBIT_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(STAT_Orbit##Stat); \
+	FOrbitStatsCsv::FScope OrbitStatsScope_##Stat(EOrbitStat::Stat)
+
+#define ORBIT_INC_COUNTER(Stat, Amount) \
+	INC_DWORD_STAT_BY(STAT_Orbit##Stat, Amount); \
+	FOrbitStatsCsv::AddCount(EOrbitStat::Stat, Amount)
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Orbit.h"
+
+// Compiled out of shipping builds unless asked for.
+#ifndef ORBIT_TRACE_ENABLED
+#define ORBIT_TRACE_ENABLED !UE_BUILD_SHIPPING
+#endif
+
+/** What happened. Add new ones at the end and describe their fields in OrbitTrace.cpp, the decoder reads the names from the file. */
+namespace EOrbitTrace
+{
+	enum Type
+	{
+		FloorAdjust,		// MoveDist, Hit
+		WalkableReject,		// ImpactNormal
+		NoFloor,			// SweepDistance
+		WalkingOffFloor,	// Falling
+		StepUp,				// Result, NormalDotGravity
+		StepUpReject,		// Reason (EOrbitStepUpReject)
+		ModeChange,			// PrevMode, Mode, CustomMode
+		MissingGravityBody,	// NameCrc
+		Num
+	};
+}
+
+namespace EOrbitStepUpReject
+{
+	enum Type
+	{
+		OpposedNormal,		// unwalkable normal facing the move
+		AboveOldPosition,	// unwalkable normal higher than where we started
+		EdgeTolerance,
+		CannotStepUp,		// surface says no
+		NoPerch,			// stepping up onto a ledge we can't stand on
+	};
+}
+
+/** One field of an event, float or integer depending on the event. */
+struct FOrbitTraceValue
+{
+	union
+	{
+		float F;
+		int32 I;
+	};
+	FOrbitTraceValue() : I(0) {}
+	FOrbitTraceValue(float InF) : F(InF) {}
+	FOrbitTraceValue(int32 InI) : I(InI) {}
+	FOrbitTraceValue(uint32 InI) : I((int32)InI) {}
+	FOrbitTraceValue(bool bIn) : I(bIn ? 1 : 0) {}
+};
+
+/** Fixed size, written to the dump as is. */
+struct FOrbitTraceEvent
+{
+	double Time;		// FPlatformTime::Seconds
+	uint32 Frame;		// GFrameCounter
+	uint16 Type;		// EOrbitTrace
+	uint16 Reserved;
+	uint32 Object;		// UObject unique ID of whoever wrote it, 0 for none
+	FOrbitTraceValue Data[3];
+};
+
+/**
+ * Binary event trace for hot paths, in place of UE_LOG. Each thread writes fixed-size events
+ * into its own ring buffer of the last EventsPerThread events, with no locks and no formatting:
+ * the cost of an event is a TLS lookup and a 32 byte store. Nothing leaves memory until
+ * Orbit.TraceDump [Path] writes every thread's buffer to a file (Saved/Profiling by default),
+ * which Orbit/Tools/OrbitTraceDecode.py turns back into text. Orbit.Trace 0 stops recording.
+ */
+class ORBIT_API FOrbitTrace
+{
+public:
+	static const uint32 EventsPerThread = 8192;	// power of two
+
+	static bool IsEnabled() { return Enabled != 0; }
+
+	static void Write(EOrbitTrace::Type Type, const UObject* Object, FOrbitTraceValue A = FOrbitTraceValue(), FOrbitTraceValue B = FOrbitTraceValue(), FOrbitTraceValue C = FOrbitTraceValue());
+
+	/** Writes every thread's events, oldest first, to Path. Safe while other threads keep writing. */
+	static bool Dump(const FString& Path);
+
+	static int32 Enabled;
+
+private:
+	struct FBuffer
+	{
+		FOrbitTraceEvent Events[EventsPerThread];
+		volatile uint32 Head;	// events ever written; only the owning thread moves it
+		uint32 ThreadId;
+	};
+
+	static FBuffer* AddThread();
+};
+
+#if ORBIT_TRACE_ENABLED
+#define ORBIT_TRACE(Type, Object, ...) \
+	do { if (FOrbitTrace::IsEnabled()) { FOrbitTrace::Write(EOrbitTrace::Type, Object, ##__VA_ARGS__); } } while (0)
+#else
+#define ORBIT_TRACE(Type, Object, ...) do { } while (0)
+#endif
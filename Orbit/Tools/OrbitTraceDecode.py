@@ -0,0 +1,98 @@
+#!/usr/bin/env python
+# Turns an Orbit.TraceDump file back into text, one event per line, all threads merged by time.
+#   OrbitTraceDecode.py Saved/Profiling/OrbitTrace-....otrace [--type StepUpReject] [--object 1234] [--summary]
+import argparse
+import struct
+import sys
+
+EVENT = struct.Struct('<dIHHI12s')  # FOrbitTraceEvent, 32 bytes
+
+# Enums the events carry as ints.
+MOVEMENT_MODES = ['None', 'Walking', 'NavWalking', 'Falling', 'Swimming', 'Flying', 'Custom']
+STEP_UP_REJECTS = ['OpposedNormal', 'AboveOldPosition', 'EdgeTolerance', 'CannotStepUp', 'NoPerch']
+NAMED_FIELDS = {
+	('ModeChange', 'PrevMode'): MOVEMENT_MODES,
+	('ModeChange', 'Mode'): MOVEMENT_MODES,
+	('StepUpReject', 'Reason'): STEP_UP_REJECTS,
+}
+
+
+def read_string(f):
+	length = struct.unpack('<B', f.read(1))[0]
+	return f.read(length).decode('ascii')
+
+
+def read_trace(path):
+	with open(path, 'rb') as f:
+		if f.read(8) != b'ORBTRACE':
+			raise ValueError('%s is not an Orbit trace' % path)
+		version, num_types = struct.unpack('<II', f.read(8))
+		if version != 1:
+			raise ValueError('unknown trace version %d' % version)
+		types = []
+		for _ in range(num_types):
+			name = read_string(f)
+			fields = [field.split(':') for field in read_string(f).split(',') if field]
+			types.append((name, fields))
+
+		events = []
+		num_threads = struct.unpack('<I', f.read(4))[0]
+		for _ in range(num_threads):
+			thread_id, num_events = struct.unpack('<II', f.read(8))
+			data = f.read(num_events * EVENT.size)
+			for i in range(num_events):
+				time, frame, type_index, _, obj, payload = EVENT.unpack_from(data, i * EVENT.size)
+				events.append((time, frame, thread_id, type_index, obj, payload))
+	events.sort()
+	return types, events
+
+
+def format_fields(type_name, fields, payload):
+	floats = struct.unpack('<3f', payload)
+	ints = struct.unpack('<3i', payload)
+	out = []
+	for i, (name, kind) in enumerate(fields):
+		if kind == 'f':
+			value = '%.3f' % floats[i]
+		elif kind == 'x':
+			value = '%08x' % (ints[i] & 0xffffffff)
+		else:
+			names = NAMED_FIELDS.get((type_name, name))
+			value = names[ints[i]] if names and 0 <= ints[i] < len(names) else str(ints[i])
+		out.append('%s=%s' % (name, value))
+	return ' '.join(out)
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__)
+	parser.add_argument('path')
+	parser.add_argument('--type', action='append', help='only these event types')
+	parser.add_argument('--object', type=int, action='append', help='only these object IDs')
+	parser.add_argument('--summary', action='store_true', help='count events per type instead of listing them')
+	args = parser.parse_args()
+
+	types, events = read_trace(args.path)
+	if not events:
+		return 0
+	start = events[0][0]
+
+	counts = {}
+	for time, frame, thread_id, type_index, obj, payload in events:
+		type_name, fields = types[type_index] if type_index < len(types) else ('Type%d' % type_index, [])
+		if args.type and type_name not in args.type:
+			continue
+		if args.object and obj not in args.object:
+			continue
+		if args.summary:
+			counts[type_name] = counts.get(type_name, 0) + 1
+			continue
+		sys.stdout.write('%10.3fms frame %-8d thread %-6d obj %-6d %-18s %s\n' % (
+			(time - start) * 1000.0, frame, thread_id, obj, type_name, format_fields(type_name, fields, payload)))
+
+	for type_name in sorted(counts, key=counts.get, reverse=True):
+		sys.stdout.write('%8d %s\n' % (counts[type_name], type_name))
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -0,0 +1,878 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Microbenchmarks for the OrbitCore kernels. OrbitCoreBench [filter] runs the benchmarks whose
+// name contains filter. Each one checks its result against the plain version first and the run
+// fails if they disagree, so a faster kernel can't quietly be a wrong one.
+
+#include "OrbitCore/GravityIntegration.h"
+#include "OrbitCore/GravityMath.h"
+#include "OrbitCore/GravitySimd.h"
+#include "OrbitCore/MovementMath.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace OrbitCore;
+
+namespace
+{
+	volatile float Sink;	// keeps results alive
+
+	std::mt19937 Random(1234);
+
+	float RandomRange(float Min, float Max)
+	{
+		return std::uniform_real_distribution<float>(Min, Max)(Random);
+	}
+
+	FVec RandomVector(float Extent)
+	{
+		return FVec(RandomRange(-Extent, Extent), RandomRange(-Extent, Extent), RandomRange(-Extent, Extent));
+	}
+
+	FVec RandomUnit()
+	{
+		FVec V;
+		do
+		{
+			V = RandomVector(1.f);
+		} while (V.SizeSquared() < 0.01f || V.SizeSquared() > 1.f);
+		return SafeNormal(V);
+	}
+
+	/** Runs Body until about MinSeconds have passed and reports nanoseconds per Ops. */
+	template<typename TBody>
+	void Measure(const char* Name, double Ops, TBody Body)
+	{
+		const double MinSeconds = 0.25;
+		Body();//warm up
+		int Runs = 0;
+		const std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+		double Seconds = 0.0;
+		do
+		{
+			Body();
+			Runs++;
+			Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+		} while (Seconds < MinSeconds);
+		std::printf("%-34s %10.3f ns/op %12.1f Mop/s\n", Name, Seconds * 1.e9 / (Runs * Ops), Runs * Ops / Seconds * 1.e-6);
+	}
+
+	bool Near(float A, float B)
+	{
+		return std::fabs(A - B) <= 1.e-4f * (std::fabs(A) + std::fabs(B)) + 1.e-20f;
+	}
+
+	struct FBatch
+	{
+		std::vector<float> X, Y, Z, FX, FY, FZ, FM;
+
+		explicit FBatch(int Num) : X(Num), Y(Num), Z(Num), FX(Num), FY(Num), FZ(Num), FM(Num) {}
+
+		void Clear()
+		{
+			std::fill(FX.begin(), FX.end(), 0.f);
+			std::fill(FY.begin(), FY.end(), 0.f);
+			std::fill(FZ.begin(), FZ.end(), 0.f);
+			std::fill(FM.begin(), FM.end(), 0.f);
+		}
+	};
+
+	bool BenchGravity(bool bInverseSquare)
+	{
+		const int NumReceivers = 4096;
+		const int NumSources = 64;
+		const float SofteningSq = 100.f;
+
+		FBatch Batch(NumReceivers);
+		for (int i = 0; i < NumReceivers; i++)
+		{
+			const FVec P = RandomVector(100000.f);
+			Batch.X[i] = P.X;
+			Batch.Y[i] = P.Y;
+			Batch.Z[i] = P.Z;
+		}
+		std::vector<FVec> Sources(NumSources);
+		std::vector<float> Masses(NumSources);
+		for (int s = 0; s < NumSources; s++)
+		{
+			Sources[s] = RandomVector(100000.f);
+			Masses[s] = RandomRange(1.e6f, 1.e9f);
+		}
+		Sources[0] = FVec(Batch.X[0], Batch.Y[0], Batch.Z[0]);//a body on itself adds nothing
+
+		// The batch kernel against one AccumulatePair per receiver and source.
+		Batch.Clear();
+		for (int s = 0; s < NumSources; s++)
+		{
+			AccumulateSource(Batch.X.data(), Batch.Y.data(), Batch.Z.data(), Batch.FX.data(), Batch.FY.data(), Batch.FZ.data(), Batch.FM.data(), 0, NumReceivers, Sources[s], Masses[s], SofteningSq, bInverseSquare);
+		}
+		for (int i = 0; i < NumReceivers; i++)
+		{
+			FVec Field;
+			float Magnitude = 0.f;
+			for (int s = 0; s < NumSources; s++)
+			{
+				AccumulatePair(FVec(Batch.X[i], Batch.Y[i], Batch.Z[i]), Sources[s], Masses[s], SofteningSq, bInverseSquare, Field, Magnitude);
+			}
+			if (!Near(Field.X, Batch.FX[i]) || !Near(Field.Y, Batch.FY[i]) || !Near(Field.Z, Batch.FZ[i]) || !Near(Magnitude, Batch.FM[i]))
+			{
+				std::printf("AccumulateSource disagrees with AccumulatePair at receiver %d\n", i);
+				return false;
+			}
+		}
+
+		Measure(bInverseSquare ? "AccumulateSource inverse square" : "AccumulateSource linear", double(NumReceivers) * NumSources, [&]()
+		{
+			Batch.Clear();
+			for (int s = 0; s < NumSources; s++)
+			{
+				AccumulateSource(Batch.X.data(), Batch.Y.data(), Batch.Z.data(), Batch.FX.data(), Batch.FY.data(), Batch.FZ.data(), Batch.FM.data(), 0, NumReceivers, Sources[s], Masses[s], SofteningSq, bInverseSquare);
+			}
+			Sink = Batch.FX[NumReceivers / 2];
+		});
+		Measure(bInverseSquare ? "AccumulatePair inverse square" : "AccumulatePair linear", double(NumReceivers) * NumSources, [&]()
+		{
+			float Sum = 0.f;
+			for (int i = 0; i < NumReceivers; i++)
+			{
+				FVec Field;
+				float Magnitude = 0.f;
+				const FVec Point(Batch.X[i], Batch.Y[i], Batch.Z[i]);
+				for (int s = 0; s < NumSources; s++)
+				{
+					AccumulatePair(Point, Sources[s], Masses[s], SofteningSq, bInverseSquare, Field, Magnitude);
+				}
+				Sum += Field.X + Magnitude;
+			}
+			Sink = Sum;
+		});
+		return true;
+	}
+
+	const int NumVectors = 1 << 16;
+
+	bool BenchRemoveVertical()
+	{
+		std::vector<FVec> In(NumVectors), Vertical(NumVectors);
+		for (int i = 0; i < NumVectors; i++)
+		{
+			In[i] = RandomVector(1000.f);
+			Vertical[i] = RandomUnit() * RandomRange(1.f, 2000.f);
+		}
+		for (int i = 0; i < NumVectors; i++)
+		{
+			const FVec Out = RemoveVertical(In[i], Vertical[i]);
+			if (std::fabs(Dot(Out, SafeNormal(Vertical[i]))) > 1.e-3f * In[i].Size())
+			{
+				std::printf("RemoveVertical left %f along vertical\n", Dot(Out, SafeNormal(Vertical[i])));
+				return false;
+			}
+		}
+		if (RemoveVertical(In[0], FVec()).X != In[0].X)
+		{
+			std::printf("RemoveVertical changed a vector with no vertical\n");
+			return false;
+		}
+
+		Measure("RemoveVertical", NumVectors, [&]()
+		{
+			float Sum = 0.f;
+			for (int i = 0; i < NumVectors; i++)
+			{
+				Sum += RemoveVertical(In[i], Vertical[i]).X;
+			}
+			Sink = Sum;
+		});
+		return true;
+	}
+
+	bool BenchNewFallVelocity()
+	{
+		const float TerminalLimit = 4000.f;
+		const float DeltaTime = 1.f / 60.f;
+		std::vector<FVec> Velocity(NumVectors), Gravity(NumVectors);
+		for (int i = 0; i < NumVectors; i++)
+		{
+			Velocity[i] = RandomVector(6000.f);
+			Gravity[i] = RandomUnit() * RandomRange(100.f, 2000.f);
+		}
+		for (int i = 0; i < NumVectors; i++)
+		{
+			const FVec Out = NewFallVelocity(Velocity[i], Gravity[i], DeltaTime, TerminalLimit);
+			const FVec Down = SafeNormal(Gravity[i]);
+			const FVec Unclamped = Velocity[i] + Gravity[i] * DeltaTime;
+			const float Expected = Dot(Unclamped, Down) > TerminalLimit ? TerminalLimit : Dot(Unclamped, Down);
+			if (std::fabs(Dot(Out, Down) - Expected) > 0.05f || (RemoveVertical(Out, Down) - RemoveVertical(Unclamped, Down)).Size() > 0.05f)
+			{
+				std::printf("NewFallVelocity clamped %d wrong\n", i);
+				return false;
+			}
+		}
+
+		Measure("NewFallVelocity", NumVectors, [&]()
+		{
+			float Sum = 0.f;
+			for (int i = 0; i < NumVectors; i++)
+			{
+				Sum += NewFallVelocity(Velocity[i], Gravity[i], DeltaTime, TerminalLimit).Z;
+			}
+			Sink = Sum;
+		});
+		return true;
+	}
+
+	bool BenchIsWalkableNormal()
+	{
+		const float WalkableFloorZ = 0.71f;
+		std::vector<FVec> Normal(NumVectors), Direction(NumVectors);
+		for (int i = 0; i < NumVectors; i++)
+		{
+			Normal[i] = RandomUnit();
+			Direction[i] = RandomUnit();
+		}
+		for (int i = 0; i < NumVectors; i++)
+		{
+			// Straight from IsWalkable: facing up, then not too steep.
+			const bool bExpected = Dot(Normal[i], -Direction[i]) >= KindaSmallNumber && std::fabs(Dot(Normal[i], Direction[i])) >= WalkableFloorZ;
+			if (IsWalkableNormal(Normal[i], Direction[i], WalkableFloorZ) != bExpected)
+			{
+				std::printf("IsWalkableNormal disagrees with IsWalkable at %d\n", i);
+				return false;
+			}
+		}
+
+		Measure("IsWalkableNormal", NumVectors, [&]()
+		{
+			int Count = 0;
+			for (int i = 0; i < NumVectors; i++)
+			{
+				Count += IsWalkableNormal(Normal[i], Direction[i], WalkableFloorZ) ? 1 : 0;
+			}
+			Sink = float(Count);
+		});
+		return true;
+	}
+
+	bool BenchGlide()
+	{
+		const int NumCharacters = 4096;
+		const float DeltaTime = 1.f / 60.f;
+		std::vector<FVec> Locations(NumCharacters), Velocities(NumCharacters), Accelerations(NumCharacters), Centers(NumCharacters);
+		std::vector<float> Heights(NumCharacters);
+		std::vector<FWalkParams> Params(NumCharacters);
+		for (int i = 0; i < NumCharacters; i++)
+		{
+			const FVec Up = RandomUnit();
+			Centers[i] = RandomVector(100000.f);
+			Heights[i] = RandomRange(500.f, 5000.f);
+			Locations[i] = Centers[i] + Up * Heights[i];
+			Velocities[i] = RemoveVertical(RandomVector(800.f), Up);
+			Accelerations[i] = i % 4 == 0 ? FVec() : RandomVector(2048.f);//some braking, most pushing
+			Params[i].MaxSpeed = 600.f;
+			Params[i].Friction = 8.f;
+			Params[i].BrakingFriction = 16.f;
+			Params[i].BrakingDeceleration = 2048.f;
+		}
+
+		// A few seconds of the batch, against the same steps one character at a time.
+		std::vector<FVec> BatchLocations = Locations, BatchVelocities = Velocities;
+		for (int Step = 0; Step < 180; Step++)
+		{
+			GlideBatch(NumCharacters, BatchLocations.data(), BatchVelocities.data(), Accelerations.data(), Centers.data(), Heights.data(), Params.data(), DeltaTime);
+		}
+		for (int i = 0; i < NumCharacters; i++)
+		{
+			FVec Location = Locations[i], Velocity = Velocities[i];
+			for (int Step = 0; Step < 180; Step++)
+			{
+				GlideBatch(1, &Location, &Velocity, &Accelerations[i], &Centers[i], &Heights[i], &Params[i], DeltaTime);
+			}
+			const FVec Up = SafeNormal(Location - Centers[i]);
+			if (!Near(Location.X, BatchLocations[i].X) || !Near(Location.Y, BatchLocations[i].Y) || !Near(Location.Z, BatchLocations[i].Z)
+				|| std::fabs((Location - Centers[i]).Size() - Heights[i]) > 0.05f
+				|| std::fabs(Dot(Velocity, Up)) > 0.05f
+				|| Velocity.Size() > Params[i].MaxSpeed * 1.01f + 0.05f)
+			{
+				std::printf("GlideBatch left character %d off the sphere or over speed\n", i);
+				return false;
+			}
+		}
+		if (!WalkVelocity(FVec(5.f, 0.f, 0.f), FVec(), DeltaTime, Params[0]).IsZero())
+		{
+			std::printf("WalkVelocity didn't brake a slow character to a stop\n");
+			return false;
+		}
+
+		Measure("GlideBatch", NumCharacters, [&]()
+		{
+			GlideBatch(NumCharacters, BatchLocations.data(), BatchVelocities.data(), Accelerations.data(), Centers.data(), Heights.data(), Params.data(), DeltaTime);
+			Sink = BatchLocations[NumCharacters / 2].X;
+		});
+		return true;
+	}
+
+	/**
+	 * What UGravityManager::ApplyGravity looked like before FGravityBodyRegistry: actors found through
+	 * name-keyed maps, and per source and receiver a GetGravityBody(FString) and SetGravityBody(FString,
+	 * FGravityBody), each a Contains and a lookup on a copied name plus a copied FGravityBody.
+	 */
+	struct FLegacyActor
+	{
+		FVec Location;
+		float Mass;
+		char Rest[240];	// the rest of an actor and its components, between one actor's location and the next
+	};
+
+	struct FLegacyGravityBody
+	{
+		int foo;
+		float Magnitude;
+		FVec GravityVector;
+
+		FLegacyGravityBody() : foo(0), Magnitude(0.f) {}
+	};
+
+	struct FLegacyGravity
+	{
+		std::unordered_map<std::string, FLegacyActor*> GravBods;
+		std::unordered_map<std::string, FLegacyActor*> GravActiveBods;
+		std::unordered_map<std::string, FLegacyGravityBody> GravityBodies;
+
+		FLegacyGravityBody GetGravityBody(std::string Name)
+		{
+			if (!GravityBodies.count(Name))
+			{
+				GravityBodies.insert(std::make_pair(Name, FLegacyGravityBody()));
+			}
+			return GravityBodies[Name];
+		}
+
+		bool SetGravityBody(std::string Name, FLegacyGravityBody GB)
+		{
+			if (!GravityBodies.count(Name))
+			{
+				return false;
+			}
+			GravityBodies[Name] = GB;
+			return true;
+		}
+
+		void ApplyGravity()
+		{
+			for (auto& GB : GravityBodies)
+			{
+				GB.second.GravityVector = FVec();
+				SetGravityBody(GB.first, GB.second);
+			}
+			for (const auto& Bod : GravBods)
+			{
+				const FLegacyActor* GravitationalBody = Bod.second;
+				for (const auto& ActiveBod : GravActiveBods)
+				{
+					const FLegacyActor* ActiveBody = ActiveBod.second;
+					FLegacyGravityBody BodyStats = GetGravityBody(ActiveBod.first);
+					const FVec GravityDistanceVector = GravitationalBody->Location - ActiveBody->Location;
+					BodyStats.Magnitude = ActiveBody->Mass * GravitationalBody->Mass / GravityDistanceVector.SizeSquared();
+					BodyStats.GravityVector += GravityDistanceVector * BodyStats.Magnitude;
+					SetGravityBody(ActiveBod.first, BodyStats);
+				}
+			}
+		}
+	};
+
+	/** The same bodies in the registry's layout: dense slot lists over parallel arrays, synced from the actors once per solve. */
+	struct FRegistryGravity
+	{
+		std::vector<const FLegacyActor*> Actors;
+		std::vector<FVec> Positions;
+		std::vector<float> Masses;
+		std::vector<FVec> GravityVectors;
+		std::vector<float> Magnitudes;
+		std::vector<int> Sources;
+		std::vector<int> Receivers;
+
+		void ApplyGravity()
+		{
+			for (size_t Slot = 0; Slot < Actors.size(); Slot++)
+			{
+				Positions[Slot] = Actors[Slot]->Location;
+			}
+			for (const int Receiver : Receivers)
+			{
+				FVec Field;
+				float Magnitude = 0.f;
+				for (const int Source : Sources)
+				{
+					AccumulatePair(Positions[Receiver], Positions[Source], Masses[Source], 0.f, false, Field, Magnitude);
+				}
+				GravityVectors[Receiver] = Field * Masses[Receiver];
+				Magnitudes[Receiver] = Magnitude * Masses[Receiver];
+			}
+		}
+	};
+
+	bool BenchRegistry()
+	{
+		const int NumReceivers = 10000;
+		const int NumSources = 16;
+
+		// Actors allocated one by one and visited in no particular order, as TObjectIterator found them.
+		std::vector<FLegacyActor*> Actors(NumSources + NumReceivers);
+		for (FLegacyActor*& Actor : Actors)
+		{
+			Actor = new FLegacyActor();
+		}
+		std::shuffle(Actors.begin(), Actors.end(), Random);
+
+		FLegacyGravity Legacy;
+		FRegistryGravity Registry;
+		for (int Slot = 0; Slot < NumSources + NumReceivers; Slot++)
+		{
+			FLegacyActor* Actor = Actors[Slot];
+			const bool bSource = Slot < NumSources;
+			Actor->Location = RandomVector(bSource ? 20000.f : 100000.f);
+			Actor->Mass = bSource ? RandomRange(1.e6f, 1.e9f) : RandomRange(50.f, 500.f);
+			const std::string Name = (bSource ? "StaticMeshActor_" : "StaticMeshActor_Active_") + std::to_string(Slot);
+			(bSource ? Legacy.GravBods : Legacy.GravActiveBods)[Name] = Actor;
+			(bSource ? Registry.Sources : Registry.Receivers).push_back(Slot);
+			Registry.Actors.push_back(Actor);
+		}
+		Registry.Positions.resize(Actors.size());
+		Registry.Masses.resize(Actors.size());
+		Registry.GravityVectors.resize(Actors.size());
+		Registry.Magnitudes.resize(Actors.size());
+		for (size_t Slot = 0; Slot < Actors.size(); Slot++)
+		{
+			Registry.Masses[Slot] = Actors[Slot]->Mass;
+		}
+
+		// Same force on every receiver, whichever order the sources were summed in.
+		Legacy.ApplyGravity();
+		Registry.ApplyGravity();
+		bool bAgree = true;
+		for (const auto& ActiveBod : Legacy.GravActiveBods)
+		{
+			const int Slot = int(std::find(Actors.begin(), Actors.end(), ActiveBod.second) - Actors.begin());
+			const FVec Expected = Legacy.GravityBodies[ActiveBod.first].GravityVector;
+			if ((Registry.GravityVectors[Slot] - Expected).Size() > 1.e-4f * Expected.Size())
+			{
+				std::printf("The registry disagrees with the name-keyed maps at %s\n", ActiveBod.first.c_str());
+				bAgree = false;
+				break;
+			}
+		}
+
+		if (bAgree)
+		{
+			Measure("ApplyGravity name-keyed maps", double(NumReceivers) * NumSources, [&]()
+			{
+				Legacy.ApplyGravity();
+				Sink = Legacy.GravityBodies.begin()->second.GravityVector.X;
+			});
+			Measure("ApplyGravity registry", double(NumReceivers) * NumSources, [&]()
+			{
+				Registry.ApplyGravity();
+				Sink = Registry.GravityVectors[NumSources].X;
+			});
+		}
+
+		for (FLegacyActor* Actor : Actors)
+		{
+			delete Actor;
+		}
+		return bAgree;
+	}
+
+#if ORBITCORE_SIMD
+	/**
+	 * AccumulateSourceSimd, the kernel FGravityKernel runs with bUseSimdKernel on, against the scalar one it
+	 * runs by default. GCC vectorizes the scalar loop by itself (see AccumulateSource); add -fno-tree-vectorize
+	 * to time it one receiver at a time.
+	 */
+	bool BenchGravitySimd(bool bInverseSquare)
+	{
+		const int NumReceivers = 4096;
+		const int NumSources = 64;
+		const float SofteningSq = 100.f;
+
+		FBatch Batch(NumReceivers), Scalar(NumReceivers);
+		for (int i = 0; i < NumReceivers; i++)
+		{
+			const FVec P = RandomVector(100000.f);
+			Batch.X[i] = Scalar.X[i] = P.X;
+			Batch.Y[i] = Scalar.Y[i] = P.Y;
+			Batch.Z[i] = Scalar.Z[i] = P.Z;
+		}
+		std::vector<FVec> Sources(NumSources);
+		std::vector<float> Masses(NumSources);
+		for (int s = 0; s < NumSources; s++)
+		{
+			Sources[s] = RandomVector(100000.f);
+			Masses[s] = RandomRange(1.e6f, 1.e9f);
+		}
+		Sources[0] = FVec(Batch.X[0], Batch.Y[0], Batch.Z[0]);//a body on itself adds nothing, not NaN
+
+		const auto RunSimd = [&]()
+		{
+			for (int s = 0; s < NumSources; s++)
+			{
+				AccumulateSourceSimd(Batch.X.data(), Batch.Y.data(), Batch.Z.data(), Batch.FX.data(), Batch.FY.data(), Batch.FZ.data(), Batch.FM.data(), 0, NumReceivers, Sources[s], Masses[s], SofteningSq, bInverseSquare);
+			}
+		};
+		const auto RunScalar = [&]()
+		{
+			for (int s = 0; s < NumSources; s++)
+			{
+				AccumulateSource(Scalar.X.data(), Scalar.Y.data(), Scalar.Z.data(), Scalar.FX.data(), Scalar.FY.data(), Scalar.FZ.data(), Scalar.FM.data(), 0, NumReceivers, Sources[s], Masses[s], SofteningSq, bInverseSquare);
+			}
+		};
+
+		Batch.Clear();
+		Scalar.Clear();
+		RunSimd();
+		RunScalar();
+		float WorstError = 0.f;
+		for (int i = 0; i < NumReceivers; i++)
+		{
+			const FVec Expected(Scalar.FX[i], Scalar.FY[i], Scalar.FZ[i]);
+			const float Error = (FVec(Batch.FX[i], Batch.FY[i], Batch.FZ[i]) - Expected).Size() / Expected.Size();
+			if (!(Error <= 1.e-5f) || !Near(Batch.FM[i], Scalar.FM[i]))
+			{
+				std::printf("The SIMD kernel disagrees with the scalar one at receiver %d (%g)\n", i, Error);
+				return false;
+			}
+			WorstError = std::max(WorstError, Error);
+		}
+		std::printf("%-34s %10.2e worst relative difference\n", bInverseSquare ? "SIMD vs scalar inverse square" : "SIMD vs scalar linear", WorstError);
+
+		Measure(bInverseSquare ? "SIMD kernel inverse square" : "SIMD kernel linear", double(NumReceivers) * NumSources, [&]()
+		{
+			Batch.Clear();
+			RunSimd();
+			Sink = Batch.FX[NumReceivers / 2];
+		});
+		Measure(bInverseSquare ? "scalar kernel inverse square" : "scalar kernel linear", double(NumReceivers) * NumSources, [&]()
+		{
+			Scalar.Clear();
+			RunScalar();
+			Sink = Scalar.FX[NumReceivers / 2];
+		});
+		return true;
+	}
+
+	bool BenchGravitySimdLinear() { return BenchGravitySimd(false); }
+	bool BenchGravitySimdInverseSquare() { return BenchGravitySimd(true); }
+#endif
+
+	/**
+	 * Worker threads that stay up between solves, like the task graph's, and take blocks off a shared
+	 * counter. The calling thread works too, the way the game thread does block 0 in SolveReceivers.
+	 */
+	class FBlockPool
+	{
+	public:
+		explicit FBlockPool(int NumThreads) : Generation(0), NumBlocks(0), NextBlock(0), NumBusy(0), bQuit(false)
+		{
+			for (int i = 1; i < NumThreads; i++)
+			{
+				Workers.push_back(std::thread([this]() { WorkerLoop(); }));
+			}
+		}
+
+		~FBlockPool()
+		{
+			{
+				std::lock_guard<std::mutex> Lock(Mutex);
+				bQuit = true;
+			}
+			Wake.notify_all();
+			for (std::thread& Worker : Workers)
+			{
+				Worker.join();
+			}
+		}
+
+		/** Calls Body(Block) for every block in [0, InNumBlocks) and returns once all are done. */
+		template<typename TBody>
+		void Run(int InNumBlocks, const TBody& InBody)
+		{
+			{
+				std::lock_guard<std::mutex> Lock(Mutex);
+				Body = InBody;
+				NumBlocks = InNumBlocks;
+				NextBlock = 0;
+				NumBusy = int(Workers.size());
+				Generation++;
+			}
+			Wake.notify_all();
+			WorkBlocks();
+
+			std::unique_lock<std::mutex> Lock(Mutex);
+			Done.wait(Lock, [this]() { return NumBusy == 0; });
+		}
+
+	private:
+		void WorkBlocks()
+		{
+			for (int Block = NextBlock++; Block < NumBlocks; Block = NextBlock++)
+			{
+				Body(Block);
+			}
+		}
+
+		void WorkerLoop()
+		{
+			int Seen = 0;
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> Lock(Mutex);
+					Wake.wait(Lock, [&]() { return bQuit || Generation != Seen; });
+					if (bQuit)
+					{
+						return;
+					}
+					Seen = Generation;
+				}
+				WorkBlocks();
+				{
+					std::lock_guard<std::mutex> Lock(Mutex);
+					NumBusy--;
+				}
+				Done.notify_one();
+			}
+		}
+
+		std::vector<std::thread> Workers;
+		std::mutex Mutex;
+		std::condition_variable Wake, Done;
+		std::function<void(int)> Body;
+		int Generation;
+		int NumBlocks;
+		std::atomic<int> NextBlock;
+		int NumBusy;
+		bool bQuit;
+	};
+
+	/** UGravityManager::SolveReceivers: the direct sum in 256-receiver blocks, spread over 1 to N threads. */
+	bool BenchParallelSolve()
+	{
+		const int ReceiversPerBlock = 256;
+		const int NumReceivers = 16384;
+		const int NumSources = 64;
+		const int NumBlocks = (NumReceivers + ReceiversPerBlock - 1) / ReceiversPerBlock;
+		const float SofteningSq = 100.f;
+
+		FBatch Batch(NumReceivers);
+		for (int i = 0; i < NumReceivers; i++)
+		{
+			const FVec P = RandomVector(100000.f);
+			Batch.X[i] = P.X;
+			Batch.Y[i] = P.Y;
+			Batch.Z[i] = P.Z;
+		}
+		std::vector<FVec> Sources(NumSources);
+		std::vector<float> Masses(NumSources);
+		for (int s = 0; s < NumSources; s++)
+		{
+			Sources[s] = RandomVector(100000.f);
+			Masses[s] = RandomRange(1.e6f, 1.e9f);
+		}
+
+		// SolveReceiverBlock for the direct path; blocks write disjoint receivers, so no locking.
+		const auto SolveBlock = [&](int Block)
+		{
+			const int Begin = Block * ReceiversPerBlock;
+			const int End = std::min(Begin + ReceiversPerBlock, NumReceivers);
+			for (int s = 0; s < NumSources; s++)
+			{
+				AccumulateSource(Batch.X.data(), Batch.Y.data(), Batch.Z.data(), Batch.FX.data(), Batch.FY.data(), Batch.FZ.data(), Batch.FM.data(), Begin, End, Sources[s], Masses[s], SofteningSq, true);
+			}
+		};
+
+		Batch.Clear();
+		for (int Block = 0; Block < NumBlocks; Block++)
+		{
+			SolveBlock(Block);
+		}
+		const FBatch Serial = Batch;
+
+		// Every receiver sums its sources in the same order whoever runs its block, so the results match
+		// bit for bit. Past the core count threads only take turns, which still checks that.
+		const int MaxThreads = std::max(4, int(std::thread::hardware_concurrency()));
+		for (int NumThreads = 1; NumThreads <= MaxThreads; NumThreads++)
+		{
+			FBlockPool Pool(NumThreads);
+			Batch.Clear();
+			Pool.Run(NumBlocks, SolveBlock);
+			if (Batch.FX != Serial.FX || Batch.FY != Serial.FY || Batch.FZ != Serial.FZ || Batch.FM != Serial.FM)
+			{
+				std::printf("SolveReceivers on %d threads differs from the serial solve\n", NumThreads);
+				return false;
+			}
+
+			char Name[64];
+			std::snprintf(Name, sizeof(Name), "SolveReceivers %d thread%s", NumThreads, NumThreads > 1 ? "s" : "");
+			Measure(Name, double(NumReceivers) * NumSources, [&]()
+			{
+				Batch.Clear();
+				Pool.Run(NumBlocks, SolveBlock);
+				Sink = Batch.FX[NumReceivers / 2];
+			});
+		}
+		std::printf("%-34s %10d\n", "hardware threads", int(std::thread::hardware_concurrency()));
+		return true;
+	}
+
+	/** Two point masses in the engine's inverse-square units (the field is Mass * D / |D|^3), total energy in double. */
+	struct FTwoBody
+	{
+		float Masses[2];
+
+		void operator()(const std::vector<FVec>& Positions, std::vector<FVec>& OutAccelerations) const
+		{
+			for (int i = 0; i < 2; i++)
+			{
+				FVec Field;
+				float Magnitude = 0.f;
+				AccumulatePair(Positions[i], Positions[1 - i], Masses[1 - i], 0.f, true, Field, Magnitude);
+				OutAccelerations[i] = Field;
+			}
+		}
+
+		double Energy(const std::vector<FVec>& X, const std::vector<FVec>& V) const
+		{
+			double Kinetic = 0.0;
+			for (int i = 0; i < 2; i++)
+			{
+				Kinetic += 0.5 * Masses[i] * (double(V[i].X) * V[i].X + double(V[i].Y) * V[i].Y + double(V[i].Z) * V[i].Z);
+			}
+			const double DX = double(X[1].X) - X[0].X, DY = double(X[1].Y) - X[0].Y, DZ = double(X[1].Z) - X[0].Z;
+			return Kinetic - double(Masses[0]) * Masses[1] / std::sqrt(DX * DX + DY * DY + DZ * DZ);
+		}
+	};
+
+	/**
+	 * Relative energy drift of each fixed-step integrator on a two-body orbit: semi-major axis 5000, 20 s period,
+	 * 100 orbits, circular and at e = 0.5, on 30 Hz substeps and on UGravityManager's default 120 Hz.
+	 */
+	bool BenchEnergyDrift()
+	{
+		const double Pi = 3.14159265358979;
+		const double SemiMajor = 5000.0;
+		const double Period = 20.0;
+		const int NumOrbits = 100;
+		const double TotalMass = 4.0 * Pi * Pi * SemiMajor * SemiMajor * SemiMajor / (Period * Period);
+
+		FTwoBody TwoBody;
+		TwoBody.Masses[0] = float(TotalMass * 0.99);
+		TwoBody.Masses[1] = float(TotalMass * 0.01);
+
+		const char* Methods[] = { "SemiImplicitEuler", "Leapfrog", "Yoshida4", "RK4" };
+		const int Rates[] = { 30, 120 };
+		const double Eccentricities[] = { 0.0, 0.5 };
+		std::printf("%-20s %4s %4s %14s %14s\n", "|dE/E|", "Hz", "e", "worst", "final");
+		bool bOrdered = true;
+		for (const int Rate : Rates)
+		{
+			const float H = 1.f / float(Rate);
+			const int NumSteps = int(NumOrbits * Period * Rate + 0.5);
+			for (const double E : Eccentricities)
+			{
+				// Start at apoapsis, both bodies about their common centre of mass.
+				const double Separation = SemiMajor * (1.0 + E);
+				const double Speed = std::sqrt(TotalMass * (1.0 - E) / Separation);
+				double Worst[4];
+				for (int Method = 0; Method < 4; Method++)
+				{
+					std::vector<FVec> X(2), V(2);
+					X[0] = FVec(float(-Separation * 0.01), 0.f, 0.f);
+					X[1] = FVec(float(Separation * 0.99), 0.f, 0.f);
+					V[0] = FVec(0.f, float(-Speed * 0.01), 0.f);
+					V[1] = FVec(0.f, float(Speed * 0.99), 0.f);
+
+					TIntegratorScratch<std::vector<FVec>> Scratch;
+					Scratch.Acc = Scratch.TrialX = Scratch.K1V = Scratch.K2X = Scratch.K2V = Scratch.K3X = Scratch.K3V = Scratch.K4V = std::vector<FVec>(2);
+
+					const double Energy0 = TwoBody.Energy(X, V);
+					double Drift = 0.0;
+					Worst[Method] = 0.0;
+					for (int Step = 0; Step < NumSteps; Step++)
+					{
+						switch (Method)
+						{
+						case 0: AdvanceSemiImplicitEuler(X, V, Scratch, 2, H, 1, TwoBody); break;
+						case 1: AdvanceLeapfrog(X, V, Scratch, 2, H, 1, TwoBody); break;
+						case 2: AdvanceYoshida4(X, V, Scratch, 2, H, 1, TwoBody); break;
+						default: AdvanceRK4(X, V, Scratch, 2, H, 1, TwoBody); break;
+						}
+						Drift = std::fabs(TwoBody.Energy(X, V) - Energy0) / std::fabs(Energy0);
+						Worst[Method] = std::max(Worst[Method], Drift);
+					}
+					std::printf("%-20s %4d %4.1f %14.2e %14.2e\n", Methods[Method], Rate, E, Worst[Method], Drift);
+				}
+
+				// On the eccentric orbit at 30 Hz truncation error is well above float rounding, and the
+				// methods should come out in order: 4th order under 2nd under 1st.
+				if (Rate == 30 && E > 0.0 && !(Worst[2] < Worst[1] && Worst[3] < Worst[1] && Worst[1] < Worst[0]))
+				{
+					std::printf("Energy drift at e = %.1f, %d Hz isn't in order of the methods' orders\n", E, Rate);
+					bOrdered = false;
+				}
+			}
+		}
+		return bOrdered;
+	}
+
+	struct FBench
+	{
+		const char* Name;
+		bool (*Run)();
+	};
+
+	bool BenchGravityLinear() { return BenchGravity(false); }
+	bool BenchGravityInverseSquare() { return BenchGravity(true); }
+}
+
+int main(int argc, char** argv)
+{
+	const FBench Benches[] =
+	{
+		{ "gravity-linear", &BenchGravityLinear },
+		{ "gravity-inverse-square", &BenchGravityInverseSquare },
+		{ "remove-vertical", &BenchRemoveVertical },
+		{ "fall-velocity", &BenchNewFallVelocity },
+		{ "walkable", &BenchIsWalkableNormal },
+		{ "glide", &BenchGlide },
+		{ "registry", &BenchRegistry },
+		{ "parallel-solve", &BenchParallelSolve },
+		{ "energy-drift", &BenchEnergyDrift },
+#if ORBITCORE_SIMD
+		{ "simd-linear", &BenchGravitySimdLinear },
+		{ "simd-inverse-square", &BenchGravitySimdInverseSquare },
+#endif
+	};
+	const char* Filter = argc > 1 ? argv[1] : "";
+
+	bool bPassed = true;
+	for (const FBench& Bench : Benches)
+	{
+		if (std::strstr(Bench.Name, Filter))
+		{
+			bPassed &= Bench.Run();
+		}
+	}
+	return bPassed ? 0 : 1;
+}
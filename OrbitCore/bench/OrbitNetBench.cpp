@@ -0,0 +1,444 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Bandwidth of replicating characters on planets, as two local processes. OrbitNetBench [characters] [seconds]
+// walks and hops characters around two planets at the server's 30 Hz net rate and sends every update
+// through a pipe to a second copy of itself (started with --receive), twice: as the engine's world space
+// FRepMovement would (4.7's packed vectors and byte rotator) and as OrbitCore::SerializeQuantized relative
+// to the planet, plus a byte for the planet reference. The receiver decodes both, checks them against the
+// truth sent alongside, and reports bits per update and bytes per second per character. It fails if the
+// relative encoding misses its precision.
+
+#include "OrbitCore/MovementMath.h"
+#include "OrbitCore/MovementQuantize.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#define popen _popen
+#define pclose _pclose
+#endif
+
+using namespace OrbitCore;
+
+namespace
+{
+	const float NetRate = 30.f;
+	const float Gravity = 980.f;
+	const int BodyReferenceBits = 8;	// the planet's NetGUID, packed; a level's first hundred-odd objects fit in a byte
+
+	/** Bits in and out the way the engine's FBitWriter and FBitReader do them, lowest first. */
+	class FBits
+	{
+	public:
+		FBits() : Pos(0), bLoading(false), bError(false) {}
+		FBits(const unsigned char* Data, int NumBits) : Bytes(Data, Data + (NumBits + 7) / 8), Pos(0), bLoading(true), bError(false) {}
+
+		bool IsLoading() const { return bLoading; }
+		bool IsError() const { return bError; }
+		int Num() const { return bLoading ? int(Bytes.size()) * 8 : Pos; }
+		const std::vector<unsigned char>& GetBytes() const { return Bytes; }
+
+		void SerializeBits(void* Value, int NumBits)
+		{
+			unsigned char* Data = static_cast<unsigned char*>(Value);
+			for (int i = 0; i < NumBits; i++, Pos++)
+			{
+				if (bLoading)
+				{
+					if (Pos >= int(Bytes.size()) * 8)
+					{
+						bError = true;
+						return;
+					}
+					const int Bit = (Bytes[Pos / 8] >> (Pos % 8)) & 1;
+					Data[i / 8] = (unsigned char)((Data[i / 8] & ~(1 << (i % 8))) | (Bit << (i % 8)));
+				}
+				else
+				{
+					if (Pos / 8 >= int(Bytes.size()))
+					{
+						Bytes.push_back(0);
+					}
+					Bytes[Pos / 8] |= (unsigned char)(((Data[i / 8] >> (i % 8)) & 1) << (Pos % 8));
+				}
+			}
+		}
+
+		/** FArchive::SerializeInt: Value in [0, Max), in as many bits as Max needs. */
+		void SerializeInt(uint32_t& Value, uint32_t Max)
+		{
+			int NumBits = 0;
+			while ((uint64_t(1) << NumBits) < Max)
+			{
+				NumBits++;
+			}
+			SerializeUInt(*this, Value, NumBits);
+		}
+
+	private:
+		std::vector<unsigned char> Bytes;
+		int Pos;
+		bool bLoading;
+		bool bError;
+	};
+
+	/** The engine's SerializePackedVector<Scale, MaxBits>, 4.7. */
+	void SerializePackedVector(FBits& Ar, FVec& Value, float Scale, uint32_t MaxBitsPerComponent)
+	{
+		int32_t X = RoundClamped(Value.X * Scale), Y = RoundClamped(Value.Y * Scale), Z = RoundClamped(Value.Z * Scale);
+		uint32_t Bits = 0;
+		if (!Ar.IsLoading())
+		{
+			const uint32_t Max = uint32_t(std::max(std::abs(X), std::max(std::abs(Y), std::abs(Z))));
+			uint32_t Log = 0;
+			while ((uint64_t(1) << Log) < uint64_t(Max) + 1)
+			{
+				Log++;
+			}
+			Bits = std::min(std::max(Log, 1u), MaxBitsPerComponent) - 1;
+		}
+		Ar.SerializeInt(Bits, MaxBitsPerComponent);
+		const int32_t Bias = 1 << (Bits + 1);
+		const uint32_t Max = 1u << (Bits + 2);
+		uint32_t DX = uint32_t(X + Bias), DY = uint32_t(Y + Bias), DZ = uint32_t(Z + Bias);
+		Ar.SerializeInt(DX, Max);
+		Ar.SerializeInt(DY, Max);
+		Ar.SerializeInt(DZ, Max);
+		Value = FVec(float(int32_t(DX) - Bias), float(int32_t(DY) - Bias), float(int32_t(DZ) - Bias)) * (1.f / Scale);
+	}
+
+	/** FRotator::SerializeCompressed: a byte per axis, and one bit for each that is zero. */
+	void SerializeCompressedRotator(FBits& Ar, float Rotator[3])
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			uint32_t Byte = uint32_t(RoundClamped(Rotator[i] * 256.f / 360.f) & 0xff);
+			uint32_t NonZero = Byte != 0 ? 1 : 0;
+			SerializeUInt(Ar, NonZero, 1);
+			if (NonZero)
+			{
+				SerializeUInt(Ar, Byte, 8);
+			}
+			else
+			{
+				Byte = 0;
+			}
+			Rotator[i] = float(Byte) * 360.f / 256.f;
+		}
+	}
+
+	/** FRepMovement::NetSerialize, 4.7, for a character: two flag bits, location, rotation, velocity. */
+	void SerializeRepMovement(FBits& Ar, FVec& Location, float Rotator[3], FVec& Velocity)
+	{
+		uint32_t Flags = 0;
+		SerializeUInt(Ar, Flags, 2);
+		SerializePackedVector(Ar, Location, 100.f, 30);
+		SerializeCompressedRotator(Ar, Rotator);
+		SerializePackedVector(Ar, Velocity, 1.f, 24);
+	}
+
+	const float RadToDeg = 57.2957795f;
+
+	/** Pitch, yaw and roll of the frame with these X and Z axes, as FMatrix::Rotator. */
+	void FrameToRotator(const FVec& Forward, const FVec& Up, float Rotator[3])
+	{
+		const FVec Right = Cross(Up, Forward);
+		const float Pitch = std::atan2(Forward.Z, std::sqrt(Forward.X * Forward.X + Forward.Y * Forward.Y));
+		const float Yaw = std::atan2(Forward.Y, Forward.X);
+		const FVec YawRight(-std::sin(Yaw), std::cos(Yaw), 0.f);
+		Rotator[0] = Pitch * RadToDeg;
+		Rotator[1] = Yaw * RadToDeg;
+		Rotator[2] = std::atan2(Dot(Up, YawRight), Dot(Right, YawRight)) * RadToDeg;
+	}
+
+	void RotatorToFrame(const float Rotator[3], FVec& OutForward, FVec& OutUp)
+	{
+		const float SP = std::sin(Rotator[0] / RadToDeg), CP = std::cos(Rotator[0] / RadToDeg);
+		const float SY = std::sin(Rotator[1] / RadToDeg), CY = std::cos(Rotator[1] / RadToDeg);
+		const float SR = std::sin(Rotator[2] / RadToDeg), CR = std::cos(Rotator[2] / RadToDeg);
+		OutForward = FVec(CP * CY, CP * SY, SP);
+		OutUp = FVec(-(CR * SP * CY + SR * SY), CY * SR - CR * SP * SY, CR * CP);
+	}
+
+	float AngleBetween(const FVec& A, const FVec& B)
+	{
+		const float Cos = Dot(SafeNormal(A), SafeNormal(B));
+		return std::acos(Cos > 1.f ? 1.f : Cos < -1.f ? -1.f : Cos) * RadToDeg;
+	}
+
+	/** What goes down the pipe for each character each update; only the packets count as bandwidth. */
+	struct FTruth
+	{
+		FVec Center, Location, Velocity, Forward, Up;
+	};
+
+	bool Write(FILE* Pipe, const void* Data, size_t Size)
+	{
+		return std::fwrite(Data, 1, Size, Pipe) == Size;
+	}
+
+	bool Read(FILE* Pipe, void* Data, size_t Size)
+	{
+		return std::fread(Data, 1, Size, Pipe) == Size;
+	}
+
+	bool WritePacket(FILE* Pipe, const FBits& Bits)
+	{
+		const uint16_t NumBits = uint16_t(Bits.Num());
+		return Write(Pipe, &NumBits, sizeof(NumBits)) && (Bits.GetBytes().empty() || Write(Pipe, Bits.GetBytes().data(), Bits.GetBytes().size()));
+	}
+
+	bool ReadPacket(FILE* Pipe, std::vector<unsigned char>& Bytes, int& OutNumBits)
+	{
+		uint16_t NumBits = 0;
+		if (!Read(Pipe, &NumBits, sizeof(NumBits)))
+		{
+			return false;
+		}
+		Bytes.resize((NumBits + 7) / 8);
+		OutNumBits = NumBits;
+		return Bytes.empty() || Read(Pipe, Bytes.data(), Bytes.size());
+	}
+
+	int Send(const char* Self, int NumCharacters, float Seconds)
+	{
+		const std::string Command = std::string("\"") + Self + "\" --receive";
+#ifdef _WIN32
+		FILE* Pipe = popen(Command.c_str(), "wb");
+#else
+		FILE* Pipe = popen(Command.c_str(), "w");
+#endif
+		if (!Pipe)
+		{
+			std::printf("Couldn't start the receiver: %s\n", Command.c_str());
+			return 1;
+		}
+
+		// Two planets, a small one near the origin and a big one far out, where world coordinates need more bits.
+		const FVec PlanetCenters[2] = { FVec(0.f, 0.f, 0.f), FVec(60000.f, -20000.f, 8000.f) };
+		const float PlanetRadii[2] = { 1000.f, 8000.f };
+		const float HalfHeight = 90.f;
+
+		std::mt19937 Random(1234);
+		std::uniform_real_distribution<float> Unit(-1.f, 1.f);
+		std::vector<FVec> Locations(NumCharacters), Velocities(NumCharacters), Accelerations(NumCharacters), Centers(NumCharacters), Forwards(NumCharacters);
+		std::vector<float> Heights(NumCharacters), Hops(NumCharacters, 0.f), HopVelocities(NumCharacters, 0.f);
+		std::vector<FWalkParams> Params(NumCharacters);
+		for (int i = 0; i < NumCharacters; i++)
+		{
+			const int Planet = i % 2;
+			FVec Up;
+			do
+			{
+				Up = FVec(Unit(Random), Unit(Random), Unit(Random));
+			} while (Up.SizeSquared() < 0.01f || Up.SizeSquared() > 1.f);
+			Up = SafeNormal(Up);
+			Centers[i] = PlanetCenters[Planet];
+			Heights[i] = PlanetRadii[Planet] + HalfHeight;
+			Locations[i] = Centers[i] + Up * Heights[i];
+			FVec TangentX, TangentY;
+			TangentBasis(Up, TangentX, TangentY);
+			Forwards[i] = TangentX;
+			Params[i].MaxSpeed = 600.f;
+			Params[i].Friction = 8.f;
+			Params[i].BrakingFriction = 8.f;
+			Params[i].BrakingDeceleration = 2048.f;
+		}
+
+		const float DeltaTime = 1.f / NetRate;
+		const int NumUpdates = int(Seconds * NetRate);
+		bool bWritten = true;
+		for (int Update = 0; Update < NumUpdates && bWritten; Update++)
+		{
+			// Steer now and then, stop some of the time, hop now and then.
+			for (int i = 0; i < NumCharacters; i++)
+			{
+				const FVec Up = SafeNormal(Locations[i] - Centers[i]);
+				if (Update % 45 == i % 45)
+				{
+					const FVec Wish = RemoveVertical(FVec(Unit(Random), Unit(Random), Unit(Random)), Up);
+					Accelerations[i] = Unit(Random) < -0.6f ? FVec() : SafeNormal(Wish) * 2048.f;
+				}
+				else
+				{
+					Accelerations[i] = RemoveVertical(Accelerations[i], Up);
+				}
+				if (Hops[i] <= 0.f && Unit(Random) > 0.98f)
+				{
+					HopVelocities[i] = 420.f;
+				}
+			}
+			GlideBatch(NumCharacters, Locations.data(), Velocities.data(), Accelerations.data(), Centers.data(), Heights.data(), Params.data(), DeltaTime);
+
+			const uint32_t Num = uint32_t(NumCharacters);
+			bWritten &= Write(Pipe, &Num, sizeof(Num));
+			for (int i = 0; i < NumCharacters && bWritten; i++)
+			{
+				const FVec Up = SafeNormal(Locations[i] - Centers[i]);
+				if (HopVelocities[i] != 0.f || Hops[i] > 0.f)
+				{
+					Hops[i] += HopVelocities[i] * DeltaTime;
+					HopVelocities[i] -= Gravity * DeltaTime;
+					if (Hops[i] <= 0.f)
+					{
+						Hops[i] = 0.f;
+						HopVelocities[i] = 0.f;
+					}
+				}
+				if (Velocities[i].SizeSquared() > 1.f)
+				{
+					Forwards[i] = SafeNormal(Velocities[i]);
+				}
+				Forwards[i] = SafeNormal(RemoveVertical(Forwards[i], Up));
+
+				FTruth Truth;
+				Truth.Center = Centers[i];
+				Truth.Location = Locations[i] + Up * Hops[i];
+				Truth.Velocity = Velocities[i] + Up * HopVelocities[i];
+				Truth.Forward = Forwards[i];
+				Truth.Up = Up;
+
+				FBits World;
+				FVec WorldLocation = Truth.Location, WorldVelocity = Truth.Velocity;
+				float Rotator[3];
+				FrameToRotator(Truth.Forward, Truth.Up, Rotator);
+				SerializeRepMovement(World, WorldLocation, Rotator, WorldVelocity);
+
+				FBits Relative;
+				FQuantizedMovement Q = QuantizeRelative(Truth.Center, Truth.Location, Truth.Velocity, Truth.Forward);
+				SerializeQuantized(Relative, Q);
+
+				bWritten &= Write(Pipe, &Truth, sizeof(Truth)) && WritePacket(Pipe, World) && WritePacket(Pipe, Relative);
+			}
+		}
+		const uint32_t End = 0;
+		bWritten &= Write(Pipe, &End, sizeof(End));
+
+		const int Status = pclose(Pipe);
+		if (!bWritten)
+		{
+			std::printf("The receiver went away\n");
+			return 1;
+		}
+		return Status == 0 ? 0 : 1;
+	}
+
+	struct FStats
+	{
+		double Bits;
+		float MaxLocationError, MaxVelocityError, MaxForwardError;
+
+		FStats() : Bits(0.0), MaxLocationError(0.f), MaxVelocityError(0.f), MaxForwardError(0.f) {}
+
+		void Add(int NumBits, const FTruth& Truth, const FVec& Location, const FVec& Velocity, const FVec& Forward)
+		{
+			Bits += NumBits;
+			MaxLocationError = std::max(MaxLocationError, (Location - Truth.Location).Size());
+			MaxVelocityError = std::max(MaxVelocityError, (Velocity - Truth.Velocity).Size());
+			MaxForwardError = std::max(MaxForwardError, AngleBetween(Forward, Truth.Forward));
+		}
+
+		void Print(const char* Name, double Updates, double CharacterSeconds) const
+		{
+			std::printf("%-22s %7.1f bits/update %8.1f bytes/s/character   max error %.3f uu, %.2f uu/s, %.2f deg\n",
+				Name, Bits / Updates, Bits / 8.0 / CharacterSeconds, MaxLocationError, MaxVelocityError, MaxForwardError);
+		}
+	};
+
+	int Receive()
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+		FStats World, Relative;
+		double Updates = 0.0, Frames = 0.0, Characters = 0.0;
+		std::vector<unsigned char> Bytes;
+		for (;;)
+		{
+			uint32_t Num = 0;
+			if (!Read(stdin, &Num, sizeof(Num)))
+			{
+				std::printf("The sender went away\n");
+				return 1;
+			}
+			if (Num == 0)
+			{
+				break;
+			}
+			Frames += 1.0;
+			Characters = Num;
+			for (uint32_t i = 0; i < Num; i++)
+			{
+				FTruth Truth;
+				int NumBits = 0;
+				if (!Read(stdin, &Truth, sizeof(Truth)) || !ReadPacket(stdin, Bytes, NumBits))
+				{
+					std::printf("Short read\n");
+					return 1;
+				}
+				{
+					FBits Ar(Bytes.data(), NumBits);
+					FVec Location, Velocity, Forward, Up;
+					float Rotator[3] = { 0.f, 0.f, 0.f };
+					SerializeRepMovement(Ar, Location, Rotator, Velocity);
+					RotatorToFrame(Rotator, Forward, Up);
+					World.Add(NumBits, Truth, Location, Velocity, Forward);
+				}
+
+				if (!ReadPacket(stdin, Bytes, NumBits))
+				{
+					std::printf("Short read\n");
+					return 1;
+				}
+				{
+					FBits Ar(Bytes.data(), NumBits);
+					FQuantizedMovement Q;
+					SerializeQuantized(Ar, Q);
+					FVec Location, Velocity, Forward, Up;
+					DequantizeRelative(Q, Truth.Center, Location, Velocity, Up, Forward);
+					if (Ar.IsError())
+					{
+						std::printf("Relative packet was short\n");
+						return 1;
+					}
+					Relative.Add(NumBits + BodyReferenceBits, Truth, Location, Velocity, Forward);
+				}
+				Updates += 1.0;
+			}
+		}
+
+		const double CharacterSeconds = Characters * Frames / NetRate;
+		std::printf("%.0f characters, %.0f updates at %.0f Hz\n", Characters, Updates, NetRate);
+		World.Print("FRepMovement", Updates, CharacterSeconds);
+		Relative.Print("Gravity relative", Updates, CharacterSeconds);
+		std::printf("%-22s %7.1f%%\n", "Saved", 100.0 * (1.0 - Relative.Bits / World.Bits));
+
+		// A tenth of a unit, rounding of each velocity component, and the heading's step plus the float error of rebuilding the basis.
+		if (Relative.MaxLocationError > 0.15f || Relative.MaxVelocityError > 1.f || Relative.MaxForwardError > 0.1f)
+		{
+			std::printf("The gravity relative encoding missed its precision\n");
+			return 1;
+		}
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::strcmp(argv[1], "--receive") == 0)
+	{
+		return Receive();
+	}
+	const int NumCharacters = argc > 1 ? std::max(1, std::atoi(argv[1])) : 256;
+	const float Seconds = argc > 2 ? float(std::atof(argv[2])) : 10.f;
+	std::fflush(stdout);
+	return Send(argv[0], NumCharacters, Seconds);
+}
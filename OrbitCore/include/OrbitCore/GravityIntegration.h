@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "OrbitCore/OrbitVector.h"
+
+namespace OrbitCore
+{
+	/**
+	 * The fixed-substep integrators behind FGravityIntegrator::Advance, written against any array of
+	 * vectors that indexes with [] (TArray<FVector> in the engine, std::vector<FVec> in OrbitCoreBench).
+	 * GetAccelerations(Positions, OutAccelerations) fills one acceleration per body; every array holds
+	 * Num bodies and the caller sizes them, scratch included.
+	 */
+	template<typename TVectorArray>
+	struct TIntegratorScratch
+	{
+		TVectorArray Acc;
+		TVectorArray TrialX;
+		TVectorArray K1V, K2X, K2V, K3X, K3V, K4V;
+	};
+
+	template<typename TVectorArray>
+	inline void Drift(TVectorArray& X, const TVectorArray& V, int Num, float H)
+	{
+		for (int i = 0; i < Num; i++)
+		{
+			X[i] += V[i] * H;
+		}
+	}
+
+	template<typename TVectorArray>
+	inline void Kick(TVectorArray& V, const TVectorArray& A, int Num, float H)
+	{
+		for (int i = 0; i < Num; i++)
+		{
+			V[i] += A[i] * H;
+		}
+	}
+
+	template<typename TVectorArray, typename TGetAccelerations>
+	void AdvanceSemiImplicitEuler(TVectorArray& X, TVectorArray& V, TIntegratorScratch<TVectorArray>& Scratch, int Num, float H, int NumSteps, TGetAccelerations& GetAccelerations)
+	{
+		for (int Step = 0; Step < NumSteps; Step++)
+		{
+			GetAccelerations(X, Scratch.Acc);
+			Kick(V, Scratch.Acc, Num, H);
+			Drift(X, V, Num, H);
+		}
+	}
+
+	// Kick-drift-kick. The closing kick's acceleration is the next opening kick's, so it costs one
+	// evaluation per substep plus one to start.
+	template<typename TVectorArray, typename TGetAccelerations>
+	void AdvanceLeapfrog(TVectorArray& X, TVectorArray& V, TIntegratorScratch<TVectorArray>& Scratch, int Num, float H, int NumSteps, TGetAccelerations& GetAccelerations)
+	{
+		const float HalfH = 0.5f * H;
+		GetAccelerations(X, Scratch.Acc);
+		for (int Step = 0; Step < NumSteps; Step++)
+		{
+			Kick(V, Scratch.Acc, Num, HalfH);
+			Drift(X, V, Num, H);
+			GetAccelerations(X, Scratch.Acc);
+			Kick(V, Scratch.Acc, Num, HalfH);
+		}
+	}
+
+	// Drift-kick form of Yoshida (1990): three leapfrogs of h*w1, h*w0, h*w1 fused together.
+	template<typename TVectorArray, typename TGetAccelerations>
+	void AdvanceYoshida4(TVectorArray& X, TVectorArray& V, TIntegratorScratch<TVectorArray>& Scratch, int Num, float H, int NumSteps, TGetAccelerations& GetAccelerations)
+	{
+		const double CubeRoot2 = 1.2599210498948732;
+		const double W1 = 1.0 / (2.0 - CubeRoot2);
+		const double W0 = -CubeRoot2 / (2.0 - CubeRoot2);
+		const float C1 = (float)(0.5 * W1) * H;
+		const float C2 = (float)(0.5 * (W0 + W1)) * H;
+		const float D1 = (float)W1 * H;
+		const float D2 = (float)W0 * H;
+
+		for (int Step = 0; Step < NumSteps; Step++)
+		{
+			Drift(X, V, Num, C1);
+			GetAccelerations(X, Scratch.Acc);
+			Kick(V, Scratch.Acc, Num, D1);
+			Drift(X, V, Num, C2);
+			GetAccelerations(X, Scratch.Acc);
+			Kick(V, Scratch.Acc, Num, D2);
+			Drift(X, V, Num, C2);
+			GetAccelerations(X, Scratch.Acc);
+			Kick(V, Scratch.Acc, Num, D1);
+			Drift(X, V, Num, C1);
+		}
+	}
+
+	template<typename TVectorArray, typename TGetAccelerations>
+	void AdvanceRK4(TVectorArray& X, TVectorArray& V, TIntegratorScratch<TVectorArray>& Scratch, int Num, float H, int NumSteps, TGetAccelerations& GetAccelerations)
+	{
+		const float HalfH = 0.5f * H;
+		const float SixthH = H / 6.f;
+		TVectorArray& TrialX = Scratch.TrialX;
+		TVectorArray& K1V = Scratch.K1V;
+		TVectorArray& K2X = Scratch.K2X;
+		TVectorArray& K2V = Scratch.K2V;
+		TVectorArray& K3X = Scratch.K3X;
+		TVectorArray& K3V = Scratch.K3V;
+		TVectorArray& K4V = Scratch.K4V;
+
+		for (int Step = 0; Step < NumSteps; Step++)
+		{
+			// K1X is just V
+			GetAccelerations(X, K1V);
+
+			for (int i = 0; i < Num; i++)
+			{
+				K2X[i] = V[i] + K1V[i] * HalfH;
+				TrialX[i] = X[i] + V[i] * HalfH;
+			}
+			GetAccelerations(TrialX, K2V);
+
+			for (int i = 0; i < Num; i++)
+			{
+				K3X[i] = V[i] + K2V[i] * HalfH;
+				TrialX[i] = X[i] + K2X[i] * HalfH;
+			}
+			GetAccelerations(TrialX, K3V);
+
+			for (int i = 0; i < Num; i++)
+			{
+				TrialX[i] = X[i] + K3X[i] * H;
+			}
+			GetAccelerations(TrialX, K4V);
+
+			for (int i = 0; i < Num; i++)
+			{
+				X[i] += (V[i] + K2X[i] * 2.f + K3X[i] * 2.f + (V[i] + K3V[i] * H)) * SixthH;
+				V[i] += (K1V[i] + K2V[i] * 2.f + K3V[i] * 2.f + K4V[i]) * SixthH;
+			}
+		}
+	}
+}
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "OrbitCore/OrbitVector.h"
+
+namespace OrbitCore
+{
+	/**
+	 * The pairwise gravity term behind UGravityManager::ApplyGravity: Mass * D / (|D|^2 + SofteningSq)
+	 * with D from Point to the source, or Mass * D / (|D|^2 + SofteningSq)^(3/2) with bInverseSquare.
+	 * InOutMagnitude gets Mass / (|D|^2 + SofteningSq). Closer than SmallNumber (a body and itself)
+	 * adds nothing.
+	 */
+	inline void AccumulatePair(const FVec& Point, const FVec& SourcePosition, float SourceMass, float SofteningSq, bool bInverseSquare, FVec& InOutField, float& InOutMagnitude)
+	{
+		const FVec Delta = SourcePosition - Point;
+		const float DistSq = Delta.SizeSquared();
+		if (DistSq > SmallNumber)
+		{
+			const float SoftDistSq = DistSq + SofteningSq;
+			const float MagnitudeTerm = SourceMass / SoftDistSq;
+			InOutField += Delta * (bInverseSquare ? MagnitudeTerm / std::sqrt(SoftDistSq) : MagnitudeTerm);
+			InOutMagnitude += MagnitudeTerm;
+		}
+	}
+
+	/** AccumulateSource for one falloff, so the loop body has no branches left to vectorize around. */
+	template<bool bInverseSquare>
+	inline void AccumulateSourceFalloff(const float* ORBITCORE_RESTRICT PX, const float* ORBITCORE_RESTRICT PY, const float* ORBITCORE_RESTRICT PZ, float* ORBITCORE_RESTRICT FX, float* ORBITCORE_RESTRICT FY, float* ORBITCORE_RESTRICT FZ, float* ORBITCORE_RESTRICT FM, int Begin, int End, const FVec& SourcePosition, float SourceMass, float SofteningSq)
+	{
+		for (int i = Begin; i < End; i++)
+		{
+			const float DX = SourcePosition.X - PX[i];
+			const float DY = SourcePosition.Y - PY[i];
+			const float DZ = SourcePosition.Z - PZ[i];
+			const float DistSq = DX * DX + DY * DY + DZ * DZ;
+			// Selects rather than a skipped divide: a body pulling on itself divides by something harmless and adds zero.
+			const bool bKeep = DistSq > SmallNumber;
+			const float SoftDistSq = (bKeep ? DistSq : 1.f) + SofteningSq;
+			const float MagnitudeTerm = (bKeep ? SourceMass : 0.f) / SoftDistSq;
+			const float Term = bInverseSquare ? MagnitudeTerm / std::sqrt(SoftDistSq) : MagnitudeTerm;
+			FX[i] += DX * Term;
+			FY[i] += DY * Term;
+			FZ[i] += DZ * Term;
+			FM[i] += MagnitudeTerm;
+		}
+	}
+
+	/**
+	 * AccumulatePair from one source into receivers [Begin, End) held as separate coordinate arrays,
+	 * the layout of FGravityReceiverBatch. The arrays must not overlap. Written so compilers can
+	 * vectorize it (GCC needs -fno-math-errno and -fno-trapping-math before it will, which
+	 * CMakeLists.txt passes on); AccumulateSourceSimd in GravitySimd.h is the hand-written one.
+	 */
+	inline void AccumulateSource(const float* PX, const float* PY, const float* PZ, float* FX, float* FY, float* FZ, float* FM, int Begin, int End, const FVec& SourcePosition, float SourceMass, float SofteningSq, bool bInverseSquare)
+	{
+		if (bInverseSquare)
+		{
+			AccumulateSourceFalloff<true>(PX, PY, PZ, FX, FY, FZ, FM, Begin, End, SourcePosition, SourceMass, SofteningSq);
+		}
+		else
+		{
+			AccumulateSourceFalloff<false>(PX, PY, PZ, FX, FY, FZ, FM, Begin, End, SourcePosition, SourceMass, SofteningSq);
+		}
+	}
+
+	/**
+	 * One point mass's pull, the MoonWalker movement component's gravity: Mass * BodyMass / |D|^2 with
+	 * no softening. Nothing at the center itself instead of a divide by zero.
+	 */
+	inline float PointMassMagnitude(const FVec& Point, const FVec& Center, float BodyMass, float Mass)
+	{
+		const float DistSq = (Center - Point).SizeSquared();
+		return DistSq > SmallNumber ? Mass * BodyMass / DistSq : 0.f;
+	}
+
+	/** Toward Center, zero at it. */
+	inline FVec PointMassDirection(const FVec& Point, const FVec& Center)
+	{
+		return SafeNormal(Center - Point);
+	}
+
+	/** Which way a summed field pulls, zero if it doesn't. */
+	inline FVec GravityDirection(const FVec& Field)
+	{
+		return SafeNormal(Field);
+	}
+}
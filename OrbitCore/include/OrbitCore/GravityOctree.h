@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "OrbitCore/GravityMath.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace OrbitCore
+{
+	/**
+	 * Barnes-Hut octree of gravitational sources, behind the engine's FGravityOctree (see GravityOctree.h
+	 * in the Orbit module for how the game uses it). A cell whose size over distance is below Theta is
+	 * treated as a single mass at its centre of mass; Theta = 0 opens every cell and gives the direct
+	 * sum of AccumulatePair, up to rounding since the leaves are added in tree order.
+	 */
+	class FGravityOctree
+	{
+	public:
+		FGravityOctree() : Root(-1) {}
+
+		/** Throws away the previous tree and builds a new one from Num bodies. Bodies without mass are left out. */
+		void Build(const FVec* Positions, const float* Masses, int Num)
+		{
+			Reset();
+
+			bool bAny = false;
+			FVec Min, Max;
+			for (int i = 0; i < Num; i++)
+			{
+				if (Masses[i] > 0.f)
+				{
+					const FVec& P = Positions[i];
+					if (!bAny)
+					{
+						Min = Max = P;
+						bAny = true;
+					}
+					Min = FVec(std::fmin(Min.X, P.X), std::fmin(Min.Y, P.Y), std::fmin(Min.Z, P.Z));
+					Max = FVec(std::fmax(Max.X, P.X), std::fmax(Max.Y, P.Y), std::fmax(Max.Z, P.Z));
+				}
+			}
+			if (!bAny)
+			{
+				return;
+			}
+
+			// Cubic root cell, padded so bodies on the max face still land inside.
+			const FVec Extent = (Max - Min) * 0.5f;
+			const float HalfSize = std::fmax(Extent.X, std::fmax(Extent.Y, Extent.Z)) + 1.f;
+			Root = AllocNode((Min + Max) * 0.5f, HalfSize);
+
+			BodyPositions.reserve(Num);
+			BodyMasses.reserve(Num);
+			for (int i = 0; i < Num; i++)
+			{
+				if (Masses[i] > 0.f)
+				{
+					const int BodyIndex = (int)BodyPositions.size();
+					BodyPositions.push_back(Positions[i]);
+					BodyMasses.push_back(Masses[i]);
+					Insert(Root, Positions[i], Masses[i], BodyIndex, 0);
+				}
+			}
+
+			// Insert accumulated Mass * Position; turn that into the centre of mass. Leaves take their body's
+			// position as is: Mass * Position / Mass is off by a rounding error far bigger than SmallNumber out
+			// in the field, and a receiver on that body would then feel itself. Bodies merged at MaxDepth are
+			// within a cell that small of each other anyway.
+			for (FNode& Node : Nodes)
+			{
+				if (Node.Body != -1)
+				{
+					Node.CenterOfMass = BodyPositions[Node.Body];
+				}
+				else if (Node.Mass > 0.f)
+				{
+					Node.CenterOfMass = Node.CenterOfMass * (1.f / Node.Mass);
+				}
+			}
+		}
+
+		/**
+		 * Summed field of all sources at Point, the AccumulatePair terms of every cell that is far enough
+		 * away or a leaf. Sources sitting on Point are skipped. OutMagnitude, if given, receives the summed
+		 * Mass / |D|^2 terms.
+		 */
+		FVec GetField(const FVec& Point, float Theta, float* OutMagnitude = NULL, float SofteningSq = 0.f, bool bInverseSquare = false) const
+		{
+			FVec Field;
+			float Magnitude = 0.f;
+
+			const float ThetaSq = Theta * Theta;
+			// Each pop pushes at most 8, one level down, so the stack never holds more than this.
+			int Stack[8 * MaxDepth + 8];
+			int StackSize = 0;
+			if (Root != -1)
+			{
+				Stack[StackSize++] = Root;
+			}
+
+			while (StackSize > 0)
+			{
+				const FNode& Node = Nodes[Stack[--StackSize]];
+				const float DistSq = (Node.CenterOfMass - Point).SizeSquared();
+				const float Size = 2.f * Node.HalfSize;
+
+				if (Node.bLeaf || Size * Size < ThetaSq * DistSq)
+				{
+					AccumulatePair(Point, Node.CenterOfMass, Node.Mass, SofteningSq, bInverseSquare, Field, Magnitude);
+					continue;
+				}
+
+				for (int i = 0; i < 8; i++)
+				{
+					if (Node.Children[i] != -1)
+					{
+						Stack[StackSize++] = Node.Children[i];
+					}
+				}
+			}
+
+			if (OutMagnitude)
+			{
+				*OutMagnitude = Magnitude;
+			}
+			return Field;
+		}
+
+		void Reset()
+		{
+			Nodes.clear();
+			BodyPositions.clear();
+			BodyMasses.clear();
+			Root = -1;
+		}
+
+		bool IsEmpty() const { return Root == -1; }
+		int GetNumNodes() const { return (int)Nodes.size(); }
+
+		/** Stop subdividing past this depth; coincident bodies are merged into one leaf. */
+		static const int MaxDepth = 24;
+
+	private:
+		struct FNode
+		{
+			FVec Center;
+			float HalfSize;
+			FVec CenterOfMass;	// sum of Mass * Position while building, divided out at the end (the body itself in leaves)
+			float Mass;
+			int Body;			// first body in a leaf, -1 for empty leaves and interior nodes
+			int Children[8];	// -1 when absent
+			bool bLeaf;
+		};
+
+		int AllocNode(const FVec& Center, float HalfSize)
+		{
+			FNode Node;
+			Node.Center = Center;
+			Node.HalfSize = HalfSize;
+			Node.Mass = 0.f;
+			Node.Body = -1;
+			for (int i = 0; i < 8; i++)
+			{
+				Node.Children[i] = -1;
+			}
+			Node.bLeaf = true;
+			Nodes.push_back(Node);
+			return (int)Nodes.size() - 1;
+		}
+
+		static int GetOctant(const FNode& Node, const FVec& Position)
+		{
+			return (Position.X >= Node.Center.X ? 1 : 0)
+				| (Position.Y >= Node.Center.Y ? 2 : 0)
+				| (Position.Z >= Node.Center.Z ? 4 : 0);
+		}
+
+		void Insert(int NodeIndex, const FVec& Position, float Mass, int BodyIndex, int Depth)
+		{
+			{
+				FNode& Node = Nodes[NodeIndex];
+				Node.Mass += Mass;
+				Node.CenterOfMass += Position * Mass;
+
+				if (Node.bLeaf)
+				{
+					if (Node.Body == -1)
+					{
+						Node.Body = BodyIndex;
+						return;
+					}
+					if (Depth >= MaxDepth)
+					{
+						// Coincident (or near enough) bodies, keep them merged in this leaf.
+						return;
+					}
+
+					// Split: the body already here moves down a level before the new one does.
+					const int Existing = Node.Body;
+					Node.Body = -1;
+					Node.bLeaf = false;
+					InsertIntoChild(NodeIndex, BodyPositions[Existing], BodyMasses[Existing], Existing, Depth);
+				}
+			}
+			InsertIntoChild(NodeIndex, Position, Mass, BodyIndex, Depth);
+		}
+
+		void InsertIntoChild(int NodeIndex, const FVec& Position, float Mass, int BodyIndex, int Depth)
+		{
+			const int Octant = GetOctant(Nodes[NodeIndex], Position);
+			int Child = Nodes[NodeIndex].Children[Octant];
+			if (Child == -1)
+			{
+				const float ChildHalf = Nodes[NodeIndex].HalfSize * 0.5f;
+				const FVec ChildCenter = Nodes[NodeIndex].Center + FVec(
+					(Octant & 1) ? ChildHalf : -ChildHalf,
+					(Octant & 2) ? ChildHalf : -ChildHalf,
+					(Octant & 4) ? ChildHalf : -ChildHalf);
+				Child = AllocNode(ChildCenter, ChildHalf);//may reallocate Nodes, don't hold references across this
+				Nodes[NodeIndex].Children[Octant] = Child;
+			}
+			Insert(Child, Position, Mass, BodyIndex, Depth + 1);
+		}
+
+		std::vector<FNode> Nodes;
+		std::vector<FVec> BodyPositions;
+		std::vector<float> BodyMasses;
+		int Root;
+	};
+}
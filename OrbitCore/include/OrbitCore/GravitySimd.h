@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "OrbitCore/GravityMath.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define ORBITCORE_SIMD 1
+#else
+#define ORBITCORE_SIMD 0
+#endif
+
+namespace OrbitCore
+{
+#if ORBITCORE_SIMD
+	// Hardware estimate plus two Newton-Raphson steps, what VectorReciprocalAccurate and
+	// VectorReciprocalSqrtAccurate do on PC.
+	inline __m128 ReciprocalAccurate(__m128 Vec)
+	{
+		const __m128 X0 = _mm_rcp_ps(Vec);
+		const __m128 X1 = _mm_sub_ps(_mm_add_ps(X0, X0), _mm_mul_ps(Vec, _mm_mul_ps(X0, X0)));
+		return _mm_sub_ps(_mm_add_ps(X1, X1), _mm_mul_ps(Vec, _mm_mul_ps(X1, X1)));
+	}
+
+	inline __m128 ReciprocalSqrtAccurate(__m128 Vec)
+	{
+		const __m128 OneHalf = _mm_set1_ps(0.5f);
+		const __m128 VecDivBy2 = _mm_mul_ps(Vec, OneHalf);
+		const __m128 X0 = _mm_rsqrt_ps(Vec);
+		const __m128 X1 = _mm_add_ps(_mm_mul_ps(X0, _mm_sub_ps(OneHalf, _mm_mul_ps(VecDivBy2, _mm_mul_ps(X0, X0)))), X0);
+		return _mm_add_ps(_mm_mul_ps(X1, _mm_sub_ps(OneHalf, _mm_mul_ps(VecDivBy2, _mm_mul_ps(X1, X1)))), X1);
+	}
+
+	// Each register holds one coordinate of four receivers. Linear only needs 1/|D|^2, InverseSquare
+	// gets 1/|D| from the reciprocal square root instead.
+	template<bool bInverseSquare>
+	inline void AccumulateSourceSimdFalloff(const float* PX, const float* PY, const float* PZ, float* FX, float* FY, float* FZ, float* FM, int Begin, int End, const FVec& SourcePosition, float SourceMass, float SofteningSq)
+	{
+		const __m128 SX = _mm_set1_ps(SourcePosition.X);
+		const __m128 SY = _mm_set1_ps(SourcePosition.Y);
+		const __m128 SZ = _mm_set1_ps(SourcePosition.Z);
+		const __m128 Mass = _mm_set1_ps(SourceMass);
+		const __m128 Soft = _mm_set1_ps(SofteningSq);
+		const __m128 Small = _mm_set1_ps(SmallNumber);
+
+		for (int i = Begin; i < End; i += 4)
+		{
+			const __m128 DX = _mm_sub_ps(SX, _mm_loadu_ps(PX + i));
+			const __m128 DY = _mm_sub_ps(SY, _mm_loadu_ps(PY + i));
+			const __m128 DZ = _mm_sub_ps(SZ, _mm_loadu_ps(PZ + i));
+			const __m128 DistSq = _mm_add_ps(_mm_mul_ps(DZ, DZ), _mm_add_ps(_mm_mul_ps(DY, DY), _mm_mul_ps(DX, DX)));
+			const __m128 SoftDistSq = _mm_add_ps(DistSq, Soft);
+
+			// Lanes at the source itself would be inf (or NaN) here; the mask zeroes them bitwise.
+			const __m128 Keep = _mm_cmpgt_ps(DistSq, Small);
+			__m128 MagnitudeTerm, Term;
+			if (bInverseSquare)
+			{
+				const __m128 InvDist = _mm_and_ps(ReciprocalSqrtAccurate(SoftDistSq), Keep);//mask before inf * 0 can make a NaN
+				MagnitudeTerm = _mm_mul_ps(Mass, _mm_mul_ps(InvDist, InvDist));
+				Term = _mm_mul_ps(MagnitudeTerm, InvDist);
+			}
+			else
+			{
+				MagnitudeTerm = _mm_and_ps(_mm_mul_ps(Mass, ReciprocalAccurate(SoftDistSq)), Keep);
+				Term = MagnitudeTerm;
+			}
+
+			_mm_storeu_ps(FX + i, _mm_add_ps(_mm_mul_ps(DX, Term), _mm_loadu_ps(FX + i)));
+			_mm_storeu_ps(FY + i, _mm_add_ps(_mm_mul_ps(DY, Term), _mm_loadu_ps(FY + i)));
+			_mm_storeu_ps(FZ + i, _mm_add_ps(_mm_mul_ps(DZ, Term), _mm_loadu_ps(FZ + i)));
+			_mm_storeu_ps(FM + i, _mm_add_ps(MagnitudeTerm, _mm_loadu_ps(FM + i)));
+		}
+	}
+#endif
+
+	/**
+	 * AccumulateSource four receivers at a time with SSE, behind FGravityKernel::AccumulateSourceSimd.
+	 * Begin and End must be multiples of 4 and the arrays padded to End. Not faster than AccumulateSource
+	 * where the compiler vectorizes that itself (GCC and Clang do; OrbitCoreBench simd-* compares them).
+	 * Falls back to AccumulateSource without SSE2.
+	 */
+	inline void AccumulateSourceSimd(const float* PX, const float* PY, const float* PZ, float* FX, float* FY, float* FZ, float* FM, int Begin, int End, const FVec& SourcePosition, float SourceMass, float SofteningSq, bool bInverseSquare)
+	{
+#if ORBITCORE_SIMD
+		if (bInverseSquare)
+		{
+			AccumulateSourceSimdFalloff<true>(PX, PY, PZ, FX, FY, FZ, FM, Begin, End, SourcePosition, SourceMass, SofteningSq);
+		}
+		else
+		{
+			AccumulateSourceSimdFalloff<false>(PX, PY, PZ, FX, FY, FZ, FM, Begin, End, SourcePosition, SourceMass, SofteningSq);
+		}
+#else
+		AccumulateSource(PX, PY, PZ, FX, FY, FZ, FM, Begin, End, SourcePosition, SourceMass, SofteningSq, bInverseSquare);
+#endif
+	}
+}
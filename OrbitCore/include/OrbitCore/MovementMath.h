@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "OrbitCore/OrbitVector.h"
+
+namespace OrbitCore
+{
+	/** V without its part along Vertical. Unchanged if Vertical is zero (FVector::ProjectOnTo would divide by it). */
+	inline FVec RemoveVertical(const FVec& V, const FVec& Vertical)
+	{
+		const float VerticalSq = Vertical.SizeSquared();
+		if (VerticalSq < SmallNumber)
+		{
+			return V;
+		}
+		return V - Vertical * (Dot(V, Vertical) / VerticalSq);
+	}
+
+	/**
+	 * Velocity after falling for DeltaTime under Gravity, with the speed along gravity held to
+	 * TerminalLimit. The sideways part is left alone, so it works whichever way gravity points
+	 * (the engine's version only clamps Z).
+	 */
+	inline FVec NewFallVelocity(const FVec& InitialVelocity, const FVec& Gravity, float DeltaTime, float TerminalLimit)
+	{
+		if (Gravity.IsZero())
+		{
+			return InitialVelocity;
+		}
+		const FVec Result = InitialVelocity + Gravity * DeltaTime;
+		const FVec Down = SafeNormal(Gravity);
+		const float DownSpeed = Dot(Result, Down);
+		if (DownSpeed > TerminalLimit)
+		{
+			return Result - Down * (DownSpeed - TerminalLimit);
+		}
+		return Result;
+	}
+
+	/**
+	 * The slope half of IsWalkable: the surface has to face against gravity, and no steeper than
+	 * WalkableFloorZ, the cosine of the steepest walkable angle measured from up.
+	 */
+	inline bool IsWalkableNormal(const FVec& ImpactNormal, const FVec& GravityDirection, float WalkableFloorZ)
+	{
+		const float MinUp = WalkableFloorZ > KindaSmallNumber ? WalkableFloorZ : KindaSmallNumber;
+		return -Dot(ImpactNormal, GravityDirection) >= MinUp;
+	}
+
+	/** What WalkVelocity needs from the movement component, ready to use. */
+	struct FWalkParams
+	{
+		float MaxSpeed;				// GetMaxSpeed, times the analog input modifier
+		float Friction;				// GroundFriction
+		float BrakingFriction;		// whichever friction braking uses, times BrakingFrictionFactor
+		float BrakingDeceleration;	// BrakingDecelerationWalking
+	};
+
+	// The engine's, for braking to behave the same.
+	const float MinTickTime = 0.0002f;
+	const float BrakeToStopVelocity = 10.f;
+
+	inline FVec ClampedToMaxSize(const FVec& V, float MaxSize)
+	{
+		const float SizeSq = V.SizeSquared();
+		if (SizeSq > MaxSize * MaxSize)
+		{
+			return SizeSq > SmallNumber ? V * (MaxSize / std::sqrt(SizeSq)) : FVec();
+		}
+		return V;
+	}
+
+	/** ApplyVelocityBraking: friction and deceleration against Velocity, in steps of at most 1/33s, stopping rather than reversing. */
+	inline FVec BrakeVelocity(FVec Velocity, float DeltaTime, float Friction, float BrakingDeceleration)
+	{
+		Friction = Friction > 0.f ? Friction : 0.f;
+		BrakingDeceleration = BrakingDeceleration > 0.f ? BrakingDeceleration : 0.f;
+		const bool bZeroFriction = Friction == 0.f;
+		const bool bZeroBraking = BrakingDeceleration == 0.f;
+		if (Velocity.IsZero() || DeltaTime < MinTickTime || (bZeroFriction && bZeroBraking))
+		{
+			return Velocity;
+		}
+
+		const FVec OldVelocity = Velocity;
+		const FVec RevAccel = bZeroBraking ? FVec() : SafeNormal(Velocity) * -BrakingDeceleration;
+		const float MaxTimeStep = 1.f / 33.f;
+		float RemainingTime = DeltaTime;
+		while (RemainingTime >= MinTickTime)
+		{
+			const float HalfRemaining = RemainingTime * 0.5f;
+			const float Dt = (RemainingTime > MaxTimeStep && !bZeroFriction) ? (MaxTimeStep < HalfRemaining ? MaxTimeStep : HalfRemaining) : RemainingTime;
+			RemainingTime -= Dt;
+			Velocity += (Velocity * -Friction + RevAccel) * Dt;
+			if (Dot(Velocity, OldVelocity) <= 0.f)
+			{
+				return FVec();
+			}
+		}
+
+		const float SizeSq = Velocity.SizeSquared();
+		if (SizeSq <= KindaSmallNumber || (!bZeroBraking && SizeSq <= BrakeToStopVelocity * BrakeToStopVelocity))
+		{
+			return FVec();
+		}
+		return Velocity;
+	}
+
+	/**
+	 * CalcVelocity for walking under input Acceleration: braking with no input or over MaxSpeed,
+	 * otherwise Friction turning us towards the input, then the input added and the speed held
+	 * to MaxSpeed. No path following (requested velocity) and no fluid friction.
+	 */
+	inline FVec WalkVelocity(FVec Velocity, const FVec& Acceleration, float DeltaTime, const FWalkParams& Params)
+	{
+		const float MaxSpeed = Params.MaxSpeed;
+		const float OverMaxSq = MaxSpeed * MaxSpeed * (1.01f * 1.01f);	// IsExceedingMaxSpeed allows 1%
+		const bool bZeroAcceleration = Acceleration.IsZero();
+		const bool bOverMax = Velocity.SizeSquared() > OverMaxSq;
+
+		if (bZeroAcceleration || bOverMax)
+		{
+			const FVec OldVelocity = Velocity;
+			Velocity = BrakeVelocity(Velocity, DeltaTime, Params.BrakingFriction, Params.BrakingDeceleration);
+			// Braking doesn't take us under MaxSpeed while we're still pushing on.
+			if (bOverMax && Velocity.SizeSquared() < MaxSpeed * MaxSpeed && Dot(Acceleration, OldVelocity) > 0.f)
+			{
+				Velocity = SafeNormal(OldVelocity) * MaxSpeed;
+			}
+		}
+		else
+		{
+			const float Friction = Params.Friction > 0.f ? Params.Friction : 0.f;
+			const float Turn = DeltaTime * Friction < 1.f ? DeltaTime * Friction : 1.f;
+			Velocity -= (Velocity - SafeNormal(Acceleration) * Velocity.Size()) * Turn;
+		}
+
+		const float NewMaxSpeed = Velocity.SizeSquared() > OverMaxSq ? Velocity.Size() : MaxSpeed;
+		Velocity += Acceleration * DeltaTime;
+		return ClampedToMaxSize(Velocity, NewMaxSpeed);
+	}
+
+	/**
+	 * Walking on a sphere with nothing else on it has a closed form: go Velocity (tangent at
+	 * Location) for DeltaTime, come back out to Height from Center, and turn the velocity onto the
+	 * new tangent plane at the same speed. Location is assumed Height from Center already.
+	 */
+	inline void GlideOnSphere(const FVec& Location, const FVec& Velocity, const FVec& Center, float Height, float DeltaTime, FVec& OutLocation, FVec& OutVelocity)
+	{
+		FVec NewUp = SafeNormal(Location + Velocity * DeltaTime - Center);
+		if (NewUp.IsZero())
+		{
+			NewUp = FVec(0.f, 0.f, 1.f);//at the center, any way out will do
+		}
+		OutLocation = Center + NewUp * Height;
+		OutVelocity = SafeNormal(RemoveVertical(Velocity, NewUp)) * Velocity.Size();
+	}
+
+	/**
+	 * One glide step for Num characters, slot i of every array being character i: input and
+	 * velocity flattened onto the tangent plane, WalkVelocity, GlideOnSphere. Locations and
+	 * Velocities are updated in place.
+	 */
+	inline void GlideBatch(int Num, FVec* ORBITCORE_RESTRICT Locations, FVec* ORBITCORE_RESTRICT Velocities, const FVec* ORBITCORE_RESTRICT Accelerations,
+		const FVec* ORBITCORE_RESTRICT Centers, const float* ORBITCORE_RESTRICT Heights, const FWalkParams* ORBITCORE_RESTRICT Params, float DeltaTime)
+	{
+		for (int i = 0; i < Num; i++)
+		{
+			const FVec Up = SafeNormal(Locations[i] - Centers[i]);
+			const FVec Acceleration = RemoveVertical(Accelerations[i], Up);
+			FVec Velocity = RemoveVertical(Velocities[i], Up);
+			Velocity = RemoveVertical(WalkVelocity(Velocity, Acceleration, DeltaTime, Params[i]), Up);
+			GlideOnSphere(Locations[i], Velocity, Centers[i], Heights[i], DeltaTime, Locations[i], Velocities[i]);
+		}
+	}
+}
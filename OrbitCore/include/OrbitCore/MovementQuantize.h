@@ -0,0 +1,297 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "OrbitCore/OrbitVector.h"
+
+#include <cstdint>
+
+/**
+ * Compact movement state for replication. Near a gravity body a character is a direction from
+ * the body's center (octahedral, two coordinates of the tangent plane in effect), a distance, a
+ * velocity in that tangent plane plus an up part that is usually zero, and a heading about up.
+ * Away from any body it falls back to world space. Everything is quantized here; the bit layout
+ * is SerializeQuantized, shared by the engine's NetSerialize and the benchmarks.
+ */
+namespace OrbitCore
+{
+	const float DistanceScale = 10.f;	// distances and world locations in tenths of a unit
+	const int HeadingBits = 12;			// 0.09 degrees
+	const int MaxDirectionBits = 30;
+
+	/** Octahedral map of a unit vector onto [-1,1]^2. */
+	inline void OctEncode(const FVec& N, float& OutU, float& OutV)
+	{
+		const float L1 = std::fabs(N.X) + std::fabs(N.Y) + std::fabs(N.Z);
+		float U = L1 > SmallNumber ? N.X / L1 : 0.f;
+		float V = L1 > SmallNumber ? N.Y / L1 : 0.f;
+		if (N.Z < 0.f)
+		{
+			const float OldU = U;
+			U = (1.f - std::fabs(V)) * (OldU >= 0.f ? 1.f : -1.f);
+			V = (1.f - std::fabs(OldU)) * (V >= 0.f ? 1.f : -1.f);
+		}
+		OutU = U;
+		OutV = V;
+	}
+
+	inline FVec OctDecode(float U, float V)
+	{
+		FVec N(U, V, 1.f - std::fabs(U) - std::fabs(V));
+		if (N.Z < 0.f)
+		{
+			const float OldX = N.X;
+			N.X = (1.f - std::fabs(N.Y)) * (OldX >= 0.f ? 1.f : -1.f);
+			N.Y = (1.f - std::fabs(OldX)) * (N.Y >= 0.f ? 1.f : -1.f);
+		}
+		return SafeNormal(N);
+	}
+
+	/** Tangent axes at Up that every machine works out the same from the same Up. */
+	inline void TangentBasis(const FVec& Up, FVec& OutX, FVec& OutY)
+	{
+		const FVec Reference = std::fabs(Up.Z) < 0.999f ? FVec(0.f, 0.f, 1.f) : FVec(1.f, 0.f, 0.f);
+		OutX = SafeNormal(Cross(Reference, Up));
+		OutY = Cross(Up, OutX);
+	}
+
+	/** Bits per direction coordinate so a step of the direction moves about a tenth of a unit at Distance (tenths). */
+	inline int DirectionBits(uint32_t Distance)
+	{
+		int Bits = 8;
+		while (Bits < MaxDirectionBits && (uint64_t(1) << Bits) < uint64_t(Distance) * 4)
+		{
+			Bits++;
+		}
+		return Bits;
+	}
+
+	inline uint32_t QuantizeUnit(float Value, int Bits)
+	{
+		const float Max = float((uint64_t(1) << Bits) - 1);
+		const float Scaled = (Value + 1.f) * 0.5f * Max + 0.5f;
+		return Scaled <= 0.f ? 0u : Scaled >= Max ? uint32_t(Max) : uint32_t(Scaled);
+	}
+
+	inline float DequantizeUnit(uint32_t Value, int Bits)
+	{
+		return float(Value) / float((uint64_t(1) << Bits) - 1) * 2.f - 1.f;
+	}
+
+	inline int32_t RoundClamped(float Value)
+	{
+		const float Limit = 1073741760.f;
+		Value = Value < -Limit ? -Limit : Value > Limit ? Limit : Value;
+		return int32_t(std::floor(Value + 0.5f));
+	}
+
+	struct FQuantizedMovement
+	{
+		bool bRelative;
+		uint32_t Distance;		// relative: from the body's center, tenths
+		uint32_t Direction[2];	// relative: octahedral, DirectionBits(Distance) each
+		int32_t Location[3];	// world: tenths
+		int32_t Velocity[3];	// relative: tangent X, tangent Y, up; world: X, Y, Z. Units per second
+		uint16_t Rotation[3];	// relative: heading in [0]; world: pitch, yaw, roll as shorts
+
+		FQuantizedMovement() : bRelative(false), Distance(0)
+		{
+			Direction[0] = Direction[1] = 0;
+			Location[0] = Location[1] = Location[2] = 0;
+			Velocity[0] = Velocity[1] = Velocity[2] = 0;
+			Rotation[0] = Rotation[1] = Rotation[2] = 0;
+		}
+
+		bool operator==(const FQuantizedMovement& Other) const
+		{
+			return bRelative == Other.bRelative && Distance == Other.Distance
+				&& Direction[0] == Other.Direction[0] && Direction[1] == Other.Direction[1]
+				&& Location[0] == Other.Location[0] && Location[1] == Other.Location[1] && Location[2] == Other.Location[2]
+				&& Velocity[0] == Other.Velocity[0] && Velocity[1] == Other.Velocity[1] && Velocity[2] == Other.Velocity[2]
+				&& Rotation[0] == Other.Rotation[0] && Rotation[1] == Other.Rotation[1] && Rotation[2] == Other.Rotation[2];
+		}
+	};
+
+	/** Forward is the way the character faces; only its heading about up is kept. */
+	inline FQuantizedMovement QuantizeRelative(const FVec& Center, const FVec& Location, const FVec& Velocity, const FVec& Forward)
+	{
+		FQuantizedMovement Q;
+		Q.bRelative = true;
+		const FVec Offset = Location - Center;
+		const float Distance = Offset.Size() * DistanceScale + 0.5f;
+		Q.Distance = Distance >= 4294967040.f ? 0xffffff00u : uint32_t(Distance);
+
+		const int Bits = DirectionBits(Q.Distance);
+		float U, V;
+		OctEncode(SafeNormal(Offset), U, V);
+		Q.Direction[0] = QuantizeUnit(U, Bits);
+		Q.Direction[1] = QuantizeUnit(V, Bits);
+
+		// In the basis the other end will rebuild from the quantized direction, not ours.
+		const FVec Up = OctDecode(DequantizeUnit(Q.Direction[0], Bits), DequantizeUnit(Q.Direction[1], Bits));
+		FVec TangentX, TangentY;
+		TangentBasis(Up, TangentX, TangentY);
+		Q.Velocity[0] = RoundClamped(Dot(Velocity, TangentX));
+		Q.Velocity[1] = RoundClamped(Dot(Velocity, TangentY));
+		Q.Velocity[2] = RoundClamped(Dot(Velocity, Up));
+
+		const float Heading = std::atan2(Dot(Forward, TangentY), Dot(Forward, TangentX));
+		Q.Rotation[0] = uint16_t(RoundClamped(Heading * (float(1 << HeadingBits) / 6.2831853f)) & ((1 << HeadingBits) - 1));
+		return Q;
+	}
+
+	inline void DequantizeRelative(const FQuantizedMovement& Q, const FVec& Center, FVec& OutLocation, FVec& OutVelocity, FVec& OutUp, FVec& OutForward)
+	{
+		const int Bits = DirectionBits(Q.Distance);
+		OutUp = OctDecode(DequantizeUnit(Q.Direction[0], Bits), DequantizeUnit(Q.Direction[1], Bits));
+		OutLocation = Center + OutUp * (float(Q.Distance) / DistanceScale);
+
+		FVec TangentX, TangentY;
+		TangentBasis(OutUp, TangentX, TangentY);
+		OutVelocity = TangentX * float(Q.Velocity[0]) + TangentY * float(Q.Velocity[1]) + OutUp * float(Q.Velocity[2]);
+
+		const float Heading = float(Q.Rotation[0]) * (6.2831853f / float(1 << HeadingBits));
+		OutForward = TangentX * std::cos(Heading) + TangentY * std::sin(Heading);
+	}
+
+	/** Pitch, yaw and roll in degrees, like FRotator. */
+	inline FQuantizedMovement QuantizeWorld(const FVec& Location, const FVec& Velocity, float Pitch, float Yaw, float Roll)
+	{
+		FQuantizedMovement Q;
+		Q.Location[0] = RoundClamped(Location.X * DistanceScale);
+		Q.Location[1] = RoundClamped(Location.Y * DistanceScale);
+		Q.Location[2] = RoundClamped(Location.Z * DistanceScale);
+		Q.Velocity[0] = RoundClamped(Velocity.X);
+		Q.Velocity[1] = RoundClamped(Velocity.Y);
+		Q.Velocity[2] = RoundClamped(Velocity.Z);
+		const float AngleToShort = 65536.f / 360.f;
+		Q.Rotation[0] = uint16_t(RoundClamped(Pitch * AngleToShort) & 0xffff);
+		Q.Rotation[1] = uint16_t(RoundClamped(Yaw * AngleToShort) & 0xffff);
+		Q.Rotation[2] = uint16_t(RoundClamped(Roll * AngleToShort) & 0xffff);
+		return Q;
+	}
+
+	inline void DequantizeWorld(const FQuantizedMovement& Q, FVec& OutLocation, FVec& OutVelocity, float& OutPitch, float& OutYaw, float& OutRoll)
+	{
+		OutLocation = FVec(float(Q.Location[0]), float(Q.Location[1]), float(Q.Location[2])) * (1.f / DistanceScale);
+		OutVelocity = FVec(float(Q.Velocity[0]), float(Q.Velocity[1]), float(Q.Velocity[2]));
+		const float ShortToAngle = 360.f / 65536.f;
+		OutPitch = float(Q.Rotation[0]) * ShortToAngle;
+		OutYaw = float(Q.Rotation[1]) * ShortToAngle;
+		OutRoll = float(Q.Rotation[2]) * ShortToAngle;
+	}
+
+	/** The low Bits of Value. Loading starts from zero, since archives only fill the bits they read. */
+	template<typename TArchive>
+	void SerializeUInt(TArchive& Ar, uint32_t& Value, int Bits)
+	{
+		uint32_t Bits32 = Ar.IsLoading() ? 0u : Value;
+		if (Bits > 0)
+		{
+			Ar.SerializeBits(&Bits32, Bits);//little endian: the low bits are the first bytes
+		}
+		Value = Bits < 32 ? Bits32 & ((uint32_t(1) << Bits) - 1) : Bits32;
+	}
+
+	/** Seven bits at a time, small values in one byte. */
+	template<typename TArchive>
+	void SerializePacked(TArchive& Ar, uint32_t& Value)
+	{
+		if (Ar.IsLoading())
+		{
+			Value = 0;
+			for (int Shift = 0; Shift < 35; Shift += 7)
+			{
+				uint32_t Byte = 0;
+				SerializeUInt(Ar, Byte, 8);
+				Value |= (Byte & 0x7f) << Shift;
+				if (!(Byte & 0x80))
+				{
+					break;
+				}
+			}
+		}
+		else
+		{
+			uint32_t Remaining = Value;
+			do
+			{
+				uint32_t Byte = (Remaining & 0x7f) | (Remaining > 0x7f ? 0x80 : 0);
+				SerializeUInt(Ar, Byte, 8);
+				Remaining >>= 7;
+			} while (Remaining);
+		}
+	}
+
+	/** Num signed values sharing one 5 bit count of how many bits each takes, like the engine's packed vectors. */
+	template<typename TArchive>
+	void SerializeSigned(TArchive& Ar, int32_t* Values, int Num)
+	{
+		uint32_t Bits = 0;
+		if (!Ar.IsLoading())
+		{
+			for (int i = 0; i < Num; i++)
+			{
+				const uint32_t ZigZag = (uint32_t(Values[i]) << 1) ^ uint32_t(Values[i] >> 31);
+				while (Bits < 31 && (ZigZag >> Bits))
+				{
+					Bits++;
+				}
+			}
+		}
+		SerializeUInt(Ar, Bits, 5);
+		for (int i = 0; i < Num; i++)
+		{
+			uint32_t ZigZag = (uint32_t(Values[i]) << 1) ^ uint32_t(Values[i] >> 31);
+			SerializeUInt(Ar, ZigZag, int(Bits));
+			Values[i] = int32_t(ZigZag >> 1) ^ -int32_t(ZigZag & 1);
+		}
+	}
+
+	/**
+	 * Writes or reads Q. TArchive needs IsLoading() and SerializeBits(void*, bits), which FArchive has.
+	 * Relative: 1 + packed distance + 2 x DirectionBits + tangent velocity + 1 (+ up velocity) + HeadingBits.
+	 */
+	template<typename TArchive>
+	void SerializeQuantized(TArchive& Ar, FQuantizedMovement& Q)
+	{
+		uint32_t Relative = Q.bRelative ? 1 : 0;
+		SerializeUInt(Ar, Relative, 1);
+		Q.bRelative = Relative != 0;
+
+		if (Q.bRelative)
+		{
+			SerializePacked(Ar, Q.Distance);
+			const int Bits = DirectionBits(Q.Distance);
+			SerializeUInt(Ar, Q.Direction[0], Bits);
+			SerializeUInt(Ar, Q.Direction[1], Bits);
+
+			SerializeSigned(Ar, Q.Velocity, 2);
+			uint32_t Vertical = Q.Velocity[2] != 0 ? 1 : 0;//zero whenever we walk
+			SerializeUInt(Ar, Vertical, 1);
+			if (Vertical)
+			{
+				SerializeSigned(Ar, Q.Velocity + 2, 1);
+			}
+			else
+			{
+				Q.Velocity[2] = 0;
+			}
+
+			uint32_t Heading = Q.Rotation[0];
+			SerializeUInt(Ar, Heading, HeadingBits);
+			Q.Rotation[0] = uint16_t(Heading);
+		}
+		else
+		{
+			SerializeSigned(Ar, Q.Location, 3);
+			SerializeSigned(Ar, Q.Velocity, 3);
+			for (int i = 0; i < 3; i++)
+			{
+				uint32_t Angle = Q.Rotation[i];
+				SerializeUInt(Ar, Angle, 16);
+				Q.Rotation[i] = uint16_t(Angle);
+			}
+		}
+	}
+}
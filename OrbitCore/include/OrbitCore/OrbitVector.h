@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cmath>
+
+/**
+ * Gravity and movement math with no engine in it, so it can be built, benchmarked and profiled
+ * with plain CMake (see OrbitCore/CMakeLists.txt). The Orbit module includes these headers and
+ * converts with OrbitCoreBridge.h. Everything is inline; there is nothing to link.
+ */
+namespace OrbitCore
+{
+	// The engine's SMALL_NUMBER and KINDA_SMALL_NUMBER, so results match the code this came from.
+	const float SmallNumber = 1.e-8f;
+	const float KindaSmallNumber = 1.e-4f;
+
+#if defined(_MSC_VER) || defined(__GNUC__) || defined(__clang__)
+#define ORBITCORE_RESTRICT __restrict
+#else
+#define ORBITCORE_RESTRICT
+#endif
+
+	/** Just enough of FVector. */
+	struct FVec
+	{
+		float X, Y, Z;
+
+		FVec() : X(0.f), Y(0.f), Z(0.f) {}
+		FVec(float InX, float InY, float InZ) : X(InX), Y(InY), Z(InZ) {}
+
+		FVec operator+(const FVec& V) const { return FVec(X + V.X, Y + V.Y, Z + V.Z); }
+		FVec operator-(const FVec& V) const { return FVec(X - V.X, Y - V.Y, Z - V.Z); }
+		FVec operator-() const { return FVec(-X, -Y, -Z); }
+		FVec operator*(float S) const { return FVec(X * S, Y * S, Z * S); }
+		FVec& operator+=(const FVec& V) { X += V.X; Y += V.Y; Z += V.Z; return *this; }
+		FVec& operator-=(const FVec& V) { X -= V.X; Y -= V.Y; Z -= V.Z; return *this; }
+
+		float SizeSquared() const { return X * X + Y * Y + Z * Z; }
+		float Size() const { return std::sqrt(SizeSquared()); }
+		bool IsZero() const { return X == 0.f && Y == 0.f && Z == 0.f; }
+	};
+
+	inline float Dot(const FVec& A, const FVec& B)
+	{
+		return A.X * B.X + A.Y * B.Y + A.Z * B.Z;
+	}
+
+	inline FVec Cross(const FVec& A, const FVec& B)
+	{
+		return FVec(A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X);
+	}
+
+	/** Unit length, or zero when too short to tell, like FVector::GetSafeNormal. */
+	inline FVec SafeNormal(const FVec& V)
+	{
+		const float SizeSq = V.SizeSquared();
+		if (SizeSq < SmallNumber)
+		{
+			return FVec();
+		}
+		return V * (1.f / std::sqrt(SizeSq));
+	}
+}
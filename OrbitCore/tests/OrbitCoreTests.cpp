@@ -0,0 +1,393 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Unit tests for the OrbitCore math. OrbitCoreTests [name] runs the test called name, or all of
+// them; CMakeLists.txt registers each one with ctest by name.
+
+#include "OrbitCore/GravityMath.h"
+#include "OrbitCore/GravityOctree.h"
+#include "OrbitCore/MovementMath.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace OrbitCore;
+
+namespace
+{
+	bool bFailed;
+
+	void Fail(const char* File, int Line, const char* Expression)
+	{
+		std::printf("%s(%d): failed: %s\n", File, Line, Expression);
+		bFailed = true;
+	}
+
+#define ORBIT_CHECK(Expression) do { if (!(Expression)) { Fail(__FILE__, __LINE__, #Expression); } } while (0)
+
+	bool Near(float A, float B, float Tolerance)
+	{
+		return std::fabs(A - B) <= Tolerance;
+	}
+
+	bool NearVec(const FVec& A, const FVec& B, float Tolerance)
+	{
+		return (A - B).Size() <= Tolerance;
+	}
+
+	std::mt19937 Random(1234);
+
+	// In [0, 1). mt19937's output is the same everywhere, unlike what the standard distributions make of it,
+	// so every compiler tests the same numbers.
+	float RandomFraction()
+	{
+		return float(Random() >> 8) * (1.f / 16777216.f);
+	}
+
+	FVec RandomUnit()
+	{
+		FVec V;
+		do
+		{
+			V = FVec(2.f * RandomFraction() - 1.f, 2.f * RandomFraction() - 1.f, 2.f * RandomFraction() - 1.f);
+		} while (V.SizeSquared() < 0.01f || V.SizeSquared() > 1.f);
+		return SafeNormal(V);
+	}
+
+	void TestRemoveVertical()
+	{
+		// Whatever the vertical, nothing is left along it and the rest is untouched.
+		for (int i = 0; i < 100; i++)
+		{
+			const FVec V = RandomUnit() * 700.f;
+			const FVec Up = RandomUnit();
+			const FVec Flat = RemoveVertical(V, Up * 980.f);
+			ORBIT_CHECK(Near(Dot(Flat, Up), 0.f, 1.e-3f));
+			ORBIT_CHECK(NearVec(Flat + Up * Dot(V, Up), V, 1.e-3f));
+		}
+		ORBIT_CHECK(NearVec(RemoveVertical(FVec(3.f, 4.f, 5.f), FVec(0.f, 0.f, -2.f)), FVec(3.f, 4.f, 0.f), 1.e-6f));
+		// Zero gravity used to divide by zero.
+		ORBIT_CHECK(NearVec(RemoveVertical(FVec(3.f, 4.f, 5.f), FVec()), FVec(3.f, 4.f, 5.f), 0.f));
+	}
+
+	void TestNewFallVelocity()
+	{
+		const FVec Down(0.f, 0.f, -980.f);
+		ORBIT_CHECK(NearVec(NewFallVelocity(FVec(100.f, 0.f, 0.f), Down, 0.5f, 4000.f), FVec(100.f, 0.f, -490.f), 1.e-3f));
+		ORBIT_CHECK(NearVec(NewFallVelocity(FVec(1.f, 2.f, 3.f), FVec(), 0.5f, 4000.f), FVec(1.f, 2.f, 3.f), 0.f));
+
+		// The clamp is along gravity, whichever way that points: gravity along +X caps X, not Z as the engine's did.
+		const FVec Sideways(980.f, 0.f, 0.f);
+		const FVec Clamped = NewFallVelocity(FVec(3990.f, 250.f, -5000.f), Sideways, 0.1f, 4000.f);
+		ORBIT_CHECK(Near(Clamped.X, 4000.f, 1.e-2f));
+		ORBIT_CHECK(Near(Clamped.Y, 250.f, 1.e-3f));
+		ORBIT_CHECK(Near(Clamped.Z, -5000.f, 1.e-3f));
+
+		// Off axis too: only the part along gravity is capped.
+		for (int i = 0; i < 100; i++)
+		{
+			const FVec GravityDirection = RandomUnit();
+			const FVec Side = SafeNormal(RemoveVertical(RandomUnit(), GravityDirection));
+			const FVec Start = GravityDirection * 3900.f + Side * 1200.f;
+			const FVec Result = NewFallVelocity(Start, GravityDirection * 980.f, 0.5f, 4000.f);
+			ORBIT_CHECK(Near(Dot(Result, GravityDirection), 4000.f, 0.05f));
+			ORBIT_CHECK(Near(Dot(Result, Side), 1200.f, 0.05f));
+		}
+
+		// Rising against gravity isn't terminal velocity.
+		const FVec Rising = NewFallVelocity(FVec(0.f, 0.f, 6000.f), Down, 0.1f, 4000.f);
+		ORBIT_CHECK(Near(Rising.Z, 5902.f, 1.e-2f));
+	}
+
+	void TestIsWalkableNormal()
+	{
+		const float WalkableFloorZ = 0.71f;	// about 45 degrees
+		ORBIT_CHECK(IsWalkableNormal(FVec(0.f, 0.f, 1.f), FVec(0.f, 0.f, -1.f), WalkableFloorZ));
+		ORBIT_CHECK(!IsWalkableNormal(FVec(1.f, 0.f, 0.f), FVec(0.f, 0.f, -1.f), WalkableFloorZ));
+		ORBIT_CHECK(!IsWalkableNormal(FVec(0.f, 0.f, -1.f), FVec(0.f, 0.f, -1.f), WalkableFloorZ));
+		ORBIT_CHECK(IsWalkableNormal(SafeNormal(FVec(1.f, 0.f, 1.2f)), FVec(0.f, 0.f, -1.f), WalkableFloorZ));
+		ORBIT_CHECK(!IsWalkableNormal(SafeNormal(FVec(1.f, 0.f, 0.8f)), FVec(0.f, 0.f, -1.f), WalkableFloorZ));
+
+		// The same slopes against any gravity.
+		for (int i = 0; i < 100; i++)
+		{
+			const FVec Up = RandomUnit();
+			const FVec Side = SafeNormal(RemoveVertical(RandomUnit(), Up));
+			ORBIT_CHECK(IsWalkableNormal(Up, -Up, WalkableFloorZ));
+			ORBIT_CHECK(IsWalkableNormal(SafeNormal(Up * 1.2f + Side), -Up, WalkableFloorZ));
+			ORBIT_CHECK(!IsWalkableNormal(SafeNormal(Up * 0.8f + Side), -Up, WalkableFloorZ));
+			ORBIT_CHECK(!IsWalkableNormal(Side, -Up, WalkableFloorZ));
+		}
+
+		// A zero WalkableFloorZ still wants the floor facing up a little.
+		ORBIT_CHECK(!IsWalkableNormal(FVec(1.f, 0.f, 0.f), FVec(0.f, 0.f, -1.f), 0.f));
+	}
+
+	FWalkParams Walking()
+	{
+		FWalkParams Params;
+		Params.MaxSpeed = 600.f;
+		Params.Friction = 8.f;
+		Params.BrakingFriction = 8.f;
+		Params.BrakingDeceleration = 2048.f;
+		return Params;
+	}
+
+	void TestWalkVelocity()
+	{
+		const FWalkParams Params = Walking();
+		const float DeltaTime = 1.f / 60.f;
+
+		// From rest the input is all there is.
+		ORBIT_CHECK(NearVec(WalkVelocity(FVec(), FVec(2048.f, 0.f, 0.f), DeltaTime, Params), FVec(2048.f * DeltaTime, 0.f, 0.f), 1.e-3f));
+
+		// Held input reaches MaxSpeed and stays there.
+		FVec Velocity;
+		for (int i = 0; i < 120; i++)
+		{
+			Velocity = WalkVelocity(Velocity, FVec(0.f, 2048.f, 0.f), DeltaTime, Params);
+			ORBIT_CHECK(Velocity.Size() <= Params.MaxSpeed + 1.e-2f);
+		}
+		ORBIT_CHECK(Near(Velocity.Size(), Params.MaxSpeed, 1.e-2f));
+
+		// Friction turns us toward new input without going over.
+		const FVec Turned = WalkVelocity(Velocity, FVec(2048.f, 0.f, 0.f), DeltaTime, Params);
+		ORBIT_CHECK(Turned.X > 0.f && Turned.Y < Velocity.Y);
+		ORBIT_CHECK(Turned.Size() <= Params.MaxSpeed + 1.e-2f);
+
+		// Letting go brakes to a stop, never backwards.
+		const FVec Start = Velocity;
+		for (int i = 0; i < 120; i++)
+		{
+			Velocity = WalkVelocity(Velocity, FVec(), DeltaTime, Params);
+			ORBIT_CHECK(Dot(Velocity, Start) >= 0.f);
+		}
+		ORBIT_CHECK(Velocity.IsZero());
+
+		// Launched past MaxSpeed while still pushing the same way: braking doesn't take us under it.
+		const FVec Launched = WalkVelocity(FVec(0.f, 1500.f, 0.f), FVec(0.f, 2048.f, 0.f), DeltaTime, Params);
+		ORBIT_CHECK(Launched.Y >= Params.MaxSpeed - 1.e-2f && Launched.Y < 1500.f);
+	}
+
+	void TestGlideOnSphere()
+	{
+		const FVec Center(100.f, -200.f, 5000.f);
+		const float Height = 1090.f;
+		for (int i = 0; i < 100; i++)
+		{
+			const FVec Up = RandomUnit();
+			const FVec Location = Center + Up * Height;
+			const FVec Velocity = SafeNormal(RemoveVertical(RandomUnit(), Up)) * 600.f;
+			FVec NewLocation, NewVelocity;
+			GlideOnSphere(Location, Velocity, Center, Height, 1.f / 30.f, NewLocation, NewVelocity);
+
+			const FVec NewUp = SafeNormal(NewLocation - Center);
+			ORBIT_CHECK(Near((NewLocation - Center).Size(), Height, 1.e-2f));
+			ORBIT_CHECK(Near(Dot(NewVelocity, NewUp), 0.f, 1.e-2f));
+			ORBIT_CHECK(Near(NewVelocity.Size(), 600.f, 1.e-2f));
+			ORBIT_CHECK(Near((NewLocation - Location).Size(), 20.f, 0.1f));	// a 20 unit step on a 1090 unit sphere barely bends
+			ORBIT_CHECK(Dot(NewLocation - Location, Velocity) > 0.f);
+		}
+
+		// Standing still stays put.
+		FVec Location, Velocity;
+		GlideOnSphere(Center + FVec(0.f, Height, 0.f), FVec(), Center, Height, 1.f / 30.f, Location, Velocity);
+		ORBIT_CHECK(NearVec(Location, Center + FVec(0.f, Height, 0.f), 1.e-2f));
+		ORBIT_CHECK(Velocity.IsZero());
+
+		// At the center any way out is fine, as long as it is out at Height.
+		GlideOnSphere(Center, FVec(), Center, Height, 1.f / 30.f, Location, Velocity);
+		ORBIT_CHECK(Near((Location - Center).Size(), Height, 1.e-2f));
+	}
+
+	void TestGravityPair()
+	{
+		const FVec Point(0.f, 0.f, 0.f);
+		const FVec Source(300.f, 0.f, 400.f);	// 500 away
+		FVec Field;
+		float Magnitude = 0.f;
+
+		AccumulatePair(Point, Source, 1.e6f, 0.f, false, Field, Magnitude);
+		ORBIT_CHECK(Near(Magnitude, 1.e6f / 250000.f, 1.e-5f));
+		ORBIT_CHECK(NearVec(Field, Source * (1.e6f / 250000.f), 1.e-3f));
+
+		Field = FVec();
+		Magnitude = 0.f;
+		AccumulatePair(Point, Source, 1.e6f, 0.f, true, Field, Magnitude);
+		ORBIT_CHECK(Near(Magnitude, 4.f, 1.e-5f));
+		ORBIT_CHECK(Near(Field.Size(), 4.f, 1.e-4f));	// inverse square: M / r^2 along the unit direction
+		ORBIT_CHECK(NearVec(SafeNormal(Field), SafeNormal(Source), 1.e-5f));
+
+		// Softening adds to |D|^2; pairs add up; a body doesn't pull itself.
+		Field = FVec();
+		Magnitude = 0.f;
+		AccumulatePair(Point, Source, 1.e6f, 10000.f, false, Field, Magnitude);
+		ORBIT_CHECK(Near(Magnitude, 1.e6f / 260000.f, 1.e-5f));
+		AccumulatePair(Point, -Source, 1.e6f, 10000.f, false, Field, Magnitude);
+		ORBIT_CHECK(NearVec(Field, FVec(), 1.e-3f));
+		ORBIT_CHECK(Near(Magnitude, 2.e6f / 260000.f, 1.e-5f));
+		AccumulatePair(Point, Point, 1.e6f, 10000.f, false, Field, Magnitude);
+		ORBIT_CHECK(Near(Magnitude, 2.e6f / 260000.f, 1.e-5f));
+
+		// The batch kernel is the same pair term.
+		const int Num = 37;
+		std::vector<float> X(Num), Y(Num), Z(Num), FX(Num, 0.f), FY(Num, 0.f), FZ(Num, 0.f), FM(Num, 0.f);
+		for (int i = 0; i < Num; i++)
+		{
+			const FVec P = RandomUnit() * float(100 + 50 * i);
+			X[i] = P.X;
+			Y[i] = P.Y;
+			Z[i] = P.Z;
+		}
+		X[5] = Source.X;
+		Y[5] = Source.Y;
+		Z[5] = Source.Z;
+		for (int bInverseSquare = 0; bInverseSquare < 2; bInverseSquare++)
+		{
+			std::fill(FX.begin(), FX.end(), 0.f);
+			std::fill(FY.begin(), FY.end(), 0.f);
+			std::fill(FZ.begin(), FZ.end(), 0.f);
+			std::fill(FM.begin(), FM.end(), 0.f);
+			AccumulateSource(X.data(), Y.data(), Z.data(), FX.data(), FY.data(), FZ.data(), FM.data(), 0, Num, Source, 1.e6f, 25.f, bInverseSquare != 0);
+			for (int i = 0; i < Num; i++)
+			{
+				FVec Expected;
+				float ExpectedMagnitude = 0.f;
+				AccumulatePair(FVec(X[i], Y[i], Z[i]), Source, 1.e6f, 25.f, bInverseSquare != 0, Expected, ExpectedMagnitude);
+				ORBIT_CHECK(NearVec(FVec(FX[i], FY[i], FZ[i]), Expected, 1.e-4f * Expected.Size() + 1.e-6f));
+				ORBIT_CHECK(Near(FM[i], ExpectedMagnitude, 1.e-4f * ExpectedMagnitude + 1.e-6f));
+			}
+			ORBIT_CHECK(FM[5] == 0.f);
+		}
+	}
+
+	void TestPointMass()
+	{
+		const FVec Center(0.f, 0.f, 5000.f);
+		ORBIT_CHECK(Near(PointMassMagnitude(FVec(0.f, 0.f, 2000.f), Center, 9.e6f, 100.f), 100.f * 9.e6f / 9.e6f, 1.e-4f));
+		ORBIT_CHECK(NearVec(PointMassDirection(FVec(0.f, 0.f, 2000.f), Center), FVec(0.f, 0.f, 1.f), 1.e-6f));
+		ORBIT_CHECK(NearVec(PointMassDirection(FVec(0.f, 3000.f, 5000.f), Center), FVec(0.f, -1.f, 0.f), 1.e-6f));
+		ORBIT_CHECK(PointMassMagnitude(Center, Center, 9.e6f, 100.f) == 0.f);
+		ORBIT_CHECK(PointMassDirection(Center, Center).IsZero());
+	}
+
+	void TestGravityOctree()
+	{
+		// Clustered like an asteroid field: a few clumps of bodies with a spread of masses.
+		const int NumBodies = 2000;
+		std::vector<FVec> Positions(NumBodies);
+		std::vector<float> Masses(NumBodies);
+		FVec Clumps[6];
+		for (FVec& Clump : Clumps)
+		{
+			Clump = RandomUnit() * (20000.f * RandomFraction());
+		}
+		for (int i = 0; i < NumBodies; i++)
+		{
+			Positions[i] = Clumps[i % 6] + RandomUnit() * (3000.f * RandomFraction());
+			Masses[i] = 1.e3f + 1.e5f * RandomFraction();
+		}
+		Masses[7] = 0.f;	// massless bodies are left out of the tree
+		Positions[11] = Positions[10];	// coincident bodies share a leaf
+
+		FGravityOctree Tree;
+		Tree.Build(Positions.data(), Masses.data(), NumBodies);
+		ORBIT_CHECK(!Tree.IsEmpty());
+
+		// Every body, and some points outside the field, against the direct sum.
+		std::vector<FVec> Points(Positions);
+		for (int i = 0; i < 200; i++)
+		{
+			Points.push_back(RandomUnit() * (30000.f + 30000.f * RandomFraction()));
+		}
+
+		// Theta, then the worst error allowed relative to the direct field and on average: about twice the
+		// worst seen from GCC at -O0 to -O3 -ffast-math -march=native, over both falloffs and the magnitude.
+		const float Thetas[][3] =
+		{
+			{ 0.f, 5.e-5f, 5.e-6f },
+			{ 0.3f, 0.02f, 0.004f },
+			{ 0.5f, 0.12f, 0.012f },
+			{ 0.8f, 0.3f, 0.04f },
+		};
+		for (int bInverseSquare = 0; bInverseSquare < 2; bInverseSquare++)
+		{
+			for (const float* Theta : Thetas)
+			{
+				float WorstError = 0.f;
+				float WorstMagnitudeError = 0.f;
+				double SumError = 0.0;
+				for (const FVec& Point : Points)
+				{
+					FVec Direct;
+					float DirectMagnitude = 0.f;
+					for (int j = 0; j < NumBodies; j++)
+					{
+						AccumulatePair(Point, Positions[j], Masses[j], 25.f, bInverseSquare != 0, Direct, DirectMagnitude);
+					}
+					float Magnitude = 0.f;
+					const FVec Field = Tree.GetField(Point, Theta[0], &Magnitude, 25.f, bInverseSquare != 0);
+
+					const float Error = (Field - Direct).Size() / Direct.Size();
+					WorstError = std::max(WorstError, Error);
+					WorstMagnitudeError = std::max(WorstMagnitudeError, std::fabs(Magnitude - DirectMagnitude) / DirectMagnitude);
+					SumError += Error;
+				}
+				const float MeanError = float(SumError / Points.size());
+				std::printf("  theta %.1f %s: worst %.2e, mean %.2e, magnitude %.2e\n", Theta[0], bInverseSquare ? "inverse square" : "linear", WorstError, MeanError, WorstMagnitudeError);
+				ORBIT_CHECK(WorstError <= Theta[1]);
+				ORBIT_CHECK(MeanError <= Theta[2]);
+				ORBIT_CHECK(WorstMagnitudeError <= Theta[1]);
+			}
+		}
+
+		Tree.Build(Positions.data(), Masses.data(), 0);
+		ORBIT_CHECK(Tree.IsEmpty());
+		ORBIT_CHECK(Tree.GetField(FVec(), 0.5f).IsZero());
+	}
+
+	struct FTest
+	{
+		const char* Name;
+		void (*Run)();
+	};
+}
+
+int main(int argc, char** argv)
+{
+	const FTest Tests[] =
+	{
+		{ "remove-vertical", &TestRemoveVertical },
+		{ "fall-velocity", &TestNewFallVelocity },
+		{ "walkable", &TestIsWalkableNormal },
+		{ "walk-velocity", &TestWalkVelocity },
+		{ "glide-on-sphere", &TestGlideOnSphere },
+		{ "gravity-pair", &TestGravityPair },
+		{ "point-mass", &TestPointMass },
+		{ "gravity-octree", &TestGravityOctree },
+	};
+	const char* Name = argc > 1 ? argv[1] : NULL;
+
+	int NumRun = 0;
+	for (const FTest& Test : Tests)
+	{
+		if (!Name || std::strcmp(Test.Name, Name) == 0)
+		{
+			const bool bFailedBefore = bFailed;
+			bFailed = false;
+			Random.seed(1234);//the same numbers whether it runs alone or after the others
+			Test.Run();
+			std::printf("%-20s %s\n", Test.Name, bFailed ? "FAILED" : "ok");
+			bFailed |= bFailedBefore;
+			NumRun++;
+		}
+	}
+	if (NumRun == 0)
+	{
+		std::printf("No test called %s\n", Name);
+		return 1;
+	}
+	return bFailed ? 1 : 0;
+}